@@ -0,0 +1,326 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "clock.h"
+
+/**
+ * The default time a benchmark has to run for, in seconds.
+ */
+static const double kMumbleBenchMinTime = 0.5;
+
+/**
+ * The most iterations a benchmark is run for.
+ */
+static const uint64_t kMumbleBenchMaxIterations = 1000000000;
+
+/**
+ * The result of a benchmark.
+ */
+typedef struct mumble_bench_result_t
+{
+    char name[128];
+    uint64_t iterations;
+    /** The wall clock time per iteration, in nanoseconds. */
+    double real_time;
+    /** The CPU time per iteration, in nanoseconds. */
+    double cpu_time;
+    /** Bytes processed per second, or zero. */
+    double bytes_per_second;
+    /** Items processed per second, or zero. */
+    double items_per_second;
+} mumble_bench_result_t;
+
+static uint64_t mumble_bench_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+void mumble_bench_resume(mumble_bench_state_t* state)
+{
+    state->cpu_start = mumble_bench_cpu_ns();
+    state->real_start = mumble_clock_ns();
+}
+
+void mumble_bench_pause(mumble_bench_state_t* state)
+{
+    uint64_t real_end = mumble_clock_ns();
+
+    state->cpu_ns += mumble_bench_cpu_ns() - state->cpu_start;
+    state->real_ns += real_end - state->real_start;
+}
+
+void mumble_bench_fail(mumble_bench_state_t* state, const char* reason)
+{
+    fprintf(stderr, "benchmark failed: %s\n", reason);
+    state->failed = 1;
+}
+
+/**
+ * Get the full name of a benchmark, including its argument.
+ */
+static void mumble_bench_name(const mumble_bench_t* bench, char* name,
+                              size_t size)
+{
+    if (bench->arg)
+        snprintf(name, size, "%s/%zu", bench->name, bench->arg);
+    else
+        snprintf(name, size, "%s", bench->name);
+}
+
+/**
+ * Run a benchmark with more and more iterations until it runs for at least
+ * `min_time` seconds.
+ *
+ * @returns zero on success, non-zero if the benchmark failed.
+ */
+static int mumble_bench_run(const mumble_bench_t* bench, double min_time,
+                            mumble_bench_result_t* result)
+{
+    double seconds, multiplier;
+    uint64_t iterations = 1;
+    mumble_bench_state_t state;
+
+    for (;;)
+    {
+        memset(&state, 0, sizeof state);
+        state.iterations = iterations;
+        state.arg = bench->arg;
+
+        bench->func(&state);
+
+        if (state.failed)
+            return 1;
+
+        seconds = state.real_ns / 1e9;
+
+        if (seconds >= min_time || iterations >= kMumbleBenchMaxIterations)
+            break;
+
+        /* Aim a bit past the minimum time once the run is long enough to
+         * predict from, otherwise grow by an order of magnitude. */
+        multiplier = 10;
+
+        if (seconds / min_time > 0.1)
+            multiplier = min_time * 1.4 / seconds;
+
+        if ((uint64_t)(iterations * multiplier) <= iterations)
+            iterations++;
+        else
+            iterations = (uint64_t)(iterations * multiplier);
+
+        if (iterations > kMumbleBenchMaxIterations)
+            iterations = kMumbleBenchMaxIterations;
+    }
+
+    mumble_bench_name(bench, result->name, sizeof result->name);
+    result->iterations = iterations;
+    result->real_time = (double)state.real_ns / iterations;
+    result->cpu_time = (double)state.cpu_ns / iterations;
+    result->bytes_per_second =
+        seconds > 0 ? state.bytes * iterations / seconds : 0;
+    result->items_per_second =
+        seconds > 0 ? state.items * iterations / seconds : 0;
+
+    return 0;
+}
+
+static void mumble_bench_print_text(FILE* output,
+                                    const mumble_bench_result_t* result)
+{
+    fprintf(output, "%-44s %12.1f ns %12.1f ns %12llu", result->name,
+            result->real_time, result->cpu_time,
+            (unsigned long long)result->iterations);
+
+    if (result->items_per_second > 0)
+        fprintf(output, " %10.3fM items/s", result->items_per_second / 1e6);
+
+    if (result->bytes_per_second > 0)
+        fprintf(output, " %10.3f MiB/s",
+                result->bytes_per_second / (1024 * 1024));
+
+    fputc('\n', output);
+}
+
+static void mumble_bench_print_json_context(FILE* output, const char* program)
+{
+    char date[64];
+    time_t now = time(NULL);
+
+    strftime(date, sizeof date, "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+
+    fprintf(output, "{\n  \"context\": {\n");
+    fprintf(output, "    \"date\": \"%s\",\n", date);
+    fprintf(output, "    \"executable\": \"%s\",\n", program);
+    fprintf(output, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+#ifdef MUMBLE_BENCH_REVISION
+    fprintf(output, "    \"revision\": \"%s\",\n", MUMBLE_BENCH_REVISION);
+#endif
+#ifdef NDEBUG
+    fprintf(output, "    \"library_build_type\": \"release\"\n");
+#else
+    fprintf(output, "    \"library_build_type\": \"debug\"\n");
+#endif
+    fprintf(output, "  },\n  \"benchmarks\": [");
+}
+
+static void mumble_bench_print_json(FILE* output,
+                                    const mumble_bench_result_t* result,
+                                    int first)
+{
+    fprintf(output, "%s\n    {\n", first ? "" : ",");
+    fprintf(output, "      \"name\": \"%s\",\n", result->name);
+    fprintf(output, "      \"run_name\": \"%s\",\n", result->name);
+    fprintf(output, "      \"run_type\": \"iteration\",\n");
+    fprintf(output, "      \"iterations\": %llu,\n",
+            (unsigned long long)result->iterations);
+    fprintf(output, "      \"real_time\": %.3f,\n", result->real_time);
+    fprintf(output, "      \"cpu_time\": %.3f,\n", result->cpu_time);
+
+    if (result->bytes_per_second > 0)
+        fprintf(output, "      \"bytes_per_second\": %.3f,\n",
+                result->bytes_per_second);
+
+    if (result->items_per_second > 0)
+        fprintf(output, "      \"items_per_second\": %.3f,\n",
+                result->items_per_second);
+
+    fprintf(output, "      \"time_unit\": \"ns\"\n    }");
+}
+
+static void mumble_bench_usage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --filter=TEXT     only run benchmarks with TEXT in their name\n"
+            "  --json[=FILE]     write JSON results to FILE, or to stdout\n"
+            "  --min-time=SECS   run each benchmark for at least SECS\n"
+            "  --list            list the benchmarks and exit\n",
+            program);
+}
+
+int main(int argc, char** argv)
+{
+    int i, first = 1, failed = 0, list = 0, json = 0;
+    const char* filter = NULL;
+    const char* json_path = NULL;
+    double min_time = kMumbleBenchMinTime;
+    const mumble_bench_t* bench;
+    mumble_bench_result_t result;
+    FILE* json_output = NULL;
+    FILE* text_output = stdout;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--filter=", 9) == 0)
+            filter = argv[i] + 9;
+        else if (strcmp(argv[i], "--json") == 0)
+            json = 1;
+        else if (strncmp(argv[i], "--json=", 7) == 0)
+            json = 1, json_path = argv[i] + 7;
+        else if (strncmp(argv[i], "--min-time=", 11) == 0)
+            min_time = atof(argv[i] + 11);
+        else if (strcmp(argv[i], "--list") == 0)
+            list = 1;
+        else
+        {
+            mumble_bench_usage(argv[0]);
+
+            return 1;
+        }
+    }
+
+    if (list)
+    {
+        for (bench = g_mumble_benchmarks; bench->name; bench++)
+        {
+            mumble_bench_name(bench, result.name, sizeof result.name);
+            puts(result.name);
+        }
+
+        return 0;
+    }
+
+    if (json)
+    {
+        if (json_path)
+        {
+            if ((json_output = fopen(json_path, "w")) == NULL)
+            {
+                perror(json_path);
+
+                return 1;
+            }
+        }
+        else
+        {
+            /* Keep stdout clean for the JSON output. */
+            json_output = stdout;
+            text_output = stderr;
+        }
+
+        mumble_bench_print_json_context(json_output, argv[0]);
+    }
+
+    fprintf(text_output, "%-44s %15s %15s %12s\n", "Benchmark", "Time", "CPU",
+            "Iterations");
+
+    for (bench = g_mumble_benchmarks; bench->name; bench++)
+    {
+        mumble_bench_name(bench, result.name, sizeof result.name);
+
+        if (filter && !strstr(result.name, filter))
+            continue;
+
+        if (mumble_bench_run(bench, min_time, &result) != 0)
+        {
+            fprintf(stderr, "%s failed\n", result.name);
+            failed = 1;
+
+            continue;
+        }
+
+        mumble_bench_print_text(text_output, &result);
+
+        if (json_output)
+        {
+            mumble_bench_print_json(json_output, &result, first);
+            first = 0;
+        }
+    }
+
+    if (json_output)
+    {
+        fprintf(json_output, "\n  ]\n}\n");
+
+        if (json_output != stdout)
+            fclose(json_output);
+    }
+
+    return failed;
+}
@@ -0,0 +1,116 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file bench.h
+ * @brief A small harness for micro-benchmarks of the library internals.
+ *
+ * A benchmark is a function that is handed a number of iterations to run. It
+ * does its setup, calls `mumble_bench_resume` right before the measured loop
+ * and `mumble_bench_pause` right after it, and then tears down. The harness
+ * grows the number of iterations until a run takes long enough to measure and
+ * reports the time per iteration, as text or as JSON in the format of Google
+ * Benchmark so that results of different commits can be compared with its
+ * tools.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_BENCH_H
+#define MUMBLE_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The state of a single benchmark run.
+ */
+typedef struct mumble_bench_state_t
+{
+    /** The number of iterations to run. */
+    uint64_t iterations;
+    /** The argument of the benchmark, such as a size or a count. */
+    size_t arg;
+    /** The number of bytes processed by each iteration, if any. */
+    uint64_t bytes;
+    /** The number of items processed by each iteration, if any. */
+    uint64_t items;
+    /** Non-zero if the benchmark failed. */
+    int failed;
+    /** The wall clock time measured so far, in nanoseconds. */
+    uint64_t real_ns;
+    /** The CPU time measured so far, in nanoseconds. */
+    uint64_t cpu_ns;
+    /** The wall clock time when measuring was resumed. */
+    uint64_t real_start;
+    /** The CPU time when measuring was resumed. */
+    uint64_t cpu_start;
+} mumble_bench_state_t;
+
+/**
+ * A benchmark function.
+ */
+typedef void (*mumble_bench_func_t)(mumble_bench_state_t* state);
+
+/**
+ * A registered benchmark.
+ */
+typedef struct mumble_bench_t
+{
+    /** The name of the benchmark, e.g. `buffer/write_read`. */
+    const char* name;
+    /** The function to run. */
+    mumble_bench_func_t func;
+    /** The argument passed in the state, appended to the name if non-zero. */
+    size_t arg;
+} mumble_bench_t;
+
+/**
+ * The benchmarks to run, terminated by an entry with a NULL name.
+ */
+extern const mumble_bench_t g_mumble_benchmarks[];
+
+/**
+ * Start or resume measuring time.
+ */
+void mumble_bench_resume(mumble_bench_state_t* state);
+
+/**
+ * Stop measuring time, e.g. to exclude setup inside the benchmark.
+ */
+void mumble_bench_pause(mumble_bench_state_t* state);
+
+/**
+ * Mark a benchmark as failed, e.g. if its setup couldn't be done.
+ */
+void mumble_bench_fail(mumble_bench_state_t* state, const char* reason);
+
+/**
+ * Keep the compiler from optimizing away a value that is otherwise unused.
+ */
+#define MUMBLE_BENCH_KEEP(value)                                               \
+    __asm__ __volatile__("" : : "g"(value) : "memory")
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_BENCH_H */
@@ -0,0 +1,740 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include <mumble/user.h>
+#include <mumble/channel.h>
+#include "Mumble.pb-c.h"
+#include "protocol.h"
+#include "buffer.h"
+#include "iserver.h"
+#include "internal.h"
+#include "clock.h"
+#include "bench.h"
+#include "fixture.h"
+
+/**
+ * The size of a synthetic voice packet, about that of a 20 ms Opus frame.
+ */
+#define MUMBLE_BENCH_VOICE_SIZE 72
+
+/**
+ * The number of channels synthetic users are spread over.
+ */
+static const uint32_t kMumbleBenchChannels = 16;
+
+/**
+ * Storage for a sample message of any of the types the benchmarks use.
+ */
+typedef struct mumble_bench_message_t
+{
+    union
+    {
+        MumbleProto__Version version;
+        MumbleProto__Ping ping;
+        MumbleProto__Reject reject;
+        MumbleProto__ServerSync server_sync;
+        MumbleProto__ChannelRemove channel_remove;
+        MumbleProto__ChannelState channel_state;
+        MumbleProto__UserRemove user_remove;
+        MumbleProto__UserState user_state;
+        MumbleProto__TextMessage text_message;
+        MumbleProto__PermissionDenied permission_denied;
+        MumbleProto__CryptSetup crypt_setup;
+        MumbleProto__CodecVersion codec_version;
+    } u;
+    char name[32];
+    uint32_t channel_id;
+    uint8_t key[16];
+} mumble_bench_message_t;
+
+/**
+ * Fill in a typical message of a packet type.
+ *
+ * @param[out] message the storage to fill in.
+ * @param[in]  type    the packet type.
+ * @param[in]  id      the session or channel id the message is about.
+ *
+ * @returns a pointer to the message, or NULL if the type has no sample.
+ */
+static const void* mumble_bench_message(mumble_bench_message_t* message,
+                                        mumble_packet_type_t type, uint32_t id)
+{
+    memset(message->key, 0xa5, sizeof message->key);
+    snprintf(message->name, sizeof message->name, "user-%u", id);
+
+    switch (type)
+    {
+        case MUMBLE_PACKET_VERSION:
+        {
+            MumbleProto__Version version = MUMBLE_PROTO__VERSION__INIT;
+
+            version.has_version = 1;
+            version.version = 0x010204;
+            version.release = "1.2.19";
+            version.os = "Linux";
+            version.os_version = "Ubuntu 22.04.4 LTS [x64]";
+            message->u.version = version;
+
+            return &message->u.version;
+        }
+        case MUMBLE_PACKET_PING:
+        {
+            MumbleProto__Ping ping = MUMBLE_PROTO__PING__INIT;
+
+            ping.has_timestamp = 1;
+            ping.timestamp = mumble_clock_us();
+            ping.has_good = ping.has_late = ping.has_lost = 1;
+            ping.good = 4096;
+            ping.late = 12;
+            ping.lost = 3;
+            ping.has_tcp_packets = ping.has_tcp_ping_avg = 1;
+            ping.tcp_packets = 512;
+            ping.tcp_ping_avg = 23.5f;
+            message->u.ping = ping;
+
+            return &message->u.ping;
+        }
+        case MUMBLE_PACKET_REJECT:
+        {
+            MumbleProto__Reject reject = MUMBLE_PROTO__REJECT__INIT;
+
+            reject.has_type = 1;
+            reject.type =
+                (MumbleProto__Reject__RejectType)MUMBLE_REJECT_SERVER_FULL;
+            reject.reason = "Server is full";
+            message->u.reject = reject;
+
+            return &message->u.reject;
+        }
+        case MUMBLE_PACKET_SERVER_SYNC:
+        {
+            MumbleProto__ServerSync server_sync =
+                MUMBLE_PROTO__SERVER_SYNC__INIT;
+
+            server_sync.has_session = 1;
+            server_sync.session = id;
+            server_sync.has_max_bandwidth = 1;
+            server_sync.max_bandwidth = 72000;
+            server_sync.welcome_text = "Welcome to this Murmur server.";
+            server_sync.has_permissions = 1;
+            server_sync.permissions = 0xf07ff;
+            message->u.server_sync = server_sync;
+
+            return &message->u.server_sync;
+        }
+        case MUMBLE_PACKET_CHANNEL_REMOVE:
+        {
+            MumbleProto__ChannelRemove channel_remove =
+                MUMBLE_PROTO__CHANNEL_REMOVE__INIT;
+
+            channel_remove.channel_id = id;
+            message->u.channel_remove = channel_remove;
+
+            return &message->u.channel_remove;
+        }
+        case MUMBLE_PACKET_CHANNEL_STATE:
+        {
+            MumbleProto__ChannelState channel_state =
+                MUMBLE_PROTO__CHANNEL_STATE__INIT;
+
+            snprintf(message->name, sizeof message->name, "Channel %u", id);
+            channel_state.has_channel_id = 1;
+            channel_state.channel_id = id;
+            channel_state.has_parent = id != 0;
+            channel_state.parent = 0;
+            channel_state.name = message->name;
+            channel_state.has_position = 1;
+            channel_state.position = (int32_t)id;
+            message->u.channel_state = channel_state;
+
+            return &message->u.channel_state;
+        }
+        case MUMBLE_PACKET_USER_REMOVE:
+        {
+            MumbleProto__UserRemove user_remove =
+                MUMBLE_PROTO__USER_REMOVE__INIT;
+
+            user_remove.session = id;
+            message->u.user_remove = user_remove;
+
+            return &message->u.user_remove;
+        }
+        case MUMBLE_PACKET_USER_STATE:
+        {
+            MumbleProto__UserState user_state = MUMBLE_PROTO__USER_STATE__INIT;
+
+            user_state.has_session = 1;
+            user_state.session = id;
+            user_state.name = message->name;
+            user_state.has_user_id = 1;
+            user_state.user_id = id;
+            user_state.has_channel_id = 1;
+            user_state.channel_id = id % kMumbleBenchChannels;
+            user_state.has_self_mute = 1;
+            user_state.self_mute = id & 1;
+            user_state.hash = "d1b48e0c9a0f0eb2f3bc1e7e1d7cbe3a9a1f2c44";
+            message->u.user_state = user_state;
+
+            return &message->u.user_state;
+        }
+        case MUMBLE_PACKET_TEXT_MESSAGE:
+        {
+            MumbleProto__TextMessage text_message =
+                MUMBLE_PROTO__TEXT_MESSAGE__INIT;
+
+            message->channel_id = id % kMumbleBenchChannels;
+            text_message.has_actor = 1;
+            text_message.actor = id;
+            text_message.n_channel_id = 1;
+            text_message.channel_id = &message->channel_id;
+            text_message.message =
+                "Anyone up for a round? Meet in the lobby in five minutes.";
+            message->u.text_message = text_message;
+
+            return &message->u.text_message;
+        }
+        case MUMBLE_PACKET_PERMISSION_DENIED:
+        {
+            MumbleProto__PermissionDenied permission_denied =
+                MUMBLE_PROTO__PERMISSION_DENIED__INIT;
+
+            permission_denied.has_type = 1;
+            permission_denied.type =
+                (MumbleProto__PermissionDenied__DenyType)
+                    MUMBLE_DENY_PERMISSION;
+            permission_denied.has_permission = 1;
+            permission_denied.permission = 0x4;
+            permission_denied.has_channel_id = 1;
+            permission_denied.channel_id = id % kMumbleBenchChannels;
+            permission_denied.has_session = 1;
+            permission_denied.session = id;
+            message->u.permission_denied = permission_denied;
+
+            return &message->u.permission_denied;
+        }
+        case MUMBLE_PACKET_CRYPT_SETUP:
+        {
+            MumbleProto__CryptSetup crypt_setup =
+                MUMBLE_PROTO__CRYPT_SETUP__INIT;
+
+            crypt_setup.has_key = crypt_setup.has_client_nonce =
+                crypt_setup.has_server_nonce = 1;
+            crypt_setup.key.data = message->key;
+            crypt_setup.key.len = sizeof message->key;
+            crypt_setup.client_nonce = crypt_setup.server_nonce =
+                crypt_setup.key;
+            message->u.crypt_setup = crypt_setup;
+
+            return &message->u.crypt_setup;
+        }
+        case MUMBLE_PACKET_CODEC_VERSION:
+        {
+            MumbleProto__CodecVersion codec_version =
+                MUMBLE_PROTO__CODEC_VERSION__INIT;
+
+            codec_version.alpha = -2147483637;
+            codec_version.beta = 0;
+            codec_version.prefer_alpha = 1;
+            codec_version.has_opus = 1;
+            codec_version.opus = 1;
+            message->u.codec_version = codec_version;
+
+            return &message->u.codec_version;
+        }
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Append a typical framed packet of a packet type to a buffer.
+ *
+ * @returns the number of bytes appended, or zero on failure.
+ */
+static size_t mumble_bench_packet(mumble_buffer_t* buffer,
+                                  mumble_packet_type_t type, uint32_t id)
+{
+    const void* body;
+    mumble_bench_message_t message;
+
+    /* Voice is raw, so frame some bytes that look like an Opus packet. */
+    if (type == MUMBLE_PACKET_UDPTUNNEL)
+    {
+        uint8_t packet[MUMBLE_BENCH_VOICE_SIZE * 2];
+        size_t size = kMumbleHeaderSize + MUMBLE_BENCH_VOICE_SIZE;
+
+        memset(packet, (int)id, size);
+        packet[kMumbleHeaderSize] = 4 << 5;
+        mumble_packet_write_header(packet, type, MUMBLE_BENCH_VOICE_SIZE);
+
+        return mumble_buffer_write(buffer, packet, size);
+    }
+
+    if ((body = mumble_bench_message(&message, type, id)) == NULL)
+        return 0;
+
+    return mumble_packet_pack(buffer, type, body);
+}
+
+/**
+ * Feed a single packet to the server, as if it had just been received.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+static int mumble_bench_receive(struct mumble_server_t* server,
+                                mumble_packet_type_t type, uint32_t id)
+{
+    if (mumble_bench_packet(&server->rbuffer, type, id) == 0)
+        return 1;
+
+    return mumble_server_read_packet(server) != 1;
+}
+
+/**
+ * Write `arg` bytes to a buffer and read them back out.
+ */
+static void mumble_bench_buffer_write_read(mumble_bench_state_t* state)
+{
+    uint64_t i;
+    uint8_t* data;
+    mumble_buffer_t buffer;
+
+    if (mumble_buffer_init(&buffer) != 0 ||
+        (data = (uint8_t*)calloc(1, state->arg)) == NULL)
+    {
+        mumble_bench_fail(state, "out of memory");
+
+        return;
+    }
+
+    state->bytes = state->arg;
+
+    mumble_bench_resume(state);
+
+    for (i = 0; i < state->iterations; i++)
+    {
+        mumble_buffer_write(&buffer, data, state->arg);
+        mumble_buffer_read(&buffer, data, state->arg);
+    }
+
+    mumble_bench_pause(state);
+
+    free(data);
+    free(buffer.ptr);
+}
+
+/**
+ * Write 16 chunks of `arg` bytes to a buffer and read them back one by one,
+ * like a burst of packets received in a single TLS read.
+ */
+static void mumble_bench_buffer_fill_drain(mumble_bench_state_t* state)
+{
+    int j;
+    uint64_t i;
+    uint8_t* data;
+    mumble_buffer_t buffer;
+
+    if (mumble_buffer_init(&buffer) != 0 ||
+        (data = (uint8_t*)calloc(16, state->arg)) == NULL)
+    {
+        mumble_bench_fail(state, "out of memory");
+
+        return;
+    }
+
+    state->bytes = 16 * state->arg;
+    state->items = 16;
+
+    mumble_bench_resume(state);
+
+    for (i = 0; i < state->iterations; i++)
+    {
+        mumble_buffer_write(&buffer, data, 16 * state->arg);
+
+        for (j = 0; j < 16; j++)
+            mumble_buffer_read(&buffer, data, state->arg);
+    }
+
+    mumble_bench_pause(state);
+
+    free(data);
+    free(buffer.ptr);
+}
+
+/**
+ * Cut a burst of `arg` packets of the given types, cycled through, out of the
+ * read buffer and handle them.
+ */
+static void mumble_bench_framing(mumble_bench_state_t* state,
+                                 const mumble_packet_type_t* types,
+                                 size_t num_types)
+{
+    size_t j;
+    uint64_t i, handled = 0;
+    mumble_buffer_t burst;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+
+    if (mumble_bench_fixture_init(&fixture) != 0 ||
+        mumble_buffer_init(&burst) != 0)
+    {
+        mumble_bench_fail(state, "could not set up fixture");
+        mumble_bench_fixture_free(&fixture);
+
+        return;
+    }
+
+    server = fixture.server;
+
+    for (j = 0; j < state->arg; j++)
+        mumble_bench_packet(&burst, types[j % num_types],
+                            (uint32_t)(j % 64) + 1);
+
+    state->bytes = burst.size;
+    state->items = state->arg;
+
+    mumble_bench_resume(state);
+
+    for (i = 0; i < state->iterations; i++)
+    {
+        mumble_buffer_write(&server->rbuffer, burst.ptr, burst.size);
+
+        while (mumble_server_read_packet(server) > 0)
+            handled++;
+    }
+
+    mumble_bench_pause(state);
+
+    if (handled != state->iterations * state->arg)
+        mumble_bench_fail(state, "not all packets were handled");
+
+    free(burst.ptr);
+    mumble_bench_fixture_free(&fixture);
+}
+
+static void mumble_bench_framing_ping(mumble_bench_state_t* state)
+{
+    static const mumble_packet_type_t kTypes[] = {MUMBLE_PACKET_PING};
+
+    mumble_bench_framing(state, kTypes, 1);
+}
+
+static void mumble_bench_framing_voice(mumble_bench_state_t* state)
+{
+    static const mumble_packet_type_t kTypes[] = {MUMBLE_PACKET_UDPTUNNEL};
+
+    mumble_bench_framing(state, kTypes, 1);
+}
+
+/**
+ * A mix weighted towards voice, as on a busy server.
+ */
+static void mumble_bench_framing_mixed(mumble_bench_state_t* state)
+{
+    static const mumble_packet_type_t kTypes[] = {
+        MUMBLE_PACKET_UDPTUNNEL,    MUMBLE_PACKET_UDPTUNNEL,
+        MUMBLE_PACKET_USER_STATE,   MUMBLE_PACKET_UDPTUNNEL,
+        MUMBLE_PACKET_TEXT_MESSAGE, MUMBLE_PACKET_UDPTUNNEL,
+        MUMBLE_PACKET_PING,         MUMBLE_PACKET_UDPTUNNEL};
+
+    mumble_bench_framing(state, kTypes, sizeof kTypes / sizeof *kTypes);
+}
+
+/**
+ * Handle the same packet over and over.
+ *
+ * Removing a user or channel only does work if it exists, so those are added
+ * back before each packet and the time includes adding them.
+ */
+static void mumble_bench_handler(mumble_bench_state_t* state,
+                                 mumble_packet_type_t type)
+{
+    uint64_t i;
+    uint32_t length;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+
+    if (mumble_bench_fixture_init(&fixture) != 0 ||
+        mumble_bench_packet(&fixture.server->rbuffer, type, 1) == 0)
+    {
+        mumble_bench_fail(state, "could not set up fixture");
+        mumble_bench_fixture_free(&fixture);
+
+        return;
+    }
+
+    server = fixture.server;
+    length = (uint32_t)(server->rbuffer.size - kMumbleHeaderSize);
+    state->bytes = server->rbuffer.size;
+    state->items = 1;
+
+    mumble_bench_resume(state);
+
+    for (i = 0; i < state->iterations; i++)
+    {
+        if (type == MUMBLE_PACKET_USER_REMOVE)
+            mumble_server_add_user(server, 1);
+        else if (type == MUMBLE_PACKET_CHANNEL_REMOVE)
+            mumble_server_add_channel(server, 1);
+
+        if (!mumble_server_handle_packet(server, type, length))
+            break;
+    }
+
+    mumble_bench_pause(state);
+
+    if (i != state->iterations)
+        mumble_bench_fail(state, "packet was not handled");
+
+    mumble_bench_fixture_free(&fixture);
+}
+
+#define MUMBLE_BENCH_HANDLER(name, type)                                       \
+    static void mumble_bench_handle_##name(mumble_bench_state_t* state)        \
+    {                                                                          \
+        mumble_bench_handler(state, type);                                     \
+    }
+
+MUMBLE_BENCH_HANDLER(version, MUMBLE_PACKET_VERSION)
+MUMBLE_BENCH_HANDLER(udp_tunnel, MUMBLE_PACKET_UDPTUNNEL)
+MUMBLE_BENCH_HANDLER(ping, MUMBLE_PACKET_PING)
+MUMBLE_BENCH_HANDLER(reject, MUMBLE_PACKET_REJECT)
+MUMBLE_BENCH_HANDLER(server_sync, MUMBLE_PACKET_SERVER_SYNC)
+MUMBLE_BENCH_HANDLER(channel_remove, MUMBLE_PACKET_CHANNEL_REMOVE)
+MUMBLE_BENCH_HANDLER(channel_state, MUMBLE_PACKET_CHANNEL_STATE)
+MUMBLE_BENCH_HANDLER(user_remove, MUMBLE_PACKET_USER_REMOVE)
+MUMBLE_BENCH_HANDLER(user_state, MUMBLE_PACKET_USER_STATE)
+MUMBLE_BENCH_HANDLER(text_message, MUMBLE_PACKET_TEXT_MESSAGE)
+MUMBLE_BENCH_HANDLER(permission_denied, MUMBLE_PACKET_PERMISSION_DENIED)
+MUMBLE_BENCH_HANDLER(crypt_setup, MUMBLE_PACKET_CRYPT_SETUP)
+MUMBLE_BENCH_HANDLER(codec_version, MUMBLE_PACKET_CODEC_VERSION)
+
+#undef MUMBLE_BENCH_HANDLER
+
+/**
+ * Encode and queue the same message over and over.
+ */
+static void mumble_bench_send(mumble_bench_state_t* state,
+                              mumble_packet_type_t type)
+{
+    uint64_t i;
+    void* message;
+    mumble_bench_message_t storage;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+
+    if (mumble_bench_fixture_init(&fixture) != 0 ||
+        (message = (void*)mumble_bench_message(&storage, type, 1)) == NULL)
+    {
+        mumble_bench_fail(state, "could not set up fixture");
+        mumble_bench_fixture_free(&fixture);
+
+        return;
+    }
+
+    server = fixture.server;
+    state->bytes = kMumbleHeaderSize + mumble_packet_size_packed(type, message);
+    state->items = 1;
+
+    mumble_bench_resume(state);
+
+    for (i = 0; i < state->iterations; i++)
+    {
+        if (mumble_server_send(server, type, message) != 1)
+            break;
+
+        mumble_bench_drain(server);
+    }
+
+    mumble_bench_pause(state);
+
+    if (i != state->iterations)
+        mumble_bench_fail(state, "message was not queued");
+
+    mumble_bench_fixture_free(&fixture);
+}
+
+#define MUMBLE_BENCH_SEND(name, type)                                          \
+    static void mumble_bench_send_##name(mumble_bench_state_t* state)          \
+    {                                                                          \
+        mumble_bench_send(state, type);                                        \
+    }
+
+MUMBLE_BENCH_SEND(version, MUMBLE_PACKET_VERSION)
+MUMBLE_BENCH_SEND(ping, MUMBLE_PACKET_PING)
+MUMBLE_BENCH_SEND(user_state, MUMBLE_PACKET_USER_STATE)
+MUMBLE_BENCH_SEND(text_message, MUMBLE_PACKET_TEXT_MESSAGE)
+
+#undef MUMBLE_BENCH_SEND
+
+/**
+ * The kinds of lookups.
+ */
+typedef enum mumble_bench_lookup_t
+{
+    MUMBLE_BENCH_LOOKUP_SESSION,
+    MUMBLE_BENCH_LOOKUP_NAME,
+    MUMBLE_BENCH_LOOKUP_CHANNEL
+} mumble_bench_lookup_t;
+
+/**
+ * Look up `arg` users or channels, received from the server, in a shuffled
+ * order.
+ */
+static void mumble_bench_lookup(mumble_bench_state_t* state,
+                                mumble_bench_lookup_t lookup)
+{
+    size_t j, k, n = state->arg;
+    uint32_t* ids, swap, seed = 0x9e3779b9;
+    char (*names)[32] = NULL;
+    uint64_t i, missing = 0;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+    mumble_packet_type_t type = lookup == MUMBLE_BENCH_LOOKUP_CHANNEL
+                                    ? MUMBLE_PACKET_CHANNEL_STATE
+                                    : MUMBLE_PACKET_USER_STATE;
+
+    ids = (uint32_t*)malloc(n * sizeof *ids);
+    names = (char(*)[32])malloc(n * sizeof *names);
+
+    if (mumble_bench_fixture_init(&fixture) != 0 || !ids || !names)
+    {
+        mumble_bench_fail(state, "could not set up fixture");
+        mumble_bench_fixture_free(&fixture);
+        free(ids);
+        free(names);
+
+        return;
+    }
+
+    server = fixture.server;
+
+    for (j = 0; j < n; j++)
+    {
+        ids[j] = (uint32_t)j + 1;
+
+        if (mumble_bench_receive(server, type, ids[j]) != 0)
+        {
+            mumble_bench_fail(state, "could not populate server");
+            break;
+        }
+    }
+
+    /* Shuffle the ids so that lookups don't walk memory in order. */
+    for (j = n; j > 1; j--)
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        k = seed % j;
+        swap = ids[j - 1];
+        ids[j - 1] = ids[k];
+        ids[k] = swap;
+    }
+
+    for (j = 0; j < n; j++)
+        snprintf(names[j], sizeof names[j], "user-%u", ids[j]);
+
+    state->items = 1;
+
+    mumble_bench_resume(state);
+
+    for (i = 0, j = 0; i < state->iterations && !state->failed; i++)
+    {
+        const void* result;
+
+        if (lookup == MUMBLE_BENCH_LOOKUP_SESSION)
+            result = mumble_server_find_user(server, ids[j]);
+        else if (lookup == MUMBLE_BENCH_LOOKUP_NAME)
+            result = mumble_server_get_user_by_name(server, names[j]);
+        else
+            result = mumble_server_find_channel(server, ids[j]);
+
+        missing += result == NULL;
+
+        if (++j == n)
+            j = 0;
+    }
+
+    mumble_bench_pause(state);
+
+    if (missing)
+        mumble_bench_fail(state, "lookup missed");
+
+    free(ids);
+    free(names);
+    mumble_bench_fixture_free(&fixture);
+}
+
+static void mumble_bench_lookup_session(mumble_bench_state_t* state)
+{
+    mumble_bench_lookup(state, MUMBLE_BENCH_LOOKUP_SESSION);
+}
+
+static void mumble_bench_lookup_name(mumble_bench_state_t* state)
+{
+    mumble_bench_lookup(state, MUMBLE_BENCH_LOOKUP_NAME);
+}
+
+static void mumble_bench_lookup_channel(mumble_bench_state_t* state)
+{
+    mumble_bench_lookup(state, MUMBLE_BENCH_LOOKUP_CHANNEL);
+}
+
+const mumble_bench_t g_mumble_benchmarks[] = {
+    {"buffer/write_read", mumble_bench_buffer_write_read, 64},
+    {"buffer/write_read", mumble_bench_buffer_write_read, 1024},
+    {"buffer/write_read", mumble_bench_buffer_write_read, 8192},
+    {"buffer/fill_drain", mumble_bench_buffer_fill_drain, 64},
+    {"buffer/fill_drain", mumble_bench_buffer_fill_drain, 1024},
+    {"framing/ping", mumble_bench_framing_ping, 256},
+    {"framing/voice", mumble_bench_framing_voice, 256},
+    {"framing/mixed", mumble_bench_framing_mixed, 256},
+    {"handler/version", mumble_bench_handle_version, 0},
+    {"handler/udp_tunnel", mumble_bench_handle_udp_tunnel, 0},
+    {"handler/ping", mumble_bench_handle_ping, 0},
+    {"handler/reject", mumble_bench_handle_reject, 0},
+    {"handler/server_sync", mumble_bench_handle_server_sync, 0},
+    {"handler/channel_remove", mumble_bench_handle_channel_remove, 0},
+    {"handler/channel_state", mumble_bench_handle_channel_state, 0},
+    {"handler/user_remove", mumble_bench_handle_user_remove, 0},
+    {"handler/user_state", mumble_bench_handle_user_state, 0},
+    {"handler/text_message", mumble_bench_handle_text_message, 0},
+    {"handler/permission_denied", mumble_bench_handle_permission_denied, 0},
+    {"handler/crypt_setup", mumble_bench_handle_crypt_setup, 0},
+    {"handler/codec_version", mumble_bench_handle_codec_version, 0},
+    {"send/version", mumble_bench_send_version, 0},
+    {"send/ping", mumble_bench_send_ping, 0},
+    {"send/user_state", mumble_bench_send_user_state, 0},
+    {"send/text_message", mumble_bench_send_text_message, 0},
+    {"lookup/user_session", mumble_bench_lookup_session, 10},
+    {"lookup/user_session", mumble_bench_lookup_session, 1000},
+    {"lookup/user_session", mumble_bench_lookup_session, 10000},
+    {"lookup/user_name", mumble_bench_lookup_name, 10},
+    {"lookup/user_name", mumble_bench_lookup_name, 1000},
+    {"lookup/user_name", mumble_bench_lookup_name, 10000},
+    {"lookup/channel", mumble_bench_lookup_channel, 10},
+    {"lookup/channel", mumble_bench_lookup_channel, 1000},
+    {"lookup/channel", mumble_bench_lookup_channel, 10000},
+    {NULL, NULL, 0}};
@@ -0,0 +1,126 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include "iserver.h"
+#include "internal.h"
+#include "bench.h"
+#include "fixture.h"
+
+static int mumble_bench_on_voice(struct mumble_server_t* server,
+                                 const uint8_t* packet, size_t length)
+{
+    (void)server;
+    MUMBLE_BENCH_KEEP(packet);
+    MUMBLE_BENCH_KEEP(length);
+
+    return 0;
+}
+
+static int mumble_bench_on_text_message(struct mumble_server_t* server,
+                                        const mumble_text_message_t* message)
+{
+    (void)server;
+    MUMBLE_BENCH_KEEP(message);
+
+    return 0;
+}
+
+static int
+mumble_bench_on_permission_denied(struct mumble_server_t* server,
+                                  const mumble_permission_denied_t* event)
+{
+    (void)server;
+    MUMBLE_BENCH_KEEP(event);
+
+    return 0;
+}
+
+void mumble_bench_fixture_free(mumble_bench_fixture_t* fixture)
+{
+    /* The server is freed along with the client. */
+    if (fixture->client)
+        mumble_free(fixture->client);
+
+    if (fixture->fds[0] >= 0)
+    {
+        close(fixture->fds[0]);
+        close(fixture->fds[1]);
+    }
+}
+
+int mumble_bench_fixture_init(mumble_bench_fixture_t* fixture)
+{
+    struct mumble_t* client;
+    struct mumble_server_t* server;
+    struct mumble_callback_t callbacks = MUMBLE_CALLBACK_INIT;
+    mumble_settings_t settings;
+
+    memset(&settings, 0, sizeof settings);
+    memset(fixture, 0, sizeof *fixture);
+    fixture->fds[0] = fixture->fds[1] = -1;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fixture->fds) != 0)
+        return 1;
+
+    /* Only fatal errors, unless asked otherwise, so that what gets measured
+     * is the handlers and not the formatting of their messages. */
+    if (!getenv("LIBMUMBLE_LOG"))
+        mumble_set_log_level(NULL, 1);
+
+    /* A client without a certificate, since nothing is ever connected. */
+    if ((client = mumble_new(settings)) == NULL)
+        return 1;
+
+    fixture->client = client;
+
+    if ((server = mumble_server_new("bench.invalid", 64738)) == NULL)
+        return 1;
+
+    mumble_attach(client, server);
+    server->fd = fixture->fds[0];
+    fixture->server = server;
+
+    ev_io_init(&server->watcher, mumble_server_callback, server->fd, EV_READ);
+    server->watcher.data = server;
+
+    /* Handlers of packets nobody listens for are skipped, so listen for all
+     * of them. */
+    callbacks.on_voice = mumble_bench_on_voice;
+    callbacks.on_text_message = mumble_bench_on_text_message;
+    callbacks.on_permission_denied = mumble_bench_on_permission_denied;
+    mumble_server_set_callbacks(server, &callbacks);
+
+    return 0;
+}
+
+void mumble_bench_drain(struct mumble_server_t* server)
+{
+    int lane;
+    mumble_segment_t* segment;
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        while ((segment = mumble_write_queue_pop(&server->lanes[lane])))
+            mumble_segment_unref(segment);
+}
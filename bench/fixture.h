@@ -0,0 +1,70 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file fixture.h
+ * @brief A client and server that packets can be fed to without a connection.
+ */
+
+#pragma once
+#ifndef MUMBLE_BENCH_FIXTURE_H
+#define MUMBLE_BENCH_FIXTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct mumble_t;
+struct mumble_server_t;
+
+/**
+ * A client with a single server that is never connected.
+ *
+ * The server is attached to the client the same way `mumble_connect` does,
+ * and its watcher is set up on one end of a socket pair so that queueing
+ * packets works, but the event loop is never run and nothing is written.
+ */
+typedef struct mumble_bench_fixture_t
+{
+    struct mumble_t* client;
+    struct mumble_server_t* server;
+    int fds[2];
+} mumble_bench_fixture_t;
+
+/**
+ * Set up a client and a server without TLS or a connection.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_bench_fixture_init(mumble_bench_fixture_t* fixture);
+
+/**
+ * Free a fixture, including one that failed to be set up.
+ */
+void mumble_bench_fixture_free(mumble_bench_fixture_t* fixture);
+
+/**
+ * Drop everything queued for sending.
+ */
+void mumble_bench_drain(struct mumble_server_t* server);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_BENCH_FIXTURE_H */
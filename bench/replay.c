@@ -0,0 +1,287 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/*
+ * Feed a capture recorded with `mumble_server_set_capture` back through the
+ * packet handlers of a server that isn't connected, without sockets or TLS,
+ * either as fast as possible or at the pace it was recorded at.
+ *
+ * The capture is loaded into memory up front so that reading it doesn't
+ * show up in profiles. Anything the handlers queue for sending is dropped.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <mumble/mumble.h>
+#include "buffer.h"
+#include "capture.h"
+#include "clock.h"
+#include "iserver.h"
+#include "internal.h"
+#include "fixture.h"
+
+/**
+ * A capture loaded into memory.
+ */
+typedef struct mumble_replay_t
+{
+    /** The packets, back to back. */
+    uint8_t* packets;
+    /** The number of bytes in `packets`. */
+    size_t size;
+    /** The capacity of `packets`, in bytes. */
+    size_t size_capacity;
+    /** The time of each packet since the start of the capture. */
+    uint64_t* times;
+    /** The number of packets. */
+    size_t count;
+    /** The capacity of `times`. */
+    size_t capacity;
+} mumble_replay_t;
+
+/**
+ * Append a packet to a loaded capture, growing it as needed. Unlike a
+ * `mumble_buffer_t`, this isn't capped, as captures can be of any size.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+static int mumble_replay_append(mumble_replay_t* replay,
+                                const mumble_capture_record_t* record)
+{
+    if (replay->count == replay->capacity)
+    {
+        size_t capacity = replay->capacity ? replay->capacity * 2 : 1024;
+        uint64_t* times =
+            (uint64_t*)realloc(replay->times, capacity * sizeof *times);
+
+        if (!times)
+            return 1;
+
+        replay->times = times;
+        replay->capacity = capacity;
+    }
+
+    if (replay->size_capacity - replay->size < record->size)
+    {
+        size_t capacity =
+            replay->size_capacity ? replay->size_capacity : 64 * 1024;
+        uint8_t* packets;
+
+        while (capacity - replay->size < record->size)
+            capacity *= 2;
+
+        if ((packets = (uint8_t*)realloc(replay->packets, capacity)) == NULL)
+            return 1;
+
+        replay->packets = packets;
+        replay->size_capacity = capacity;
+    }
+
+    memcpy(replay->packets + replay->size, record->data, record->size);
+    replay->size += record->size;
+    replay->times[replay->count++] = record->time;
+
+    return 0;
+}
+
+/**
+ * Load all packets of a capture.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+static int mumble_replay_load(mumble_replay_t* replay, const char* path)
+{
+    mumble_capture_reader_t reader;
+    mumble_capture_record_t record;
+
+    memset(replay, 0, sizeof *replay);
+
+    if (mumble_capture_reader_open(&reader, path) != 0)
+    {
+        fprintf(stderr, "%s: not a capture file\n", path);
+
+        return 1;
+    }
+
+    while (mumble_capture_read(&reader, &record) == 0)
+    {
+        if (mumble_replay_append(replay, &record) != 0)
+        {
+            fprintf(stderr, "%s: out of memory after %zu packets\n", path,
+                    replay->count);
+            break;
+        }
+    }
+
+    if (reader.error)
+        fprintf(stderr, "%s: truncated after %zu packets\n", path,
+                replay->count);
+
+    mumble_capture_reader_close(&reader);
+
+    return replay->count == 0;
+}
+
+/**
+ * Sleep until the given time on the clock of `mumble_clock_us`.
+ */
+static void mumble_replay_sleep_until(uint64_t time)
+{
+    struct timespec ts;
+    uint64_t now = mumble_clock_us();
+
+    if (now >= time)
+        return;
+
+    ts.tv_sec = (time_t)((time - now) / 1000000);
+    ts.tv_nsec = (long)((time - now) % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Feed all packets of a capture to a server.
+ *
+ * @returns the number of packets that were handled.
+ */
+static size_t mumble_replay_run(const mumble_replay_t* replay,
+                                struct mumble_server_t* server, int realtime)
+{
+    int result;
+    size_t i, size, offset = 0, handled = 0;
+    const uint8_t* packets = replay->packets;
+    uint64_t started = mumble_clock_us();
+
+    for (i = 0; i < replay->count; i++)
+    {
+        /* The size of each packet is in its header. */
+        size = kMumbleHeaderSize +
+               ((size_t)packets[offset + 2] << 24 |
+                (size_t)packets[offset + 3] << 16 |
+                (size_t)packets[offset + 4] << 8 | packets[offset + 5]);
+
+        if (realtime)
+            mumble_replay_sleep_until(started + replay->times[i]);
+
+        mumble_buffer_write(&server->rbuffer, packets + offset, size);
+        offset += size;
+
+        while ((result = mumble_server_read_packet(server)) > 0)
+            handled++;
+
+        /* A connection would be closed here. Drop the packet instead, so the
+         * rest of the capture is still replayed. */
+        if (result < 0)
+            mumble_buffer_read(&server->rbuffer, NULL, server->rbuffer.size);
+
+        mumble_bench_drain(server);
+    }
+
+    return handled;
+}
+
+static void mumble_replay_usage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [options] FILE\n"
+            "  -r        replay at the pace the capture was recorded at\n"
+            "  -n COUNT  replay the capture COUNT times (default 1)\n"
+            "  -m        print the metrics of the server afterwards\n",
+            program);
+}
+
+int main(int argc, char** argv)
+{
+    int i, option, loops = 1, realtime = 0, metrics = 0;
+    size_t handled = 0;
+    uint64_t started;
+    double elapsed;
+    mumble_replay_t replay;
+    mumble_bench_fixture_t fixture;
+
+    while ((option = getopt(argc, argv, "rn:mh")) != -1)
+    {
+        switch (option)
+        {
+            case 'r': realtime = 1; break;
+            case 'n': loops = atoi(optarg); break;
+            case 'm': metrics = 1; break;
+            default:
+                mumble_replay_usage(argv[0]);
+
+                return 1;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        mumble_replay_usage(argv[0]);
+
+        return 1;
+    }
+
+    if (mumble_replay_load(&replay, argv[optind]) != 0)
+        return 1;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        fprintf(stderr, "Could not set up a server\n");
+        mumble_bench_fixture_free(&fixture);
+
+        return 1;
+    }
+
+    /* The state built up by a pass is kept for the next one, so later passes
+     * update users and channels rather than creating them. */
+    started = mumble_clock_us();
+
+    for (i = 0; i < loops; i++)
+        handled += mumble_replay_run(&replay, fixture.server, realtime);
+
+    elapsed = (mumble_clock_us() - started) / 1e6;
+
+    printf("packets: %zu of %zu handled\n", handled, replay.count * loops);
+    printf("bytes: %zu\n", replay.size * loops);
+    printf("capture: %.3f s\n", replay.times[replay.count - 1] / 1e6);
+    printf("elapsed: %.6f s, %.0f packets/s, %.3f MiB/s\n", elapsed,
+           elapsed > 0 ? handled / elapsed : 0.0,
+           elapsed > 0 ? replay.size * loops / elapsed / 1048576
+                       : 0.0);
+
+    if (metrics)
+    {
+        size_t size = mumble_render_metrics(fixture.client, NULL, 0) + 1;
+        char* text = (char*)malloc(size);
+
+        if (text)
+        {
+            mumble_render_metrics(fixture.client, text, size);
+            fputs(text, stdout);
+            free(text);
+        }
+    }
+
+    mumble_bench_fixture_free(&fixture);
+    free(replay.packets);
+    free(replay.times);
+
+    return 0;
+}
@@ -0,0 +1,800 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/*
+ * A stand-in for Murmur to run load tests against on a single machine.
+ *
+ * It speaks just enough of the TLS control protocol for clients to connect
+ * and synchronize: versions are exchanged, every authentication succeeds and
+ * is answered with a flood of channel and user states of configurable size,
+ * and pings, voice and text messages are echoed back to the sender. Nothing
+ * is relayed between clients and no permissions are checked. Everything
+ * clients send can be recorded to a file, to compare what reached the wire.
+ *
+ * A certificate is required, e.g.
+ *
+ *     openssl req -x509 -newkey rsa:2048 -nodes -days 365 -subj /CN=localhost \
+ *         -keyout private.key -out public.crt
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <ev.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include "Mumble.pb-c.h"
+#include "protocol.h"
+#include "buffer.h"
+
+/**
+ * The most bytes read from a connection in a single call.
+ */
+#define MUMBLE_TEST_READ_SIZE (1024 * 16)
+
+/**
+ * The session id of the first fake user. Clients are given ids from 1.
+ */
+static const uint32_t kMumbleTestFakeSession = 1000000;
+
+/**
+ * The number of bytes of a sync that are queued ahead of what was written.
+ * The rest is packed as the write buffer drains, so a sync of any size fits.
+ */
+static const size_t kMumbleTestSyncQueued = 1024 * 256;
+
+/**
+ * The settings of the server.
+ */
+typedef struct mumble_test_config_t
+{
+    const char* address;
+    int port;
+    const char* cert_file;
+    const char* key_file;
+    /** The number of channels, including the root channel. */
+    uint32_t num_channels;
+    /** The number of fake users sent to every client that connects. */
+    uint32_t num_users;
+    /** The size of the comment of each fake user, in bytes. */
+    size_t comment_size;
+    /** The size of the description of each channel, in bytes. */
+    size_t description_size;
+    /** The size of the welcome text, in bytes. */
+    size_t welcome_size;
+    /** The file that received data is appended to, or NULL. */
+    const char* record_file;
+} mumble_test_config_t;
+
+/**
+ * The server state.
+ */
+typedef struct mumble_test_server_t
+{
+    mumble_test_config_t config;
+    struct ev_loop* loop;
+    SSL_CTX* ssl_ctx;
+    ev_io listener;
+    ev_signal sigint;
+    /** Filler text that comments and descriptions are cut from. */
+    char* filler;
+    /** The length of the filler text. */
+    size_t filler_size;
+    /** The file that received data is appended to, or NULL. */
+    FILE* record;
+    uint32_t next_session;
+    uint64_t accepted;
+    uint64_t synchronized;
+    uint64_t packets_in;
+    uint64_t packets_out;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} mumble_test_server_t;
+
+/**
+ * A client connection.
+ */
+typedef struct mumble_test_conn_t
+{
+    mumble_test_server_t* server;
+    int fd;
+    SSL* ssl;
+    ev_io watcher;
+    /** Non-zero until the TLS handshake is done. */
+    int handshaking;
+    uint32_t session;
+    /** Non-zero while the sync after authentication is being queued. */
+    int syncing;
+    /** The index of the next packet of the sync. */
+    uint32_t sync_next;
+    /** Non-zero if a packet couldn't be queued and the client must go. */
+    int failed;
+    mumble_buffer_t rbuffer;
+    mumble_buffer_t wbuffer;
+} mumble_test_conn_t;
+
+static void mumble_test_conn_callback(struct ev_loop* loop, ev_io* w,
+                                      int revents);
+
+static int mumble_test_setnonblock(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+static void mumble_test_conn_free(mumble_test_conn_t* conn)
+{
+    ev_io_stop(conn->server->loop, &conn->watcher);
+    SSL_free(conn->ssl);
+    close(conn->fd);
+    free(conn->rbuffer.ptr);
+    free(conn->wbuffer.ptr);
+    free(conn);
+}
+
+/**
+ * Queue a message to be sent to a client.
+ *
+ * A client that misses a packet, such as part of its sync, would measure
+ * something else than what was asked for, so it's disconnected instead.
+ */
+static void mumble_test_send(mumble_test_conn_t* conn,
+                             mumble_packet_type_t type, const void* message)
+{
+    size_t size = mumble_packet_pack(&conn->wbuffer, type, message);
+
+    if (size == 0)
+    {
+        fprintf(stderr, "Could not pack %s, disconnecting\n",
+                mumble_packet_name(type));
+        conn->failed = 1;
+
+        return;
+    }
+
+    conn->server->packets_out++;
+}
+
+/**
+ * Queue a received packet to be sent back as is.
+ */
+static void mumble_test_echo(mumble_test_conn_t* conn, const uint8_t* packet,
+                             size_t size)
+{
+    if (mumble_buffer_write(&conn->wbuffer, packet, size) != size)
+    {
+        fprintf(stderr, "Could not echo a packet, disconnecting\n");
+        conn->failed = 1;
+
+        return;
+    }
+
+    conn->server->packets_out++;
+}
+
+/**
+ * Get a text of `size` bytes, or NULL if `size` is zero.
+ *
+ * The texts are the tail ends of a shared buffer, so they mustn't be changed.
+ */
+static char* mumble_test_filler(mumble_test_server_t* server, size_t size)
+{
+    if (size == 0)
+        return NULL;
+
+    return server->filler + (server->filler_size - size);
+}
+
+/**
+ * Queue packet `index` of a sync, which is answered the way Murmur does, with
+ * the crypt setup, codec version, channel tree, users and finally the server
+ * sync.
+ *
+ * @returns non-zero once the server sync was queued.
+ */
+static int mumble_test_sync_packet(mumble_test_conn_t* conn, uint32_t index)
+{
+    uint8_t key[16];
+    char name[32];
+    mumble_test_server_t* server = conn->server;
+    const mumble_test_config_t* config = &server->config;
+
+    if (index == 0)
+    {
+        MumbleProto__CryptSetup crypt_setup = MUMBLE_PROTO__CRYPT_SETUP__INIT;
+
+        memset(key, 0x5a, sizeof key);
+        crypt_setup.has_key = crypt_setup.has_client_nonce =
+            crypt_setup.has_server_nonce = 1;
+        crypt_setup.key.data = key;
+        crypt_setup.key.len = sizeof key;
+        crypt_setup.client_nonce = crypt_setup.server_nonce = crypt_setup.key;
+        mumble_test_send(conn, MUMBLE_PACKET_CRYPT_SETUP, &crypt_setup);
+
+        return 0;
+    }
+
+    if (index == 1)
+    {
+        MumbleProto__CodecVersion codec_version =
+            MUMBLE_PROTO__CODEC_VERSION__INIT;
+
+        codec_version.alpha = -2147483637;
+        codec_version.beta = 0;
+        codec_version.prefer_alpha = 1;
+        codec_version.has_opus = 1;
+        codec_version.opus = 1;
+        mumble_test_send(conn, MUMBLE_PACKET_CODEC_VERSION, &codec_version);
+
+        return 0;
+    }
+
+    index -= 2;
+
+    if (index < config->num_channels)
+    {
+        MumbleProto__ChannelState state = MUMBLE_PROTO__CHANNEL_STATE__INIT;
+
+        snprintf(name, sizeof name, index ? "Channel %u" : "Root", index);
+        state.has_channel_id = 1;
+        state.channel_id = index;
+        state.has_parent = index != 0;
+        state.parent = 0;
+        state.name = name;
+        state.has_position = 1;
+        state.position = (int32_t)index;
+        state.description =
+            mumble_test_filler(server, config->description_size);
+        mumble_test_send(conn, MUMBLE_PACKET_CHANNEL_STATE, &state);
+
+        return 0;
+    }
+
+    index -= config->num_channels;
+
+    /* The fake users first, then the user that connected. */
+    if (index <= config->num_users)
+    {
+        MumbleProto__UserState state = MUMBLE_PROTO__USER_STATE__INIT;
+
+        state.has_session = 1;
+        state.has_channel_id = 1;
+        state.name = name;
+
+        if (index < config->num_users)
+        {
+            snprintf(name, sizeof name, "user-%u", index);
+            state.session = kMumbleTestFakeSession + index;
+            state.channel_id = index % config->num_channels;
+            state.has_user_id = 1;
+            state.user_id = index + 1;
+            state.comment = mumble_test_filler(server, config->comment_size);
+        }
+        else
+        {
+            snprintf(name, sizeof name, "client-%u", conn->session);
+            state.session = conn->session;
+            state.channel_id = 0;
+        }
+
+        mumble_test_send(conn, MUMBLE_PACKET_USER_STATE, &state);
+
+        return 0;
+    }
+
+    MumbleProto__ServerSync server_sync = MUMBLE_PROTO__SERVER_SYNC__INIT;
+
+    server_sync.has_session = 1;
+    server_sync.session = conn->session;
+    server_sync.has_max_bandwidth = 1;
+    server_sync.max_bandwidth = 558000;
+    server_sync.welcome_text =
+        mumble_test_filler(server, config->welcome_size);
+    server_sync.has_permissions = 1;
+    server_sync.permissions = 0xf07ff;
+    mumble_test_send(conn, MUMBLE_PACKET_SERVER_SYNC, &server_sync);
+
+    if (!conn->failed)
+        server->synchronized++;
+
+    return 1;
+}
+
+/**
+ * Queue more of a sync, until enough is queued or it's complete.
+ */
+static void mumble_test_sync(mumble_test_conn_t* conn)
+{
+    while (conn->syncing && !conn->failed &&
+           conn->wbuffer.size < kMumbleTestSyncQueued)
+        if (mumble_test_sync_packet(conn, conn->sync_next++))
+            conn->syncing = 0;
+}
+
+/**
+ * Start answering an authentication.
+ */
+static void mumble_test_authenticate(mumble_test_conn_t* conn)
+{
+    conn->session = conn->server->next_session++;
+    conn->syncing = 1;
+    conn->sync_next = 0;
+    mumble_test_sync(conn);
+}
+
+/**
+ * Handle a packet from a client.
+ */
+static void mumble_test_handle(mumble_test_conn_t* conn, uint16_t type,
+                               const uint8_t* packet, size_t size)
+{
+    switch (type)
+    {
+        case MUMBLE_PACKET_VERSION:
+        {
+            MumbleProto__Version version = MUMBLE_PROTO__VERSION__INIT;
+
+            version.has_version = 1;
+            version.version = 0x010204;
+            version.release = "libmumble test server";
+            version.os = "Linux";
+            version.os_version = "";
+            mumble_test_send(conn, MUMBLE_PACKET_VERSION, &version);
+            break;
+        }
+        case MUMBLE_PACKET_AUTHENTICATE:
+            mumble_test_authenticate(conn);
+            break;
+        case MUMBLE_PACKET_PING:
+        case MUMBLE_PACKET_UDPTUNNEL:
+        case MUMBLE_PACKET_TEXT_MESSAGE:
+            mumble_test_echo(conn, packet, size);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * Cut the received data into packets and handle them.
+ */
+static void mumble_test_read_packets(mumble_test_conn_t* conn)
+{
+    uint16_t type;
+    uint32_t length;
+    size_t offset = 0;
+    const uint8_t* ptr = conn->rbuffer.ptr;
+
+    while (conn->rbuffer.size - offset >= kMumbleHeaderSize)
+    {
+        type = (uint16_t)(ptr[offset] << 8 | ptr[offset + 1]);
+        length = (uint32_t)ptr[offset + 2] << 24 |
+                 (uint32_t)ptr[offset + 3] << 16 |
+                 (uint32_t)ptr[offset + 4] << 8 | (uint32_t)ptr[offset + 5];
+
+        if (conn->rbuffer.size - offset < kMumbleHeaderSize + length)
+            break;
+
+        conn->server->packets_in++;
+        mumble_test_handle(conn, type, ptr + offset,
+                           kMumbleHeaderSize + length);
+        offset += kMumbleHeaderSize + length;
+    }
+
+    /* Discard the handled packets at once rather than one at a time. */
+    mumble_buffer_read(&conn->rbuffer, NULL, offset);
+}
+
+/**
+ * Read everything that is available from a client.
+ *
+ * @returns zero on success, non-zero if the connection is gone.
+ */
+static int mumble_test_read(mumble_test_conn_t* conn)
+{
+    int result;
+    uint8_t buffer[MUMBLE_TEST_READ_SIZE];
+
+    for (;;)
+    {
+        result = SSL_read(conn->ssl, buffer, sizeof buffer);
+
+        if (result <= 0)
+        {
+            result = SSL_get_error(conn->ssl, result);
+
+            return result != SSL_ERROR_WANT_READ &&
+                   result != SSL_ERROR_WANT_WRITE;
+        }
+
+        conn->server->bytes_in += (uint64_t)result;
+
+        /* Flushed right away, so that it can be compared while running. */
+        if (conn->server->record)
+        {
+            fwrite(buffer, 1, (size_t)result, conn->server->record);
+            fflush(conn->server->record);
+        }
+
+        if (mumble_buffer_write(&conn->rbuffer, buffer, (size_t)result) !=
+            (size_t)result)
+            return 1;
+
+        mumble_test_read_packets(conn);
+    }
+}
+
+/**
+ * Write as much of the queued data to a client as it takes.
+ *
+ * @returns zero on success, non-zero if the connection is gone.
+ */
+static int mumble_test_write(mumble_test_conn_t* conn)
+{
+    int result;
+
+    /* The rest of a sync is queued as what's ahead of it is written. */
+    for (mumble_test_sync(conn); conn->wbuffer.size > 0;
+         mumble_test_sync(conn))
+    {
+        result = SSL_write(conn->ssl, conn->wbuffer.ptr,
+                           conn->wbuffer.size > INT32_MAX
+                               ? INT32_MAX
+                               : (int)conn->wbuffer.size);
+
+        if (result <= 0)
+        {
+            result = SSL_get_error(conn->ssl, result);
+
+            return result != SSL_ERROR_WANT_READ &&
+                   result != SSL_ERROR_WANT_WRITE;
+        }
+
+        conn->server->bytes_out += (uint64_t)result;
+        mumble_buffer_read(&conn->wbuffer, NULL, (size_t)result);
+    }
+
+    return 0;
+}
+
+/**
+ * Watch a client for writability only while there is data queued for it.
+ */
+static void mumble_test_update_events(mumble_test_conn_t* conn)
+{
+    int events = EV_READ | (conn->wbuffer.size > 0 ? EV_WRITE : 0);
+
+    if (conn->watcher.events != events)
+    {
+        ev_io_stop(conn->server->loop, &conn->watcher);
+        ev_io_set(&conn->watcher, conn->fd, events);
+        ev_io_start(conn->server->loop, &conn->watcher);
+    }
+}
+
+static void mumble_test_conn_callback(struct ev_loop* loop, ev_io* w,
+                                      int revents)
+{
+    int result;
+    mumble_test_conn_t* conn = (mumble_test_conn_t*)w->data;
+
+    (void)loop;
+    (void)revents;
+
+    if (conn->handshaking)
+    {
+        result = SSL_accept(conn->ssl);
+
+        if (result != 1)
+        {
+            result = SSL_get_error(conn->ssl, result);
+
+            if (result == SSL_ERROR_WANT_READ ||
+                result == SSL_ERROR_WANT_WRITE)
+                return;
+
+            mumble_test_conn_free(conn);
+
+            return;
+        }
+
+        conn->handshaking = 0;
+    }
+
+    if (mumble_test_read(conn) != 0 || mumble_test_write(conn) != 0 ||
+        conn->failed)
+    {
+        mumble_test_conn_free(conn);
+
+        return;
+    }
+
+    mumble_test_update_events(conn);
+}
+
+static void mumble_test_accept(struct ev_loop* loop, ev_io* w, int revents)
+{
+    int fd, one = 1;
+    mumble_test_conn_t* conn;
+    mumble_test_server_t* server = (mumble_test_server_t*)w->data;
+
+    (void)revents;
+
+    while ((fd = accept(w->fd, NULL, NULL)) >= 0)
+    {
+        mumble_test_setnonblock(fd);
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+        if ((conn = (mumble_test_conn_t*)calloc(1, sizeof *conn)) == NULL)
+        {
+            close(fd);
+            continue;
+        }
+
+        conn->server = server;
+        conn->fd = fd;
+        conn->handshaking = 1;
+        mumble_buffer_init(&conn->rbuffer);
+        mumble_buffer_init(&conn->wbuffer);
+
+        if ((conn->ssl = SSL_new(server->ssl_ctx)) == NULL ||
+            !SSL_set_fd(conn->ssl, fd))
+        {
+            mumble_test_conn_free(conn);
+            continue;
+        }
+
+        SSL_set_mode(conn->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE);
+
+        ev_io_init(&conn->watcher, mumble_test_conn_callback, fd, EV_READ);
+        conn->watcher.data = conn;
+        ev_io_start(loop, &conn->watcher);
+
+        server->accepted++;
+    }
+
+    if (errno != EAGAIN && errno != EWOULDBLOCK)
+        perror("accept");
+}
+
+static void mumble_test_print_stats(const mumble_test_server_t* server)
+{
+    fprintf(stderr,
+            "accepted %llu, synchronized %llu, packets in %llu out %llu, "
+            "bytes in %llu out %llu\n",
+            (unsigned long long)server->accepted,
+            (unsigned long long)server->synchronized,
+            (unsigned long long)server->packets_in,
+            (unsigned long long)server->packets_out,
+            (unsigned long long)server->bytes_in,
+            (unsigned long long)server->bytes_out);
+}
+
+static void mumble_test_interrupt(struct ev_loop* loop, ev_signal* w,
+                                  int revents)
+{
+    (void)revents;
+
+    mumble_test_print_stats((const mumble_test_server_t*)w->data);
+    ev_break(loop, EVBREAK_ALL);
+}
+
+/**
+ * Create the socket that clients connect to.
+ *
+ * @returns the file descriptor, or -1 on failure.
+ */
+static int mumble_test_listen(mumble_test_config_t* config)
+{
+    int fd, one = 1;
+    struct sockaddr_in address;
+
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_port = htons((uint16_t)config->port);
+
+    if (inet_pton(AF_INET, config->address, &address.sin_addr) != 1)
+    {
+        fprintf(stderr, "Invalid address: %s\n", config->address);
+
+        return -1;
+    }
+
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+    {
+        perror("socket");
+
+        return -1;
+    }
+
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof address) != 0 ||
+        listen(fd, SOMAXCONN) != 0 || mumble_test_setnonblock(fd) != 0)
+    {
+        perror("bind");
+        close(fd);
+
+        return -1;
+    }
+
+    /* Tell which port was picked, when asked for any. */
+    if (config->port == 0)
+    {
+        socklen_t length = sizeof address;
+
+        if (getsockname(fd, (struct sockaddr*)&address, &length) == 0)
+            config->port = ntohs(address.sin_port);
+    }
+
+    return fd;
+}
+
+static SSL_CTX* mumble_test_ssl_ctx(const mumble_test_config_t* config)
+{
+    SSL_CTX* ctx;
+
+    SSL_library_init();
+    SSL_load_error_strings();
+
+    if ((ctx = SSL_CTX_new(SSLv23_server_method())) == NULL)
+        return NULL;
+
+    if (!SSL_CTX_use_certificate_chain_file(ctx, config->cert_file) ||
+        !SSL_CTX_use_PrivateKey_file(ctx, config->key_file,
+                                     SSL_FILETYPE_PEM) ||
+        !SSL_CTX_check_private_key(ctx))
+    {
+        ERR_print_errors_fp(stderr);
+        SSL_CTX_free(ctx);
+
+        return NULL;
+    }
+
+    return ctx;
+}
+
+static void mumble_test_usage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -a ADDRESS  address to listen on (default 127.0.0.1)\n"
+            "  -p PORT     port to listen on, or 0 for any (default 64738)\n"
+            "  -c FILE     certificate chain (default public.crt)\n"
+            "  -k FILE     private key (default private.key)\n"
+            "  -C COUNT    channels, including the root (default 16)\n"
+            "  -u COUNT    users sent to each client (default 100)\n"
+            "  -s BYTES    size of each user comment (default 0)\n"
+            "  -d BYTES    size of each channel description (default 0)\n"
+            "  -w BYTES    size of the welcome text (default 64)\n"
+            "  -r FILE     append everything clients send to FILE\n",
+            program);
+}
+
+int main(int argc, char** argv)
+{
+    int fd, option;
+    mumble_test_server_t server;
+    mumble_test_config_t* config = &server.config;
+
+    memset(&server, 0, sizeof server);
+    config->address = "127.0.0.1";
+    config->port = 64738;
+    config->cert_file = "public.crt";
+    config->key_file = "private.key";
+    config->num_channels = 16;
+    config->num_users = 100;
+    config->welcome_size = 64;
+
+    while ((option = getopt(argc, argv, "a:p:c:k:C:u:s:d:w:r:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'a': config->address = optarg; break;
+            case 'p': config->port = atoi(optarg); break;
+            case 'c': config->cert_file = optarg; break;
+            case 'k': config->key_file = optarg; break;
+            case 'C': config->num_channels = (uint32_t)atoi(optarg); break;
+            case 'u': config->num_users = (uint32_t)atoi(optarg); break;
+            case 's': config->comment_size = (size_t)atol(optarg); break;
+            case 'd': config->description_size = (size_t)atol(optarg); break;
+            case 'w': config->welcome_size = (size_t)atol(optarg); break;
+            case 'r': config->record_file = optarg; break;
+            default:
+                mumble_test_usage(argv[0]);
+
+                return 1;
+        }
+    }
+
+    if (config->num_channels == 0)
+        config->num_channels = 1;
+
+    /* All texts are cut from the end of one buffer that fits the longest. */
+    server.filler_size = config->welcome_size;
+
+    if (config->comment_size > server.filler_size)
+        server.filler_size = config->comment_size;
+
+    if (config->description_size > server.filler_size)
+        server.filler_size = config->description_size;
+
+    if ((server.filler = (char*)malloc(server.filler_size + 1)) == NULL)
+        return 1;
+
+    memset(server.filler, 'x', server.filler_size);
+    server.filler[server.filler_size] = '\0';
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if ((server.ssl_ctx = mumble_test_ssl_ctx(config)) == NULL)
+    {
+        fprintf(stderr, "Could not load %s and %s\n", config->cert_file,
+                config->key_file);
+
+        return 1;
+    }
+
+    if (config->record_file &&
+        (server.record = fopen(config->record_file, "ab")) == NULL)
+    {
+        perror(config->record_file);
+
+        return 1;
+    }
+
+    if ((fd = mumble_test_listen(config)) < 0)
+        return 1;
+
+    server.loop = ev_default_loop(0);
+    server.next_session = 1;
+
+    ev_io_init(&server.listener, mumble_test_accept, fd, EV_READ);
+    server.listener.data = &server;
+    ev_io_start(server.loop, &server.listener);
+
+    ev_signal_init(&server.sigint, mumble_test_interrupt, SIGINT);
+    server.sigint.data = &server;
+    ev_signal_start(server.loop, &server.sigint);
+
+    fprintf(stderr, "Listening on %s:%d with %u channels and %u users\n",
+            config->address, config->port, config->num_channels,
+            config->num_users);
+
+    ev_run(server.loop, 0);
+
+    close(fd);
+    SSL_CTX_free(server.ssl_ctx);
+    free(server.filler);
+
+    if (server.record)
+        fclose(server.record);
+
+    return 0;
+}
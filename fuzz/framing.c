@@ -0,0 +1,70 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * Fuzz the framing layer with arbitrary data from a server.
+ *
+ * The data is fed to the read buffer in chunks, as it would arrive from
+ * `SSL_read`, and cut into packets that are handled one after another. Since
+ * the packets share a server, handlers also run against the users and
+ * channels that earlier packets created.
+ *
+ * The first byte of the input picks the chunk size, so that packets end up
+ * split across reads in every way.
+ */
+
+#include <stdlib.h>
+
+#include "iserver.h"
+#include "fixture.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    int result;
+    size_t chunk, length, offset;
+    mumble_bench_fixture_t fixture;
+
+    if (size < 1)
+        return 0;
+
+    chunk = (size_t)data[0] + 1;
+    data++;
+    size--;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+        abort();
+
+    for (offset = 0; offset < size; offset += length)
+    {
+        length = size - offset < chunk ? size - offset : chunk;
+        mumble_buffer_write(&fixture.server->rbuffer, data + offset, length);
+
+        while ((result = mumble_server_read_packet(fixture.server)) > 0)
+            ;
+
+        mumble_bench_drain(fixture.server);
+
+        /* The connection would be closed here. */
+        if (result < 0)
+            break;
+    }
+
+    mumble_bench_fixture_free(&fixture);
+
+    return 0;
+}
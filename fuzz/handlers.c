@@ -0,0 +1,61 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * Fuzz the packet handlers with arbitrary bodies.
+ *
+ * The first byte of the input picks the packet type and the rest is the
+ * body, which is handled by a fresh server. Bodies longer than the type
+ * allows are never handled, so they are skipped.
+ */
+
+#include <stdlib.h>
+
+#include "iserver.h"
+#include "protocol.h"
+#include "fixture.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+    mumble_packet_type_t type;
+    mumble_bench_fixture_t fixture;
+    uint8_t header[sizeof(uint16_t) + sizeof(uint32_t)];
+
+    if (size < 1)
+        return 0;
+
+    type = (mumble_packet_type_t)(data[0] % MUMBLE_PACKET_MAX);
+    data++;
+    size--;
+
+    if (size > mumble_packet_max_size(type))
+        return 0;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+        abort();
+
+    mumble_packet_write_header(header, type, (uint32_t)size);
+    mumble_buffer_write(&fixture.server->rbuffer, header, sizeof header);
+    mumble_buffer_write(&fixture.server->rbuffer, data, size);
+
+    mumble_server_handle_packet(fixture.server, type, (uint32_t)size);
+    mumble_bench_drain(fixture.server);
+    mumble_bench_fixture_free(&fixture);
+
+    return 0;
+}
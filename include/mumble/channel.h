@@ -40,15 +40,21 @@ typedef enum mumble_channel_flags_t
     MUMBLE_CHANNEL_TEMPORARY = (1 << 1)
 } mumble_channel_flags_t;
 
+struct mumble_blob_t;
+
 typedef struct mumble_channel_t
 {
     int id;
     int parent;
-    char* name;
-    char* description;
+    const char* name;
+    /** The channel description, or NULL if unset or not yet received. */
+    const char* description;
     int position;
     mumble_channel_flags_t flags;
+    /** @private The cached blob holding the description. */
+    struct mumble_blob_t* description_blob;
     struct mumble_channel_t* next;
+    struct mumble_channel_t* prev;
 } mumble_channel_t;
 
 /**
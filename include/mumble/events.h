@@ -0,0 +1,133 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file events.h
+ * @brief Data structures passed to event callbacks.
+ *
+ * Pointers inside these structures are only valid for the duration of the
+ * callback.
+ */
+
+#pragma once
+#ifndef MUMBLE_EVENTS_H
+#define MUMBLE_EVENTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mumble/external.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct mumble_user_t;
+
+/**
+ * A text message received from a user or the server.
+ */
+typedef struct mumble_text_message_t
+{
+    /** The sender, or NULL if sent by the server or an unknown user. */
+    const struct mumble_user_t* actor;
+    /** The message text. */
+    const char* message;
+    /** The number of users the message was sent to. */
+    size_t num_sessions;
+    /** The session ids of the users the message was sent to. */
+    const uint32_t* sessions;
+    /** The number of channels the message was sent to. */
+    size_t num_channels;
+    /** The ids of the channels the message was sent to. */
+    const uint32_t* channels;
+    /** The number of channel trees the message was sent to. */
+    size_t num_trees;
+    /** The ids of the root channels of the trees the message was sent to. */
+    const uint32_t* trees;
+} mumble_text_message_t;
+
+/**
+ * The reasons a server can reject a connection for.
+ */
+typedef enum mumble_reject_type_t
+{
+    MUMBLE_REJECT_NONE               = 0,
+    MUMBLE_REJECT_WRONG_VERSION      = 1,
+    MUMBLE_REJECT_INVALID_USERNAME   = 2,
+    MUMBLE_REJECT_WRONG_USER_PW      = 3,
+    MUMBLE_REJECT_WRONG_SERVER_PW    = 4,
+    MUMBLE_REJECT_USERNAME_IN_USE    = 5,
+    MUMBLE_REJECT_SERVER_FULL        = 6,
+    MUMBLE_REJECT_NO_CERTIFICATE     = 7,
+    MUMBLE_REJECT_AUTHENTICATOR_FAIL = 8
+} mumble_reject_type_t;
+
+/**
+ * A connection rejection sent by the server.
+ */
+typedef struct mumble_reject_t
+{
+    /** The reason for the rejection. */
+    mumble_reject_type_t type;
+    /** A human readable reason, or NULL. */
+    const char* reason;
+} mumble_reject_t;
+
+/**
+ * The reasons a server can deny an action for.
+ */
+typedef enum mumble_deny_type_t
+{
+    MUMBLE_DENY_TEXT                = 0,
+    MUMBLE_DENY_PERMISSION          = 1,
+    MUMBLE_DENY_SUPER_USER          = 2,
+    MUMBLE_DENY_CHANNEL_NAME        = 3,
+    MUMBLE_DENY_TEXT_TOO_LONG       = 4,
+    MUMBLE_DENY_H9K                 = 5,
+    MUMBLE_DENY_TEMPORARY_CHANNEL   = 6,
+    MUMBLE_DENY_MISSING_CERTIFICATE = 7,
+    MUMBLE_DENY_USER_NAME           = 8,
+    MUMBLE_DENY_CHANNEL_FULL        = 9,
+    MUMBLE_DENY_NESTING_LIMIT       = 10
+} mumble_deny_type_t;
+
+/**
+ * A denied action reported by the server.
+ */
+typedef struct mumble_permission_denied_t
+{
+    /** The reason the action was denied. */
+    mumble_deny_type_t type;
+    /** The permission that was missing, for `MUMBLE_DENY_PERMISSION`. */
+    uint32_t permission;
+    /** The channel the action was denied in. */
+    uint32_t channel_id;
+    /** The session id of the user the action was denied for. */
+    uint32_t session;
+    /** A human readable reason, or NULL. */
+    const char* reason;
+    /** The offending user or channel name, or NULL. */
+    const char* name;
+} mumble_permission_denied_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_EVENTS_H */
@@ -41,6 +41,7 @@ extern "C" {
  */
 struct mumble_t;
 struct mumble_server_t;
+struct ev_loop;
 
 /**
  * Mumble version struct.
@@ -64,10 +65,41 @@ MUMBLE_API const mumble_version_t kMumbleClientVersion;
  */
 typedef struct mumble_settings_t
 {
-    /** Pointer to a path to the client private key. */
+    /**
+     * Pointer to a path to the client private key, or NULL together with
+     * `cert_file` to connect without a certificate.
+     */
     const char* key_file;
-    /** Pointer to a path to the client certificate. */
+    /**
+     * Pointer to a path to the client certificate, or NULL together with
+     * `key_file` to connect without a certificate.
+     */
     const char* cert_file;
+    /**
+     * Pointer to a directory where comments, descriptions and textures are
+     * cached between sessions, or NULL to only cache them in memory. Each
+     * one is written to the directory from the event loop as it arrives, so
+     * this should be on a local disk.
+     */
+    const char* blob_cache_path;
+    /**
+     * Non-zero to let the kernel encrypt outgoing TLS records once the
+     * handshake is done, when the library is built with `LIBMUMBLE_KTLS` and
+     * the kernel and negotiated cipher support it. Otherwise it is ignored.
+     */
+    int enable_ktls;
+    /**
+     * The size of the read buffer of a server, or zero for 8 KiB. Buffers
+     * are only allocated while a server has data in flight, and buffers of
+     * this size are recycled between the servers of a client.
+     */
+    size_t buffer_size;
+    /**
+     * The size the buffers of a server may grow to, or zero for 8 MiB. A
+     * connection is closed if a packet from the server doesn't fit, so this
+     * should be well above 1 MiB.
+     */
+    size_t buffer_size_cap;
 } mumble_settings_t;
 
 /**
@@ -88,6 +120,37 @@ MUMBLE_API struct mumble_t* mumble_new(mumble_settings_t settings);
  */
 MUMBLE_API void mumble_free(struct mumble_t* client);
 
+/**
+ * Set the runtime log level of a subsystem.
+ *
+ * The subsystems are `core`, `net` and `protocol`. Levels range from 1 for
+ * fatal errors only to 5 for everything, and messages above the level the
+ * library was compiled with are never logged. The initial levels can also be
+ * set with the `LIBMUMBLE_LOG` environment variable, e.g. `net=5,protocol=2`.
+ *
+ * @param[in] subsystem the name of the subsystem, or NULL for all of them.
+ * @param[in] level     the log level.
+ *
+ * @returns zero on success, non-zero if the subsystem is unknown.
+ */
+MUMBLE_API int mumble_set_log_level(const char* subsystem, int level);
+
+/**
+ * Render the metrics of a client and its servers as Prometheus text.
+ *
+ * Counters are only updated by the thread running the event loop, so this has
+ * to be called from that thread, e.g. from a callback or between runs.
+ *
+ * @param[in]  client a pointer to the client.
+ * @param[out] buffer a buffer to write the text to, or NULL to measure it.
+ * @param[in]  size   the size of `buffer`.
+ *
+ * @returns the length of the full text. If it is `size` or more, the text was
+ *   truncated.
+ */
+MUMBLE_API size_t mumble_render_metrics(struct mumble_t* client, char* buffer,
+                                        size_t size);
+
 /**
  * @brief Connect to a mumble server.
  *
@@ -105,6 +168,15 @@ int mumble_connect(struct mumble_t* client, struct mumble_server_t* server);
 int mumble_send_version(struct mumble_t* context,
                         struct mumble_server_t* server);
 
+/**
+ * Get the event loop of a client, to run watchers of the application on it.
+ *
+ * @param[in] client a pointer to a client.
+ *
+ * @returns a pointer to the libev loop.
+ */
+MUMBLE_API struct ev_loop* mumble_get_loop(struct mumble_t* client);
+
 /**
  * Run the main event loop.
  *
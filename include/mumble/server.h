@@ -35,6 +35,7 @@
 #include <openssl/ssl.h>
 
 #include <mumble/mumble.h>
+#include <mumble/events.h>
 #include <mumble/external.h>
 
 /**
@@ -63,24 +64,119 @@ extern "C" {
  * `mumble_connect`.
  */
 struct mumble_server_t;
+struct mumble_user_t;
+struct mumble_channel_t;
 
 /**
  * Initialization macro for callbacks structure.
  */
 #define MUMBLE_CALLBACK_INIT \
-        { NULL, NULL }
+        { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, \
+          NULL, NULL }
 
 /**
  * Generic callback function, taking a single opaque server pointer as argument.
  */
 typedef int (*mumble_cb_server)(struct mumble_server_t*);
 
+/**
+ * User callback function, taking a server and a user as arguments.
+ */
+typedef int (*mumble_cb_user)(struct mumble_server_t*,
+                              const struct mumble_user_t*);
+
+/**
+ * Channel callback function, taking a server and a channel as arguments.
+ */
+typedef int (*mumble_cb_channel)(struct mumble_server_t*,
+                                 const struct mumble_channel_t*);
+
+/**
+ * Text message callback function.
+ */
+typedef int (*mumble_cb_text_message)(struct mumble_server_t*,
+                                      const mumble_text_message_t*);
+
+/**
+ * Permission denied callback function.
+ */
+typedef int (*mumble_cb_permission_denied)(struct mumble_server_t*,
+                                           const mumble_permission_denied_t*);
+
+/**
+ * Reject callback function.
+ */
+typedef int (*mumble_cb_reject)(struct mumble_server_t*,
+                                const mumble_reject_t*);
+
+/**
+ * Voice callback function, taking a server and a raw voice packet.
+ */
+typedef int (*mumble_cb_voice)(struct mumble_server_t*, const uint8_t* packet,
+                               size_t length);
+
+/**
+ * The recipients of a text message.
+ *
+ * A message may be sent to any combination of users, channels and channel
+ * trees. Arrays with a count of zero may be NULL.
+ */
+typedef struct mumble_text_targets_t
+{
+    /** The session ids of the users to send the message to. */
+    const uint32_t* sessions;
+    /** The number of session ids. */
+    size_t num_sessions;
+    /** The ids of the channels to send the message to. */
+    const uint32_t* channels;
+    /** The number of channel ids. */
+    size_t num_channels;
+    /** The ids of the root channels of the trees to send the message to. */
+    const uint32_t* trees;
+    /** The number of tree ids. */
+    size_t num_trees;
+} mumble_text_targets_t;
+
+/**
+ * The number of buckets in the round-trip time histogram.
+ */
+#define MUMBLE_PING_HISTOGRAM_SIZE 16
+
+/**
+ * Round-trip time statistics of a connection, measured with pings.
+ *
+ * All times are in microseconds.
+ */
+typedef struct mumble_ping_stats_t
+{
+    /** The number of ping replies received. */
+    uint32_t samples;
+    /** The smoothed round-trip time, as defined by RFC 6298. */
+    uint64_t srtt;
+    /** The round-trip time variation, as defined by RFC 6298. */
+    uint64_t rttvar;
+    /** The lowest round-trip time measured. */
+    uint64_t min_rtt;
+    /** The most recent round-trip time measured. */
+    uint64_t last_rtt;
+    /**
+     * Histogram of round-trip times. Bucket 0 counts times below 1 ms, and
+     * bucket `i` times from 2^(i-1) ms up to 2^i ms. The last bucket counts
+     * everything above.
+     */
+    uint32_t histogram[MUMBLE_PING_HISTOGRAM_SIZE];
+} mumble_ping_stats_t;
+
 /**
  * Callback structure.
  *
  * To associate callbacks with a server, use the `mumble_server_set_callbacks`
  * function.
  *
+ * Packets that are only decoded to be passed to a callback, such as text
+ * messages and voice packets, are skipped without being decoded when their
+ * callback isn't set.
+ *
  * @see mumble_server_set_callbacks
  */
 struct mumble_callback_t
@@ -104,6 +200,123 @@ struct mumble_callback_t
     * @param server an opaque pointer type to a server structure.
     */
     mumble_cb_server on_disconnect;
+
+   /**
+    * @brief User remove callback.
+    *
+    * The `on_user_remove` function is called when a user has left the server,
+    * right before the user is freed.
+    *
+    * @param server an opaque pointer type to a server structure.
+    * @param user   a pointer to the user that is being removed.
+    */
+    mumble_cb_user on_user_remove;
+
+   /**
+    * @brief Channel remove callback.
+    *
+    * The `on_channel_remove` function is called when a channel has been
+    * removed from the server, right before the channel is freed.
+    *
+    * @param server  an opaque pointer type to a server structure.
+    * @param channel a pointer to the channel that is being removed.
+    */
+    mumble_cb_channel on_channel_remove;
+
+   /**
+    * @brief User join callback.
+    *
+    * The `on_user_join` function is called when the server announces a user
+    * that wasn't known before, including the users present when connecting.
+    *
+    * @param server an opaque pointer type to a server structure.
+    * @param user   a pointer to the new user.
+    */
+    mumble_cb_user on_user_join;
+
+   /**
+    * @brief User state callback.
+    *
+    * The `on_user_state` function is called when the state of a known user
+    * has changed.
+    *
+    * @param server an opaque pointer type to a server structure.
+    * @param user   a pointer to the updated user.
+    */
+    mumble_cb_user on_user_state;
+
+   /**
+    * @brief Channel state callback.
+    *
+    * The `on_channel_state` function is called when a channel has been
+    * created or its state has changed.
+    *
+    * @param server  an opaque pointer type to a server structure.
+    * @param channel a pointer to the channel.
+    */
+    mumble_cb_channel on_channel_state;
+
+   /**
+    * @brief Server sync callback.
+    *
+    * The `on_server_sync` function is called when the server has sent its
+    * initial state and the client is fully connected.
+    *
+    * @param server an opaque pointer type to a server structure.
+    */
+    mumble_cb_server on_server_sync;
+
+   /**
+    * @brief Text message callback.
+    *
+    * @param server  an opaque pointer type to a server structure.
+    * @param message a pointer to the text message.
+    */
+    mumble_cb_text_message on_text_message;
+
+   /**
+    * @brief Permission denied callback.
+    *
+    * @param server an opaque pointer type to a server structure.
+    * @param denied a pointer to the details of the denied action.
+    */
+    mumble_cb_permission_denied on_permission_denied;
+
+   /**
+    * @brief Reject callback.
+    *
+    * The `on_reject` function is called when the server refuses the
+    * connection, right before it is closed.
+    *
+    * @param server an opaque pointer type to a server structure.
+    * @param reject a pointer to the reason for the rejection.
+    */
+    mumble_cb_reject on_reject;
+
+   /**
+    * @brief Voice callback.
+    *
+    * The `on_voice` function is called with every voice packet tunneled
+    * through the control channel.
+    *
+    * @param server an opaque pointer type to a server structure.
+    * @param packet a pointer to the raw voice packet.
+    * @param length the length of the voice packet.
+    */
+    mumble_cb_voice on_voice;
+
+   /**
+    * @brief Writable callback.
+    *
+    * The `on_writable` function is called when the data queued for a server
+    * has drained to its low watermark, after a send was turned away for
+    * exceeding the high watermark.
+    *
+    * @param server an opaque pointer type to a server structure.
+    *
+    * @see mumble_server_set_write_watermarks
+    */
+    mumble_cb_server on_writable;
 };
 
 /**
@@ -170,6 +383,200 @@ MUMBLE_API const struct mumble_user_t*
 mumble_server_get_user_by_name(struct mumble_server_t* server,
                                const char* name);
 
+/**
+ * Get the session ids of the users in a channel.
+ *
+ * @param[in]  server     an opaque pointer type pointing to a server structure.
+ * @param[in]  channel_id the channel id.
+ * @param[out] count      a pointer to store the number of sessions in.
+ *
+ * @returns a pointer to `count` contiguous session ids, or NULL if the channel
+ *   is empty. The pointer is only valid until the next packet is handled.
+ */
+MUMBLE_API const uint32_t*
+mumble_server_get_channel_sessions(struct mumble_server_t* server,
+                                   uint32_t channel_id, size_t* count);
+
+/**
+ * Get the session, channel and flags of all users as parallel arrays.
+ *
+ * Row `i` of each array belongs to the same user. The order of the rows is
+ * unspecified. Any of the output pointers may be NULL.
+ *
+ * @param[in]  server   an opaque pointer type pointing to a server structure.
+ * @param[out] sessions a pointer to store the session id array in.
+ * @param[out] channels a pointer to store the channel id array in.
+ * @param[out] flags    a pointer to store the `mumble_user_flags_t` array in.
+ *
+ * @returns the number of rows. The pointers are only valid until the next
+ *   packet is handled.
+ */
+MUMBLE_API size_t mumble_server_get_user_columns(struct mumble_server_t* server,
+                                                 const uint32_t** sessions,
+                                                 const uint32_t** channels,
+                                                 const uint32_t** flags);
+
+/**
+ * Find the users that have any of the given flags set.
+ *
+ * @param[in]  server   an opaque pointer type pointing to a server structure.
+ * @param[in]  flags    a mask of `mumble_user_flags_t` values.
+ * @param[out] sessions an array to store matching session ids in.
+ * @param[in]  max      the number of session ids `sessions` can hold.
+ *
+ * @returns the number of session ids stored.
+ */
+MUMBLE_API size_t
+mumble_server_find_sessions_by_flags(struct mumble_server_t* server,
+                                     uint32_t flags, uint32_t* sessions,
+                                     size_t max);
+
+/**
+ * Send a text message to any number of users, channels and channel trees.
+ *
+ * All recipients are packed into a single TextMessage packet.
+ *
+ * @param[in] server  an opaque pointer type pointing to a server structure.
+ * @param[in] message the message text.
+ * @param[in] targets the recipients of the message.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+MUMBLE_API int
+mumble_server_send_text_message(struct mumble_server_t* server,
+                                const char* message,
+                                const mumble_text_targets_t* targets);
+
+/**
+ * Send the same text message to several servers.
+ *
+ * The packet is encoded once into a shared buffer that every server
+ * references until it has been written, so the targets must be meaningful on
+ * all of them, e.g. the root channel.
+ * Servers that aren't connected are skipped.
+ *
+ * @param[in] servers     an array of opaque pointers to server structures.
+ * @param[in] num_servers the number of servers.
+ * @param[in] message     the message text.
+ * @param[in] targets     the recipients of the message on each server.
+ *
+ * @returns the number of servers the message was queued on.
+ */
+MUMBLE_API size_t
+mumble_servers_send_text_message(struct mumble_server_t* const* servers,
+                                 size_t num_servers, const char* message,
+                                 const mumble_text_targets_t* targets);
+
+/**
+ * Send a voice packet through the control channel.
+ *
+ * @param[in] server an opaque pointer type pointing to a server structure.
+ * @param[in] packet a pointer to the raw voice packet.
+ * @param[in] length the length of the voice packet.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+MUMBLE_API int mumble_server_send_voice(struct mumble_server_t* server,
+                                        const uint8_t* packet, size_t length);
+
+/**
+ * Send the same voice packet to several servers.
+ *
+ * The packet is framed once into a shared buffer that every server
+ * references until it has been written, so nothing is copied per server.
+ * Servers that aren't connected are skipped.
+ *
+ * @param[in] servers     an array of opaque pointers to server structures.
+ * @param[in] num_servers the number of servers.
+ * @param[in] packet      a pointer to the raw voice packet.
+ * @param[in] length      the length of the voice packet.
+ *
+ * @returns the number of servers the packet was queued on.
+ */
+MUMBLE_API size_t
+mumble_servers_send_voice(struct mumble_server_t* const* servers,
+                          size_t num_servers, const uint8_t* packet,
+                          size_t length);
+
+/**
+ * Set the write watermarks of a server.
+ *
+ * Once `high` bytes are waiting to be written, voice and text messages are
+ * turned away until the queue drains to `low` bytes and `on_writable` is
+ * called. Control packets such as pings are always accepted. The defaults are
+ * 256 KiB and 1 MiB.
+ *
+ * @param[in] server an opaque pointer type pointing to a server structure.
+ * @param[in] low    the low watermark, in bytes.
+ * @param[in] high   the high watermark, in bytes.
+ */
+MUMBLE_API void
+mumble_server_set_write_watermarks(struct mumble_server_t* server, size_t low,
+                                   size_t high);
+
+/**
+ * Set how long queued voice packets are kept before they are dropped.
+ *
+ * Voice packets that couldn't be written within the deadline, e.g. because
+ * the connection is congested, are stale by the time they would arrive and
+ * are dropped instead. The default is 200 ms.
+ *
+ * @param[in] server  an opaque pointer type pointing to a server structure.
+ * @param[in] seconds the deadline, in seconds.
+ */
+MUMBLE_API void mumble_server_set_voice_deadline(struct mumble_server_t* server,
+                                                 double seconds);
+
+/**
+ * Get the audio encoder settings that fit the servers bandwidth limit.
+ *
+ * Outgoing voice is shaped to the maximum bandwidth announced by the server,
+ * including packet headers, and voice packets that can't be sent in time are
+ * dropped. Encoding with these settings keeps the stream within the limit.
+ *
+ * @param[in]  server  an opaque pointer type pointing to a server structure.
+ * @param[out] bitrate a pointer to store the Opus bitrate in, in bits per
+ *   second.
+ * @param[out] frames  a pointer to store the number of 10 ms frames per packet
+ *   in.
+ */
+MUMBLE_API void
+mumble_server_get_audio_settings(const struct mumble_server_t* server,
+                                 int* bitrate, int* frames);
+
+/**
+ * Get the number of voice bytes that were held back to stay within the
+ * servers bandwidth limit.
+ *
+ * @param[in] server an opaque pointer type pointing to a server structure.
+ *
+ * @returns the number of bytes.
+ */
+MUMBLE_API uint64_t
+mumble_server_get_throttled_bytes(const struct mumble_server_t* server);
+
+/**
+ * Get the round-trip time statistics of a server.
+ *
+ * @param[in]  server an opaque pointer type pointing to a server structure.
+ * @param[out] stats  a pointer to store the statistics in.
+ *
+ * @returns zero on success, non-zero if no ping reply has been received yet.
+ */
+MUMBLE_API int
+mumble_server_get_ping_stats(const struct mumble_server_t* server,
+                             mumble_ping_stats_t* stats);
+
+/**
+ * Get the number of bytes waiting to be written to a server.
+ *
+ * @param[in] server an opaque pointer type pointing to a server structure.
+ *
+ * @returns the number of bytes.
+ */
+MUMBLE_API size_t
+mumble_server_get_pending_bytes(const struct mumble_server_t* server);
+
 /**
  * Get the remote servers host or IP-address.
  *
@@ -190,6 +597,44 @@ mumble_server_get_host(const struct mumble_server_t* server);
 MUMBLE_API uint32_t
 mumble_server_get_port(const struct mumble_server_t* server);
 
+/**
+ * Attach a pointer of the application to a server, e.g. to find the state
+ * that belongs to a connection from callbacks.
+ *
+ * @param[in] server an opaque pointer type pointing to a server structure.
+ * @param[in] data   the pointer to attach.
+ */
+MUMBLE_API void mumble_server_set_user_data(struct mumble_server_t* server,
+                                            void* data);
+
+/**
+ * Get the pointer attached with `mumble_server_set_user_data`.
+ *
+ * @param[in] server an opaque pointer type pointing to a server structure.
+ *
+ * @returns the pointer, or NULL if none was attached.
+ */
+MUMBLE_API void*
+mumble_server_get_user_data(const struct mumble_server_t* server);
+
+/**
+ * Record the packets received from a server to a capture file.
+ *
+ * Packets are recorded after decryption, as framed on the wire, along with
+ * the time they were received at. The `replay` tool built with
+ * `LIBMUMBLE_BENCHMARKS` feeds a capture back through the packet handlers
+ * without a connection. Captures contain everything the server sent in plain
+ * text, such as text messages.
+ *
+ * @param[in] server an opaque pointer type pointing to a server structure.
+ * @param[in] path   the file to record to, replacing any existing file, or
+ *   NULL to stop recording.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+MUMBLE_API int mumble_server_set_capture(struct mumble_server_t* server,
+                                         const char* path);
+
 #ifdef __cplusplus
 }
 #endif
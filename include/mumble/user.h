@@ -27,6 +27,7 @@
 #ifndef MUMBLE_USER_H
 #define MUMBLE_USER_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <mumble/external.h>
@@ -49,6 +50,8 @@ typedef enum mumble_user_flags_t
     MUMBLE_USER_RECORDING        = (1 << 7)
 } mumble_user_flags_t;
 
+struct mumble_blob_t;
+
 /**
  * Mumble user structure.
  */
@@ -56,12 +59,22 @@ typedef struct mumble_user_t
 {
     uint32_t id;
     uint32_t session;
-    char* name;
+    const char* name;
     uint32_t channel;
-    char* comment;
-    char* hash;
+    /** The user comment, or NULL if unset or not yet received. */
+    const char* comment;
+    const char* hash;
+    /** The user texture, or NULL if unset or not yet received. */
+    const uint8_t* texture;
+    /** The size of the user texture, in bytes. */
+    size_t texture_size;
     mumble_user_flags_t flags;
+    /** @private The cached blob holding the comment. */
+    struct mumble_blob_t* comment_blob;
+    /** @private The cached blob holding the texture. */
+    struct mumble_blob_t* texture_blob;
     struct mumble_user_t* next;
+    struct mumble_user_t* prev;
 } mumble_user_t;
 
 /**
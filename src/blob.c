@@ -0,0 +1,396 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+
+#include "blob.h"
+#include "log.h"
+
+/**
+ * Get the bucket index of a hash.
+ */
+static size_t blob_bucket(const mumble_blob_cache_t* cache,
+                          const uint8_t* hash)
+{
+    uint32_t index = (uint32_t)hash[0] | (uint32_t)hash[1] << 8 |
+                     (uint32_t)hash[2] << 16 | (uint32_t)hash[3] << 24;
+
+    return index & (cache->num_buckets - 1);
+}
+
+/**
+ * Write the on-disk path of a blob into `buffer`.
+ *
+ * @returns zero on success, non-zero if the path doesn't fit.
+ */
+static int blob_path(const mumble_blob_cache_t* cache, const uint8_t* hash,
+                     char* buffer, size_t size)
+{
+    int i, n;
+    char hex[MUMBLE_BLOB_HASH_SIZE * 2 + 1];
+
+    for (i = 0; i < MUMBLE_BLOB_HASH_SIZE; i++)
+        sprintf(hex + i * 2, "%02x", hash[i]);
+
+    n = snprintf(buffer, size, "%s/%s", cache->path, hex);
+
+    return (n < 0 || (size_t)n >= size);
+}
+
+static void blob_link(mumble_blob_cache_t* cache, mumble_blob_t* blob)
+{
+    size_t index = blob_bucket(cache, blob->hash);
+
+    blob->next = cache->buckets[index];
+    cache->buckets[index] = blob;
+    cache->num_blobs++;
+}
+
+static void blob_unlink(mumble_blob_cache_t* cache, mumble_blob_t* blob)
+{
+    mumble_blob_t** ptr;
+
+    for (ptr = &cache->buckets[blob_bucket(cache, blob->hash)]; *ptr != NULL;
+         ptr = &(*ptr)->next)
+    {
+        if (*ptr == blob)
+        {
+            *ptr = blob->next;
+            cache->num_blobs--;
+            break;
+        }
+    }
+}
+
+static void blob_destroy(mumble_blob_t* blob)
+{
+    if (blob->map)
+        munmap(blob->map, blob->map_size);
+
+    free(blob);
+}
+
+/**
+ * Double the number of buckets and redistribute the blobs.
+ */
+static void blob_grow(mumble_blob_cache_t* cache)
+{
+    size_t i, num_buckets = cache->num_buckets;
+    mumble_blob_t* blob, *next;
+    mumble_blob_t** buckets = cache->buckets;
+    mumble_blob_t** grown =
+        (mumble_blob_t**)calloc(num_buckets * 2, sizeof(mumble_blob_t*));
+
+    if (!grown)
+        return;
+
+    cache->buckets = grown;
+    cache->num_buckets = num_buckets * 2;
+    cache->num_blobs = 0;
+
+    for (i = 0; i < num_buckets; i++)
+    {
+        for (blob = buckets[i]; blob != NULL; blob = next)
+        {
+            next = blob->next;
+            blob_link(cache, blob);
+        }
+    }
+
+    free(buckets);
+}
+
+/**
+ * Drop all unreferenced blobs from memory.
+ */
+static void blob_sweep(mumble_blob_cache_t* cache)
+{
+    size_t i;
+    mumble_blob_t** ptr, *blob;
+
+    for (i = 0; i < cache->num_buckets; i++)
+    {
+        for (ptr = &cache->buckets[i]; *ptr != NULL;)
+        {
+            blob = *ptr;
+
+            if (blob->refcount == 0)
+            {
+                *ptr = blob->next;
+                cache->num_blobs--;
+                blob_destroy(blob);
+            }
+            else
+                ptr = &blob->next;
+        }
+    }
+
+    cache->idle_size = 0;
+}
+
+/**
+ * Map a blob from the on-disk store.
+ *
+ * The data is hashed once when it's mapped, so a store file that was
+ * truncated or changed on disk is never handed out under the hash it's named
+ * after. Such a file is removed, and the blob is requested again.
+ *
+ * @returns a pointer to the blob with a single reference, or NULL.
+ */
+static mumble_blob_t* blob_load(mumble_blob_cache_t* cache,
+                                const uint8_t* hash)
+{
+    int fd;
+    void* map;
+    struct stat st;
+    char path[4096];
+    mumble_blob_t* blob;
+    uint8_t digest[EVP_MAX_MD_SIZE];
+
+    if (!cache->path || blob_path(cache, hash, path, sizeof path) != 0)
+        return NULL;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return NULL;
+
+    if (fstat(fd, &st) != 0 || st.st_size < 1)
+    {
+        close(fd);
+
+        return NULL;
+    }
+
+    map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return NULL;
+
+    /* The store always writes a null-terminator after the data. */
+    if (((const uint8_t*)map)[st.st_size - 1] != '\0' ||
+        !EVP_Digest(map, (size_t)st.st_size - 1, digest, NULL, EVP_sha1(),
+                    NULL) ||
+        memcmp(digest, hash, MUMBLE_BLOB_HASH_SIZE) != 0)
+    {
+        LOG_WARN("Removing corrupt blob store file %s", path);
+        munmap(map, (size_t)st.st_size);
+        unlink(path);
+
+        return NULL;
+    }
+
+    if (!(blob = (mumble_blob_t*)malloc(sizeof(mumble_blob_t))))
+    {
+        munmap(map, (size_t)st.st_size);
+
+        return NULL;
+    }
+
+    blob->cache = cache;
+    blob->refcount = 1;
+    blob->size = (size_t)st.st_size - 1;
+    blob->data = (const uint8_t*)map;
+    blob->map = map;
+    blob->map_size = (size_t)st.st_size;
+    memcpy(blob->hash, hash, MUMBLE_BLOB_HASH_SIZE);
+
+    LOG_DEBUG("Mapped blob from disk (size=%zu)", blob->size);
+
+    return blob;
+}
+
+/**
+ * Write a blob to the on-disk store.
+ *
+ * The blob is written to a temporary file first and then renamed, so readers
+ * never see a partially written blob.
+ *
+ * The write happens right away on the calling thread, which is the event loop
+ * thread, and isn't synced. A blob is only stored when its data first arrives,
+ * which is once per comment, description or texture, but a slow disk stalls
+ * the loop for as long as the write takes.
+ */
+static void blob_store(mumble_blob_cache_t* cache, const mumble_blob_t* blob)
+{
+    FILE* file;
+    char path[4096], temp[4096 + 4];
+
+    if (!cache->path || blob_path(cache, blob->hash, path, sizeof path) != 0)
+        return;
+
+    snprintf(temp, sizeof temp, "%s.tmp", path);
+
+    if (!(file = fopen(temp, "wb")))
+    {
+        LOG_WARN("Could not open blob store file %s", temp);
+
+        return;
+    }
+
+    if (fwrite(blob->data, 1, blob->size + 1, file) != blob->size + 1)
+    {
+        fclose(file);
+        unlink(temp);
+
+        return;
+    }
+
+    if (fclose(file) != 0 || rename(temp, path) != 0)
+        unlink(temp);
+}
+
+int mumble_blob_cache_init(mumble_blob_cache_t* cache, const char* path)
+{
+    if (!cache)
+        return 1;
+
+    cache->buckets =
+        (mumble_blob_t**)calloc(kMumbleBlobCacheBuckets, sizeof(mumble_blob_t*));
+
+    if (!cache->buckets)
+        return 1;
+
+    cache->num_buckets = kMumbleBlobCacheBuckets;
+    cache->num_blobs = 0;
+    cache->idle_size = 0;
+    cache->path = NULL;
+
+    if (path)
+    {
+        if (mkdir(path, 0700) != 0 && errno != EEXIST)
+            LOG_WARN("Could not create blob store directory %s", path);
+
+        cache->path = strdup(path);
+    }
+
+    return 0;
+}
+
+void mumble_blob_cache_free(mumble_blob_cache_t* cache)
+{
+    size_t i;
+    mumble_blob_t* blob, *next;
+
+    if (!cache || !cache->buckets)
+        return;
+
+    for (i = 0; i < cache->num_buckets; i++)
+    {
+        for (blob = cache->buckets[i]; blob != NULL; blob = next)
+        {
+            next = blob->next;
+            blob_destroy(blob);
+        }
+    }
+
+    free(cache->buckets);
+    free(cache->path);
+
+    cache->buckets = NULL;
+    cache->path = NULL;
+    cache->num_buckets = 0;
+    cache->num_blobs = 0;
+}
+
+mumble_blob_t* mumble_blob_cache_get(mumble_blob_cache_t* cache,
+                                     const uint8_t* hash, size_t length)
+{
+    mumble_blob_t* blob;
+
+    if (length != MUMBLE_BLOB_HASH_SIZE)
+        return NULL;
+
+    for (blob = cache->buckets[blob_bucket(cache, hash)]; blob != NULL;
+         blob = blob->next)
+    {
+        if (memcmp(blob->hash, hash, MUMBLE_BLOB_HASH_SIZE) == 0)
+        {
+            if (blob->refcount++ == 0)
+                cache->idle_size -= blob->size;
+
+            return blob;
+        }
+    }
+
+    if ((blob = blob_load(cache, hash)) != NULL)
+    {
+        if (cache->num_blobs >= cache->num_buckets)
+            blob_grow(cache);
+
+        blob_link(cache, blob);
+    }
+
+    return blob;
+}
+
+mumble_blob_t* mumble_blob_cache_put(mumble_blob_cache_t* cache,
+                                     const uint8_t* data, size_t size)
+{
+    mumble_blob_t* blob;
+    uint8_t hash[EVP_MAX_MD_SIZE];
+
+    if (!EVP_Digest(data, size, hash, NULL, EVP_sha1(), NULL))
+        return NULL;
+
+    if ((blob = mumble_blob_cache_get(cache, hash, MUMBLE_BLOB_HASH_SIZE)))
+        return blob;
+
+    blob = (mumble_blob_t*)malloc(sizeof(mumble_blob_t) + size + 1);
+
+    if (!blob)
+        return NULL;
+
+    blob->cache = cache;
+    blob->refcount = 1;
+    blob->size = size;
+    blob->data = blob->inline_data;
+    blob->map = NULL;
+    blob->map_size = 0;
+    memcpy(blob->hash, hash, MUMBLE_BLOB_HASH_SIZE);
+    memcpy(blob->inline_data, data, size);
+    blob->inline_data[size] = '\0';
+
+    if (cache->num_blobs >= cache->num_buckets)
+        blob_grow(cache);
+
+    blob_link(cache, blob);
+    blob_store(cache, blob);
+
+    return blob;
+}
+
+void mumble_blob_release(mumble_blob_t* blob)
+{
+    mumble_blob_cache_t* cache;
+
+    if (!blob || --blob->refcount > 0)
+        return;
+
+    cache = blob->cache;
+
+    if (cache->path)
+    {
+        /* The blob can be mapped back in from the store when needed. */
+        blob_unlink(cache, blob);
+        blob_destroy(blob);
+
+        return;
+    }
+
+    cache->idle_size += blob->size;
+
+    if (cache->idle_size > kMumbleBlobCacheIdleCap)
+        blob_sweep(cache);
+}
+
+int mumble_blob_has_hash(const mumble_blob_t* blob, const uint8_t* hash,
+                         size_t length)
+{
+    return blob && length == MUMBLE_BLOB_HASH_SIZE &&
+           memcmp(blob->hash, hash, MUMBLE_BLOB_HASH_SIZE) == 0;
+}
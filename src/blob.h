@@ -0,0 +1,168 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file blob.h
+ * @brief Content-addressed cache for comments, descriptions and textures.
+ *
+ * Servers only send the SHA-1 hash of large user comments, user textures and
+ * channel descriptions, and the client has to ask for the data with a
+ * RequestBlob message. The blob cache keeps the data keyed by that hash, so
+ * identical blobs are stored once across all servers and known hashes never
+ * have to be requested again.
+ *
+ * When a cache path is configured, blobs are also written to disk and mapped
+ * back into memory on demand, so the cache survives restarts. The files are
+ * written synchronously, from the thread that adds the blob, and checked
+ * against their hash when they are mapped back in.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_BLOB_H
+#define MUMBLE_BLOB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The size of a blob hash, in bytes (SHA-1).
+ */
+#define MUMBLE_BLOB_HASH_SIZE 20
+
+/**
+ * The initial number of buckets in a blob cache.
+ */
+static const size_t kMumbleBlobCacheBuckets = 64;
+
+/**
+ * The number of bytes of unreferenced blobs that are kept in memory when there
+ * is no on-disk store to fall back on.
+ */
+static const size_t kMumbleBlobCacheIdleCap = 1024 * 1024 * 4;
+
+/**
+ * A single immutable, reference-counted blob.
+ */
+typedef struct mumble_blob_t
+{
+    /** The cache this blob belongs to. */
+    struct mumble_blob_cache_t* cache;
+    /** The next blob in the same bucket. */
+    struct mumble_blob_t* next;
+    /** The SHA-1 hash of the data. */
+    uint8_t hash[MUMBLE_BLOB_HASH_SIZE];
+    /** The number of references held to this blob. */
+    uint32_t refcount;
+    /** The size of the data, excluding the null-terminator. */
+    size_t size;
+    /** Pointer to the data. The data is always null-terminated. */
+    const uint8_t* data;
+    /** The memory mapping backing the data, or NULL if stored inline. */
+    void* map;
+    /** The size of the memory mapping. */
+    size_t map_size;
+    /** The inline data, when the blob isn't memory-mapped. */
+    uint8_t inline_data[];
+} mumble_blob_t;
+
+/**
+ * The blob cache structure.
+ */
+typedef struct mumble_blob_cache_t
+{
+    /** Array of bucket chains. The number of buckets is a power of two. */
+    mumble_blob_t** buckets;
+    /** The number of buckets. */
+    size_t num_buckets;
+    /** The number of blobs in memory. */
+    size_t num_blobs;
+    /** The number of bytes held by unreferenced in-memory blobs. */
+    size_t idle_size;
+    /** The on-disk store directory, or NULL if memory-only. */
+    char* path;
+} mumble_blob_cache_t;
+
+/**
+ * Initialize a blob cache.
+ *
+ * @param[in] cache a pointer to memory space to initialize.
+ * @param[in] path  a directory to store blobs in, or NULL to only keep blobs
+ *   in memory.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_blob_cache_init(mumble_blob_cache_t* cache, const char* path);
+
+/**
+ * Free all blobs in the cache and the cache itself.
+ *
+ * @param[in] cache a pointer to the cache.
+ */
+void mumble_blob_cache_free(mumble_blob_cache_t* cache);
+
+/**
+ * Look up a blob by its hash, in memory and then in the on-disk store.
+ *
+ * @param[in] cache  a pointer to the cache.
+ * @param[in] hash   the blob hash.
+ * @param[in] length the length of the hash, in bytes.
+ *
+ * @returns a new reference to the blob, or NULL if it isn't cached.
+ */
+mumble_blob_t* mumble_blob_cache_get(mumble_blob_cache_t* cache,
+                                     const uint8_t* hash, size_t length);
+
+/**
+ * Add data to the cache.
+ *
+ * If a blob with the same content already exists, a reference to that blob is
+ * returned instead.
+ *
+ * @param[in] cache a pointer to the cache.
+ * @param[in] data  the blob data.
+ * @param[in] size  the size of the data, in bytes.
+ *
+ * @returns a new reference to the blob, or NULL on failure.
+ */
+mumble_blob_t* mumble_blob_cache_put(mumble_blob_cache_t* cache,
+                                     const uint8_t* data, size_t size);
+
+/**
+ * Release a reference to a blob.
+ *
+ * @param[in] blob a pointer to the blob, or NULL.
+ */
+void mumble_blob_release(mumble_blob_t* blob);
+
+/**
+ * Check whether a blob has the given hash.
+ *
+ * @returns non-zero if `blob` is not NULL and has the hash, zero otherwise.
+ */
+int mumble_blob_has_hash(const mumble_blob_t* blob, const uint8_t* hash,
+                         size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_BLOB_H */
@@ -4,34 +4,131 @@
 
 #include "buffer.h"
 
+/**
+ * Take a block from a pool, or allocate one if the pool is empty.
+ */
+static void* mumble_buffer_pool_get(mumble_buffer_pool_t* pool)
+{
+    void* block = pool->free_list;
+
+    if (!block)
+        return malloc(pool->block_size);
+
+    memcpy(&pool->free_list, block, sizeof(void*));
+    pool->num_free--;
+
+    return block;
+}
+
+/**
+ * Give a block back to a pool, or free it if the pool is full.
+ */
+static void mumble_buffer_pool_put(mumble_buffer_pool_t* pool, void* block)
+{
+    if (pool->num_free >= pool->max_free)
+    {
+        free(block);
+
+        return;
+    }
+
+    memcpy(block, &pool->free_list, sizeof(void*));
+    pool->free_list = block;
+    pool->num_free++;
+}
+
+void mumble_buffer_pool_init(mumble_buffer_pool_t* pool, size_t block_size,
+                             size_t cap)
+{
+    if (block_size == 0)
+        block_size = kMumbleBufferSize;
+
+    if (cap == 0)
+        cap = kMumbleBufferSizeCap;
+
+    /* Free blocks have to hold the link to the next one. */
+    if (block_size < sizeof(void*))
+        block_size = sizeof(void*);
+
+    if (block_size > cap)
+        block_size = cap;
+
+    pool->block_size = block_size;
+    pool->cap = cap;
+    pool->free_list = NULL;
+    pool->num_free = 0;
+    pool->max_free = kMumbleBufferPoolMax;
+}
+
+void mumble_buffer_pool_free(mumble_buffer_pool_t* pool)
+{
+    void* block;
+
+    while (pool->free_list)
+    {
+        block = pool->free_list;
+        memcpy(&pool->free_list, block, sizeof(void*));
+        free(block);
+    }
+
+    pool->num_free = 0;
+}
+
 int mumble_buffer_init(mumble_buffer_t* buffer)
 {
     if (!buffer)
         return 1;
 
+    mumble_buffer_init_pooled(buffer, NULL);
+
     /* Allocate enough memory for our initial buffer. */
     buffer->ptr = (uint8_t*)malloc(kMumbleBufferSize);
 
     if (!buffer->ptr)
         return 1;
 
-    buffer->pos = 0;
-    buffer->size = 0;
     buffer->capacity = kMumbleBufferSize;
 
     return 0;
 }
 
+void mumble_buffer_init_pooled(mumble_buffer_t* buffer,
+                               mumble_buffer_pool_t* pool)
+{
+    buffer->ptr = NULL;
+    buffer->pos = 0;
+    buffer->size = 0;
+    buffer->capacity = 0;
+    buffer->initial = pool ? pool->block_size : kMumbleBufferSize;
+    buffer->cap = pool ? pool->cap : kMumbleBufferSizeCap;
+    buffer->pool = pool;
+}
+
+void mumble_buffer_free(mumble_buffer_t* buffer)
+{
+    buffer->size = buffer->pos = 0;
+    mumble_buffer_release(buffer);
+}
+
 size_t mumble_buffer_write(mumble_buffer_t* buffer, const uint8_t* data,
                            size_t size)
 {
-    size_t buffer_capacity = buffer->capacity;
+    size_t required = buffer->pos + size;
 
-    if ((buffer->pos + size) > buffer->capacity)
+    if (required > buffer->capacity)
     {
-        /* The data exceeds the boundaries of the buffer, try to resize. */
-        if (mumble_buffer_resize(buffer, buffer->capacity + size) ==
-            buffer_capacity)
+        /* The data exceeds the boundaries of the buffer, so grow it
+         * geometrically to keep the cost of appends amortized constant. */
+        size_t capacity = buffer->capacity ? buffer->capacity : buffer->initial;
+
+        while (capacity < required && capacity < buffer->cap)
+            capacity *= 2;
+
+        if (capacity > buffer->cap)
+            capacity = buffer->cap;
+
+        if (required > capacity ||
+            mumble_buffer_resize(buffer, capacity) < required)
             return 0;
     }
 
@@ -47,12 +144,12 @@ size_t mumble_buffer_write(mumble_buffer_t* buffer, const uint8_t* data,
 
 size_t mumble_buffer_read(mumble_buffer_t* buffer, uint8_t* output, size_t size)
 {
+    if (size > buffer->size)
+        size = buffer->size;
+
     if (size == 0)
         return 0;
 
-    if (size > buffer->capacity)
-        size = buffer->capacity;
-
     if (output != NULL)
         memcpy(output, buffer->ptr, size);
 
@@ -67,10 +164,15 @@ size_t mumble_buffer_resize(mumble_buffer_t* buffer, size_t size)
 {
     void* ptr;
 
-    if (size == 0 || size == buffer->capacity || size > kMumbleBufferSizeCap)
+    if (size == 0 || size == buffer->capacity || size > buffer->cap ||
+        size < buffer->pos)
         return buffer->capacity;
 
-    ptr = realloc(buffer->ptr, size);
+    /* Lazily allocated buffers start out with a block from the pool. */
+    if (!buffer->ptr && buffer->pool && size == buffer->pool->block_size)
+        ptr = mumble_buffer_pool_get(buffer->pool);
+    else
+        ptr = realloc(buffer->ptr, size);
 
     if (ptr != NULL)
     {
@@ -80,3 +182,32 @@ size_t mumble_buffer_resize(mumble_buffer_t* buffer, size_t size)
 
     return buffer->capacity;
 }
+
+void mumble_buffer_trim(mumble_buffer_t* buffer)
+{
+    size_t capacity = buffer->capacity / 2;
+
+    if (buffer->capacity <= buffer->initial ||
+        buffer->size > buffer->capacity / 4)
+        return;
+
+    if (capacity < buffer->initial)
+        capacity = buffer->initial;
+
+    mumble_buffer_resize(buffer, capacity);
+}
+
+void mumble_buffer_release(mumble_buffer_t* buffer)
+{
+    if (!buffer->ptr || buffer->size > 0)
+        return;
+
+    if (buffer->pool && buffer->capacity == buffer->pool->block_size)
+        mumble_buffer_pool_put(buffer->pool, buffer->ptr);
+    else
+        free(buffer->ptr);
+
+    buffer->ptr = NULL;
+    buffer->capacity = 0;
+    buffer->pos = 0;
+}
@@ -40,6 +40,33 @@ static const size_t kMumbleBufferSize = 1024 * 8;
  */
 static const size_t kMumbleBufferSizeCap = 1024 * 1024 * 8;
 
+/**
+ * The default number of free blocks a buffer pool keeps.
+ */
+static const size_t kMumbleBufferPoolMax = 64;
+
+/**
+ * A pool of free memory blocks for buffers.
+ *
+ * Buffers that are drawn from a pool take a block when they are first written
+ * to and give it back when they are released, so that a client with many
+ * servers only holds memory for the ones that have data in flight. The pool
+ * is not thread-safe.
+ */
+typedef struct mumble_buffer_pool_t
+{
+    /** The size of the blocks, which is also the initial buffer size. */
+    size_t block_size;
+    /** The size buffers of the pool are allowed to grow to. */
+    size_t cap;
+    /** Free blocks, each one pointing to the next in its first bytes. */
+    void* free_list;
+    /** The number of free blocks. */
+    size_t num_free;
+    /** The number of free blocks to keep before freeing them instead. */
+    size_t max_free;
+} mumble_buffer_pool_t;
+
 /**
  * The mumble buffer structure.
  *
@@ -48,7 +75,7 @@ static const size_t kMumbleBufferSizeCap = 1024 * 1024 * 8;
  */
 typedef struct mumble_buffer_t
 {
-    /** Pointer to allocated memory. */
+    /** Pointer to allocated memory, or NULL if nothing is allocated yet. */
     uint8_t* ptr;
     /** The capacity of the allocated memory, in number of bytes. */
     size_t capacity;
@@ -56,8 +83,33 @@ typedef struct mumble_buffer_t
     size_t size;
     /** The current write position. */
     size_t pos;
+    /** The capacity to allocate on the first write, and to shrink back to. */
+    size_t initial;
+    /** The capacity the buffer is allowed to grow to. */
+    size_t cap;
+    /** The pool the memory is drawn from, or NULL. */
+    mumble_buffer_pool_t* pool;
 } mumble_buffer_t;
 
+/**
+ * Initialize a buffer pool.
+ *
+ * @param[in] pool       a pointer to the pool to initialize.
+ * @param[in] block_size the initial size of buffers, or zero for
+ *   `kMumbleBufferSize`.
+ * @param[in] cap        the size buffers may grow to, or zero for
+ *   `kMumbleBufferSizeCap`.
+ */
+void mumble_buffer_pool_init(mumble_buffer_pool_t* pool, size_t block_size,
+                             size_t cap);
+
+/**
+ * Free the blocks kept by a pool.
+ *
+ * Buffers drawn from the pool must be freed first.
+ */
+void mumble_buffer_pool_free(mumble_buffer_pool_t* pool);
+
 /**
  * Initialize a buffer.
  *
@@ -67,6 +119,25 @@ typedef struct mumble_buffer_t
  */
 int mumble_buffer_init(mumble_buffer_t* buffer);
 
+/**
+ * Initialize a buffer without allocating any memory.
+ *
+ * Memory is allocated on the first write.
+ *
+ * @param[in] buffer a pointer to memory space to initialize.
+ * @param[in] pool   the pool to draw memory from, or NULL to allocate it with
+ *   the default sizes.
+ */
+void mumble_buffer_init_pooled(mumble_buffer_t* buffer,
+                               mumble_buffer_pool_t* pool);
+
+/**
+ * Free the memory of a buffer, giving it back to its pool if it has one.
+ *
+ * The buffer is left empty and can still be written to.
+ */
+void mumble_buffer_free(mumble_buffer_t* buffer);
+
 /**
  * Write data to the buffer.
  *
@@ -104,4 +175,22 @@ size_t mumble_buffer_read(mumble_buffer_t* buffer, uint8_t* output,
  */
 size_t mumble_buffer_resize(mumble_buffer_t* buffer, size_t size);
 
+/**
+ * Shrink a buffer that has grown past its initial size and is mostly unused.
+ *
+ * A buffer is halved once its data fits in a quarter of it, which leaves room
+ * to double the data again before it has to grow, so a buffer that hovers
+ * around a size isn't resized back and forth.
+ *
+ * @param[in] buffer a pointer to the buffer.
+ */
+void mumble_buffer_trim(mumble_buffer_t* buffer);
+
+/**
+ * Free the memory of a buffer if it is empty.
+ *
+ * @param[in] buffer a pointer to the buffer.
+ */
+void mumble_buffer_release(mumble_buffer_t* buffer);
+
 #endif /* MUMBLE_BUFFER_H */
@@ -0,0 +1,217 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "capture.h"
+#include "protocol.h"
+
+/**
+ * The most bytes a 64-bit varint takes.
+ */
+#define MUMBLE_CAPTURE_VARINT_SIZE 10
+
+static void mumble_capture_put_u64(uint8_t* output, uint64_t value)
+{
+    int i;
+
+    for (i = 7; i >= 0; i--, value >>= 8)
+        output[i] = (uint8_t)value;
+}
+
+static uint64_t mumble_capture_get_u64(const uint8_t* input)
+{
+    int i;
+    uint64_t value = 0;
+
+    for (i = 0; i < 8; i++)
+        value = value << 8 | input[i];
+
+    return value;
+}
+
+int mumble_capture_open(mumble_capture_t* capture, const char* path,
+                        uint64_t now)
+{
+    struct timeval tv;
+    uint8_t header[MUMBLE_CAPTURE_HEADER_SIZE];
+
+    if ((capture->file = fopen(path, "wb")) == NULL)
+        return 1;
+
+    gettimeofday(&tv, NULL);
+    memcpy(header, MUMBLE_CAPTURE_MAGIC, 8);
+    mumble_capture_put_u64(header + 8,
+                           (uint64_t)tv.tv_sec * 1000000 + tv.tv_usec);
+    capture->last = now;
+
+    if (fwrite(header, sizeof header, 1, capture->file) != 1)
+    {
+        fclose(capture->file);
+        capture->file = NULL;
+
+        return 1;
+    }
+
+    return 0;
+}
+
+int mumble_capture_write(mumble_capture_t* capture, uint64_t now,
+                         const uint8_t* packet, size_t size)
+{
+    size_t length = 0;
+    uint8_t varint[MUMBLE_CAPTURE_VARINT_SIZE];
+    uint64_t delta = now > capture->last ? now - capture->last : 0;
+
+    capture->last += delta;
+
+    do
+    {
+        varint[length++] = (uint8_t)((delta & 0x7f) | (delta > 0x7f) << 7);
+        delta >>= 7;
+    } while (delta);
+
+    if (fwrite(varint, length, 1, capture->file) != 1 ||
+        fwrite(packet, size, 1, capture->file) != 1)
+        return 1;
+
+    return 0;
+}
+
+int mumble_capture_close(mumble_capture_t* capture)
+{
+    int result = 0;
+
+    if (capture->file)
+        result = fclose(capture->file) != 0;
+
+    capture->file = NULL;
+
+    return result;
+}
+
+int mumble_capture_reader_open(mumble_capture_reader_t* reader,
+                               const char* path)
+{
+    uint8_t header[MUMBLE_CAPTURE_HEADER_SIZE];
+
+    memset(reader, 0, sizeof *reader);
+
+    if ((reader->file = fopen(path, "rb")) == NULL)
+        return 1;
+
+    if (fread(header, sizeof header, 1, reader->file) != 1 ||
+        memcmp(header, MUMBLE_CAPTURE_MAGIC, 8) != 0)
+    {
+        fclose(reader->file);
+        reader->file = NULL;
+
+        return 1;
+    }
+
+    reader->started = mumble_capture_get_u64(header + 8);
+
+    return 0;
+}
+
+int mumble_capture_read(mumble_capture_reader_t* reader,
+                        mumble_capture_record_t* record)
+{
+    int c, shift = 0;
+    uint32_t length;
+    uint64_t delta = 0;
+    uint8_t* header;
+
+    /* The end of the file is only expected between records. */
+    if ((c = fgetc(reader->file)) == EOF)
+        return 1;
+
+    for (;;)
+    {
+        delta |= (uint64_t)(c & 0x7f) << shift;
+
+        if (!(c & 0x80))
+            break;
+
+        if ((shift += 7) >= 64 || (c = fgetc(reader->file)) == EOF)
+        {
+            reader->error = 1;
+
+            return 1;
+        }
+    }
+
+    if (reader->capacity < kMumbleHeaderSize)
+    {
+        reader->capacity = 1024;
+
+        if ((reader->buffer = (uint8_t*)malloc(reader->capacity)) == NULL)
+        {
+            reader->capacity = 0;
+            reader->error = 1;
+
+            return 1;
+        }
+    }
+
+    header = reader->buffer;
+
+    if (fread(header, kMumbleHeaderSize, 1, reader->file) != 1)
+    {
+        reader->error = 1;
+
+        return 1;
+    }
+
+    length = (uint32_t)header[2] << 24 | (uint32_t)header[3] << 16 |
+             (uint32_t)header[4] << 8 | (uint32_t)header[5];
+
+    if (length > kMumbleCaptureMaxBody)
+    {
+        reader->error = 1;
+
+        return 1;
+    }
+
+    if (reader->capacity < kMumbleHeaderSize + length)
+    {
+        size_t capacity = reader->capacity;
+        uint8_t* buffer;
+
+        while (capacity < kMumbleHeaderSize + length)
+            capacity *= 2;
+
+        if ((buffer = (uint8_t*)realloc(reader->buffer, capacity)) == NULL)
+        {
+            reader->error = 1;
+
+            return 1;
+        }
+
+        reader->buffer = buffer;
+        reader->capacity = capacity;
+    }
+
+    if (length > 0 && fread(reader->buffer + kMumbleHeaderSize,
+                            length, 1, reader->file) != 1)
+    {
+        reader->error = 1;
+
+        return 1;
+    }
+
+    reader->time += delta;
+    record->time = reader->time;
+    record->data = reader->buffer;
+    record->size = kMumbleHeaderSize + length;
+
+    return 0;
+}
+
+void mumble_capture_reader_close(mumble_capture_reader_t* reader)
+{
+    if (reader->file)
+        fclose(reader->file);
+
+    free(reader->buffer);
+    memset(reader, 0, sizeof *reader);
+}
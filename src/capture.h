@@ -0,0 +1,166 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file capture.h
+ * @brief Recording of decrypted control streams for offline replay.
+ *
+ * A capture file starts with an 8 byte magic and the wall clock time the
+ * capture was started at, in microseconds since the epoch as a big-endian
+ * 64-bit integer. It is followed by one record per packet received: the
+ * number of microseconds since the previous record (or the start) as a
+ * varint, and the packet exactly as framed on the wire, header included.
+ *
+ * Captures hold everything the server sent in plain text, including text
+ * messages and comments, and should be handled accordingly.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_CAPTURE_H
+#define MUMBLE_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The magic a capture file starts with.
+ */
+#define MUMBLE_CAPTURE_MAGIC "MBLCAP\r\n"
+
+/**
+ * The size of the capture file header.
+ */
+#define MUMBLE_CAPTURE_HEADER_SIZE 16
+
+/**
+ * The largest packet body a capture reader accepts.
+ */
+static const uint32_t kMumbleCaptureMaxBody = 1024 * 1024 * 8;
+
+/**
+ * A capture that is being written.
+ */
+typedef struct mumble_capture_t
+{
+    /** The file that is written to. */
+    FILE* file;
+    /** The time of the previous record, in microseconds. */
+    uint64_t last;
+} mumble_capture_t;
+
+/**
+ * A packet read from a capture.
+ */
+typedef struct mumble_capture_record_t
+{
+    /** The time since the start of the capture, in microseconds. */
+    uint64_t time;
+    /** The framed packet. Valid until the next record is read. */
+    const uint8_t* data;
+    /** The size of the framed packet, including the header. */
+    size_t size;
+} mumble_capture_record_t;
+
+/**
+ * A capture that is being read.
+ */
+typedef struct mumble_capture_reader_t
+{
+    /** The file that is read from. */
+    FILE* file;
+    /** The wall clock time the capture was started at, in microseconds. */
+    uint64_t started;
+    /** The time of the previous record since the start, in microseconds. */
+    uint64_t time;
+    /** Buffer that the current packet is read into. */
+    uint8_t* buffer;
+    /** The capacity of `buffer`. */
+    size_t capacity;
+    /** Non-zero if the capture is truncated or malformed. */
+    int error;
+} mumble_capture_reader_t;
+
+/**
+ * Create a capture file, replacing any existing file.
+ *
+ * @param[in] capture a pointer to the capture.
+ * @param[in] path    the path of the file.
+ * @param[in] now     the current time on the clock records are timed with,
+ *   in microseconds.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_capture_open(mumble_capture_t* capture, const char* path,
+                        uint64_t now);
+
+/**
+ * Append a packet to a capture.
+ *
+ * @param[in] capture a pointer to the capture.
+ * @param[in] now     the time the packet was received at, in microseconds.
+ * @param[in] packet  the framed packet.
+ * @param[in] size    the size of the framed packet, including the header.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_capture_write(mumble_capture_t* capture, uint64_t now,
+                         const uint8_t* packet, size_t size);
+
+/**
+ * Flush and close a capture.
+ *
+ * @returns zero on success, non-zero if data couldn't be written.
+ */
+int mumble_capture_close(mumble_capture_t* capture);
+
+/**
+ * Open a capture file for reading.
+ *
+ * @returns zero on success, non-zero if it can't be opened or isn't a
+ *   capture.
+ */
+int mumble_capture_reader_open(mumble_capture_reader_t* reader,
+                               const char* path);
+
+/**
+ * Read the next packet of a capture.
+ *
+ * @param[in]  reader a pointer to the reader.
+ * @param[out] record a pointer to store the packet in.
+ *
+ * @returns zero on success, non-zero at the end of the capture or if it is
+ *   malformed, in which case `error` is set.
+ */
+int mumble_capture_read(mumble_capture_reader_t* reader,
+                        mumble_capture_record_t* record);
+
+/**
+ * Close a capture file that was opened for reading.
+ */
+void mumble_capture_reader_close(mumble_capture_reader_t* reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_CAPTURE_H */
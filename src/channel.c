@@ -1,11 +1,17 @@
 #include <stdlib.h>
 #include <mumble/channel.h>
 
+#include "intern.h"
+#include "blob.h"
+
 mumble_channel_t* mumble_channel_init(mumble_channel_t* channel)
 {
     channel->flags = 0;
     channel->name = NULL;
     channel->description = NULL;
+    channel->description_blob = NULL;
+    channel->next = NULL;
+    channel->prev = NULL;
 
     return channel;
 }
@@ -15,7 +21,7 @@ void mumble_channel_free(mumble_channel_t* channel)
     if (!channel)
         return;
 
-    free(channel->name);
-    free(channel->description);
+    mumble_intern_release(channel->name);
+    mumble_blob_release(channel->description_blob);
     free(channel);
 }
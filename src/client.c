@@ -16,10 +16,65 @@
 * License along with this library.
 */
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <ev.h>
 #include <mumble/mumble.h>
 #include <mumble/server.h>
+#include <mumble/user.h>
 #include "log.h"
 
+/**
+ * The state of a connection in load mode.
+ */
+typedef struct load_connection_t
+{
+    /** The time the connection was started at. */
+    double started;
+    /** The time the TLS handshake completed at. */
+    double connected;
+} load_connection_t;
+
+/**
+ * The state of a load test.
+ */
+typedef struct load_state_t
+{
+    /** The connections, one per server. */
+    load_connection_t* connections;
+    /** The number of connections to open. */
+    int num_connections;
+    /** The number of text messages each connection keeps in flight. */
+    int window;
+    /** The number of seconds to run for. */
+    double duration;
+    /** The time the test was started at. */
+    double started;
+    /** The time the last connection completed its handshake at. */
+    double all_connected;
+    /** The time the first connection was synchronized at. */
+    double first_synced;
+    int connected;
+    int synced;
+    int rejected;
+    int disconnected;
+    /** The sum of the connect and handshake times of all connections. */
+    double connect_total;
+    /** The sum of the sync times of all connections. */
+    double sync_total;
+    /** The longest sync time. */
+    double sync_max;
+    /** The number of text messages echoed back. */
+    unsigned long long messages;
+    /** The number of text messages echoed back at the last report. */
+    unsigned long long reported_messages;
+    /** Timer for the progress reports and the end of the test. */
+    ev_timer timer;
+} load_state_t;
+
+static load_state_t g_load;
+
 int server_on_connect(struct mumble_server_t* server)
 {
     printf("Connected to %s!\n", mumble_server_get_host(server));
@@ -34,6 +89,16 @@ int server_on_disconnect(struct mumble_server_t* server)
     return 0;
 }
 
+int server_on_text_message(struct mumble_server_t* server,
+                           const mumble_text_message_t* message)
+{
+    (void)server;
+    printf("<%s> %s\n", message->actor ? message->actor->name : "(server)",
+           message->message);
+
+    return 0;
+}
+
 struct mumble_server_t* create_server(const char* host, uint32_t port)
 {
     struct mumble_server_t* server = mumble_server_new(host, port);
@@ -41,6 +106,7 @@ struct mumble_server_t* create_server(const char* host, uint32_t port)
 
     callbacks.on_connect = server_on_connect;
     callbacks.on_disconnect = server_on_disconnect;
+    callbacks.on_text_message = server_on_text_message;
 
     if (server)
         mumble_server_set_callbacks(server, &callbacks);
@@ -48,13 +114,228 @@ struct mumble_server_t* create_server(const char* host, uint32_t port)
     return server;
 }
 
+/**
+ * Send a text message to the root channel.
+ */
+static void load_send_message(struct mumble_server_t* server)
+{
+    static const uint32_t kRootChannel = 0;
+    static const char* kMessage = "The quick brown fox jumps over the dog.";
+    mumble_text_targets_t targets = {0};
+
+    targets.channels = &kRootChannel;
+    targets.num_channels = 1;
+
+    mumble_server_send_text_message(server, kMessage, &targets);
+}
+
+int load_on_connect(struct mumble_server_t* server)
+{
+    load_connection_t* connection =
+        (load_connection_t*)mumble_server_get_user_data(server);
+
+    connection->connected = ev_time();
+    g_load.connect_total += connection->connected - connection->started;
+
+    if (++g_load.connected == g_load.num_connections)
+        g_load.all_connected = connection->connected;
+
+    return 0;
+}
+
+int load_on_disconnect(struct mumble_server_t* server)
+{
+    (void)server;
+    g_load.disconnected++;
+
+    return 0;
+}
+
+int load_on_reject(struct mumble_server_t* server,
+                   const mumble_reject_t* reject)
+{
+    (void)server;
+    (void)reject;
+    g_load.rejected++;
+
+    return 0;
+}
+
+int load_on_server_sync(struct mumble_server_t* server)
+{
+    int i;
+    double now = ev_time();
+    load_connection_t* connection =
+        (load_connection_t*)mumble_server_get_user_data(server);
+    double sync_time = now - connection->connected;
+
+    if (g_load.synced++ == 0)
+        g_load.first_synced = now;
+
+    g_load.sync_total += sync_time;
+
+    if (sync_time > g_load.sync_max)
+        g_load.sync_max = sync_time;
+
+    /* Keep a window of messages in flight, each echo sends another. */
+    for (i = 0; i < g_load.window; i++)
+        load_send_message(server);
+
+    return 0;
+}
+
+int load_on_text_message(struct mumble_server_t* server,
+                         const mumble_text_message_t* message)
+{
+    (void)message;
+    g_load.messages++;
+
+    load_send_message(server);
+
+    return 0;
+}
+
+static void load_print_summary(double now)
+{
+    double elapsed = now - g_load.started;
+    double messaging = g_load.synced ? now - g_load.first_synced : 0;
+
+    printf("connections: %d requested, %d connected, %d synchronized, "
+           "%d rejected, %d disconnected\n",
+           g_load.num_connections, g_load.connected, g_load.synced,
+           g_load.rejected, g_load.disconnected);
+
+    if (g_load.connected > 0)
+    {
+        double connect_time = (g_load.all_connected > 0 ? g_load.all_connected
+                                                        : now) -
+                              g_load.started;
+
+        printf("connects: %.1f/s (%d in %.3f s), %.3f ms average\n",
+               g_load.connected / connect_time, g_load.connected,
+               connect_time, g_load.connect_total / g_load.connected * 1000);
+    }
+
+    if (g_load.synced > 0)
+        printf("sync: %.3f ms average, %.3f ms max\n",
+               g_load.sync_total / g_load.synced * 1000,
+               g_load.sync_max * 1000);
+
+    printf("messages: %llu echoed, %.1f/s over %.3f s\n", g_load.messages,
+           messaging > 0 ? g_load.messages / messaging : 0.0, messaging);
+    printf("elapsed: %.3f s\n", elapsed);
+}
+
+static void load_tick(struct ev_loop* loop, ev_timer* w, int revents)
+{
+    double now = ev_time();
+
+    (void)w;
+    (void)revents;
+
+    if (now - g_load.started >= g_load.duration)
+    {
+        load_print_summary(now);
+        ev_break(loop, EVBREAK_ALL);
+
+        return;
+    }
+
+    printf("%6.1f s: %d connected, %d synchronized, %llu messages/s\n",
+           now - g_load.started, g_load.connected, g_load.synced,
+           g_load.messages - g_load.reported_messages);
+    g_load.reported_messages = g_load.messages;
+}
+
+/**
+ * Open `num_connections` connections to a server and measure how fast they
+ * connect and synchronize, and how many text messages they get echoed back,
+ * e.g. by the test server in bench/server.c.
+ */
+static int load_run(struct mumble_t* client, const char* host, uint32_t port)
+{
+    int i;
+    struct mumble_server_t* server;
+    struct mumble_callback_t callbacks = MUMBLE_CALLBACK_INIT;
+
+    g_load.connections = (load_connection_t*)calloc(
+        (size_t)g_load.num_connections, sizeof(load_connection_t));
+
+    if (!g_load.connections)
+        return 1;
+
+    callbacks.on_connect = load_on_connect;
+    callbacks.on_disconnect = load_on_disconnect;
+    callbacks.on_reject = load_on_reject;
+    callbacks.on_server_sync = load_on_server_sync;
+    callbacks.on_text_message = load_on_text_message;
+
+    g_load.started = ev_time();
+
+    for (i = 0; i < g_load.num_connections; i++)
+    {
+        if ((server = mumble_server_new(host, port)) == NULL)
+            return 1;
+
+        mumble_server_set_callbacks(server, &callbacks);
+        mumble_server_set_user_data(server, &g_load.connections[i]);
+        g_load.connections[i].started = ev_time();
+
+        if (mumble_connect(client, server) != 0)
+            LOG_ERROR("Could not connect to %s:%u", host, port);
+    }
+
+    ev_timer_init(&g_load.timer, load_tick, 1, 1);
+    ev_timer_start(mumble_get_loop(client), &g_load.timer);
+
+    mumble_run(client);
+
+    free(g_load.connections);
+
+    return 0;
+}
+
+static void usage(const char* program)
+{
+    fprintf(stderr,
+            "Usage: %s [-p port] [-c capture] [host]\n"
+            "       %s -n connections [-d seconds] [-w window] [-p port] "
+            "[host]\n",
+            program, program);
+}
+
 int main(int argc, char** argv)
 {
     static const char* kDefaultHost = "chronicle.nodes.uplink.io";
     const char* host = kDefaultHost;
+    const char* capture = NULL;
+    uint32_t port = 64738;
+    int option;
 
-    if (argc > 1)
-        host = argv[1];
+    g_load.duration = 10;
+    g_load.window = 1;
+
+    while ((option = getopt(argc, argv, "n:d:w:p:c:h")) != -1)
+    {
+        switch (option)
+        {
+            case 'n': g_load.num_connections = atoi(optarg); break;
+            case 'd': g_load.duration = atof(optarg); break;
+            case 'w': g_load.window = atoi(optarg); break;
+            case 'p': port = (uint32_t)atoi(optarg); break;
+            case 'c': capture = optarg; break;
+            default:
+                usage(argv[0]);
+
+                return 1;
+        }
+    }
+
+    if (g_load.num_connections > 0)
+        host = "127.0.0.1";
+
+    if (optind < argc)
+        host = argv[optind];
 
     mumble_settings_t settings = {
         .key_file = "private.key",
@@ -64,8 +345,30 @@ int main(int argc, char** argv)
     LOG_INFO("libmumble v0.1");
 
     struct mumble_t* client = mumble_new(settings);
-    struct mumble_server_t* server1 = create_server(host, 64738);
-    struct mumble_server_t* server2 = create_server("127.0.0.1", 64738);
+
+    if (!client)
+    {
+        fprintf(stderr, "Could not create client, are %s and %s there?\n",
+                settings.cert_file, settings.key_file);
+
+        return 1;
+    }
+
+    if (g_load.num_connections > 0)
+    {
+        int result = load_run(client, host, port);
+
+        mumble_free(client);
+
+        return result;
+    }
+
+    struct mumble_server_t* server1 = create_server(host, port);
+    struct mumble_server_t* server2 = create_server("127.0.0.1", port);
+
+    /* Record what the first server sends, for bench/replay. */
+    if (capture && mumble_server_set_capture(server1, capture) != 0)
+        fprintf(stderr, "Could not create capture %s\n", capture);
 
     LOG_INFO("Connecting to %s", mumble_server_get_host(server1));
 
@@ -0,0 +1,52 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file clock.h
+ * @brief Monotonic clock.
+ */
+
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_CLOCK_H
+#define MUMBLE_CLOCK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Get the time of a clock that is unaffected by changes to the system time.
+ *
+ * @returns the time in microseconds since an unspecified point.
+ */
+uint64_t mumble_clock_us(void);
+
+/**
+ * Get the time of the same clock as `mumble_clock_us` in nanoseconds.
+ *
+ * @returns the time in nanoseconds since an unspecified point.
+ */
+uint64_t mumble_clock_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_CLOCK_H */
@@ -0,0 +1,195 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "intern.h"
+
+/**
+ * Get the entry that holds an interned string.
+ */
+#define INTERN_ENTRY(s)                                                        \
+    ((mumble_intern_entry_t*)((char*)(s)-offsetof(mumble_intern_entry_t, str)))
+
+/**
+ * Calculate the 32-bit FNV-1a hash of a string.
+ */
+static uint32_t intern_hash(const char* str, size_t length)
+{
+    size_t i;
+    uint32_t hash = 2166136261u;
+
+    for (i = 0; i < length; i++)
+    {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+/**
+ * Double the number of buckets and redistribute the entries.
+ */
+static int intern_grow(mumble_intern_t* table)
+{
+    size_t i, num_buckets = table->num_buckets * 2;
+    mumble_intern_entry_t* entry, *next;
+    mumble_intern_entry_t** buckets = (mumble_intern_entry_t**)calloc(
+        num_buckets, sizeof(mumble_intern_entry_t*));
+
+    if (!buckets)
+        return 1;
+
+    for (i = 0; i < table->num_buckets; i++)
+    {
+        for (entry = table->buckets[i]; entry != NULL; entry = next)
+        {
+            size_t index = entry->hash & (num_buckets - 1);
+
+            next = entry->next;
+            entry->next = buckets[index];
+            buckets[index] = entry;
+        }
+    }
+
+    free(table->buckets);
+
+    table->buckets = buckets;
+    table->num_buckets = num_buckets;
+
+    return 0;
+}
+
+int mumble_intern_init(mumble_intern_t* table)
+{
+    if (!table)
+        return 1;
+
+    table->buckets = (mumble_intern_entry_t**)calloc(
+        kMumbleInternBuckets, sizeof(mumble_intern_entry_t*));
+
+    if (!table->buckets)
+        return 1;
+
+    table->num_buckets = kMumbleInternBuckets;
+    table->num_entries = 0;
+
+    return 0;
+}
+
+void mumble_intern_free(mumble_intern_t* table)
+{
+    size_t i;
+    mumble_intern_entry_t* entry, *next;
+
+    if (!table || !table->buckets)
+        return;
+
+    for (i = 0; i < table->num_buckets; i++)
+    {
+        for (entry = table->buckets[i]; entry != NULL; entry = next)
+        {
+            next = entry->next;
+            free(entry);
+        }
+    }
+
+    free(table->buckets);
+
+    table->buckets = NULL;
+    table->num_buckets = 0;
+    table->num_entries = 0;
+}
+
+const char* mumble_intern_acquire_n(mumble_intern_t* table, const char* str,
+                                    size_t length)
+{
+    size_t index;
+    mumble_intern_entry_t* entry;
+    uint32_t hash = intern_hash(str, length);
+
+    index = hash & (table->num_buckets - 1);
+
+    for (entry = table->buckets[index]; entry != NULL; entry = entry->next)
+    {
+        if (entry->hash == hash && entry->length == length &&
+            memcmp(entry->str, str, length) == 0)
+        {
+            entry->refcount++;
+
+            return entry->str;
+        }
+    }
+
+    /* Keep the average chain length below one. */
+    if (table->num_entries >= table->num_buckets && intern_grow(table) == 0)
+        index = hash & (table->num_buckets - 1);
+
+    entry = (mumble_intern_entry_t*)malloc(sizeof(mumble_intern_entry_t) +
+                                           length + 1);
+
+    if (!entry)
+        return NULL;
+
+    entry->table = table;
+    entry->hash = hash;
+    entry->refcount = 1;
+    entry->length = length;
+    memcpy(entry->str, str, length);
+    entry->str[length] = '\0';
+
+    entry->next = table->buckets[index];
+    table->buckets[index] = entry;
+    table->num_entries++;
+
+    return entry->str;
+}
+
+void mumble_intern_release(const char* str)
+{
+    mumble_intern_t* table;
+    mumble_intern_entry_t* entry, **ptr;
+
+    if (!str)
+        return;
+
+    entry = INTERN_ENTRY(str);
+
+    if (--entry->refcount > 0)
+        return;
+
+    table = entry->table;
+
+    for (ptr = &table->buckets[entry->hash & (table->num_buckets - 1)];
+         *ptr != NULL; ptr = &(*ptr)->next)
+    {
+        if (*ptr == entry)
+        {
+            *ptr = entry->next;
+            break;
+        }
+    }
+
+    table->num_entries--;
+    free(entry);
+}
+
+int mumble_intern_assign_n(mumble_intern_t* table, const char** slot,
+                           const char* str, size_t length)
+{
+    const char* interned;
+
+    if (*slot && INTERN_ENTRY(*slot)->length == length &&
+        memcmp(*slot, str, length) == 0)
+        return 0;
+
+    interned = mumble_intern_acquire_n(table, str, length);
+
+    if (!interned)
+        return 0;
+
+    mumble_intern_release(*slot);
+    *slot = interned;
+
+    return 1;
+}
@@ -0,0 +1,140 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file intern.h
+ * @brief Reference-counted table of interned strings.
+ *
+ * User names, hashes and channel names are repeated across state updates,
+ * reconnects and servers. Interning them means each distinct string is only
+ * allocated once per client context, and two interned strings are equal if
+ * and only if their pointers are equal.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_INTERN_H
+#define MUMBLE_INTERN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The initial number of buckets in a string table.
+ */
+static const size_t kMumbleInternBuckets = 64;
+
+/**
+ * @private
+ * A single interned string.
+ *
+ * The string data is stored inline, directly after the header, so that the
+ * entry can be found from the string pointer alone.
+ */
+typedef struct mumble_intern_entry_t
+{
+    /** The table this entry belongs to. */
+    struct mumble_intern_t* table;
+    /** The next entry in the same bucket. */
+    struct mumble_intern_entry_t* next;
+    /** The hash of the string. */
+    uint32_t hash;
+    /** The number of references held to this string. */
+    uint32_t refcount;
+    /** The length of the string, excluding the null-terminator. */
+    size_t length;
+    /** The null-terminated string data. */
+    char str[];
+} mumble_intern_entry_t;
+
+/**
+ * The string table structure.
+ */
+typedef struct mumble_intern_t
+{
+    /** Array of bucket chains. The number of buckets is a power of two. */
+    mumble_intern_entry_t** buckets;
+    /** The number of buckets. */
+    size_t num_buckets;
+    /** The number of distinct strings in the table. */
+    size_t num_entries;
+} mumble_intern_t;
+
+/**
+ * Initialize a string table.
+ *
+ * @param[in] table a pointer to memory space to initialize.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_intern_init(mumble_intern_t* table);
+
+/**
+ * Free all strings in the table and the table itself.
+ *
+ * Any pointers previously returned by the table are invalid afterwards.
+ *
+ * @param[in] table a pointer to the table.
+ */
+void mumble_intern_free(mumble_intern_t* table);
+
+/**
+ * Get a reference to the interned copy of a string, interning it if needed.
+ *
+ * @param[in] table  a pointer to the table.
+ * @param[in] str    the string to intern.
+ * @param[in] length the length of `str`, which need not be null-terminated.
+ *
+ * @returns a pointer to the interned string, or NULL on failure.
+ */
+const char* mumble_intern_acquire_n(mumble_intern_t* table, const char* str,
+                                    size_t length);
+
+/**
+ * Release a reference to an interned string.
+ *
+ * The string is removed from its table once the last reference is released.
+ *
+ * @param[in] str a pointer to an interned string, or NULL.
+ */
+void mumble_intern_release(const char* str);
+
+/**
+ * Replace the interned string in `slot` with `str`.
+ *
+ * If the string in `slot` is already equal to `str`, nothing is allocated or
+ * released.
+ *
+ * @param[in] table  a pointer to the table.
+ * @param[in] slot   a pointer to an interned string, or a pointer to NULL.
+ * @param[in] str    the new string value.
+ * @param[in] length the length of `str`.
+ *
+ * @returns one if the value changed, zero otherwise.
+ */
+int mumble_intern_assign_n(mumble_intern_t* table, const char** slot,
+                           const char* str, size_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_INTERN_H */
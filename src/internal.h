@@ -18,6 +18,13 @@
 
 #include <mumble/mumble.h>
 
+#include "intern.h"
+#include "blob.h"
+#include "buffer.h"
+#include "segment.h"
+#include "timer.h"
+#include "metrics.h"
+
 /**
 * @file internal.h
 * @author Mikkel Kroman
@@ -52,10 +59,20 @@ struct mumble_t
     struct ev_loop* loop;
     /** Client settings for this context. */
     mumble_settings_t settings;
-    /** Internal buffer that is used by the library. */
-    char buffer[512];
+    /** Table of interned strings shared by all servers. */
+    mumble_intern_t strings;
+    /** Cache of comments, descriptions and textures shared by all servers. */
+    mumble_blob_cache_t blobs;
+    /** Timing wheel that the timers of all servers are armed on. */
+    mumble_timer_wheel_t timers;
+    /** Pool of memory for the read buffers of all servers. */
+    mumble_buffer_pool_t buffers;
+    /** Buffer that data is read into, with room for a whole TLS record. */
+    char buffer[16384];
     /** Linked list of servers attached to this client. */
     struct mumble_server_t* servers;
+    /** Counters of the event loop, on their own cache line. */
+    mumble_loop_metrics_t metrics;
 };
 
 /**
@@ -76,6 +93,14 @@ int mumble_init(struct mumble_t* client);
  */
 int mumble_ssl_init(struct mumble_t* context);
 
+/**
+ * Attach a server to a client without connecting it.
+ *
+ * @param[in] client a pointer to the client.
+ * @param[in] server a pointer to the server.
+ */
+void mumble_attach(struct mumble_t* client, struct mumble_server_t* server);
+
 #ifdef __cplusplus
 }
 #endif
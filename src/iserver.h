@@ -31,6 +31,13 @@
 
 #include "buffer.h"
 #include "protocol.h"
+#include "usertable.h"
+#include "segment.h"
+#include "shaper.h"
+#include "ping.h"
+#include "timer.h"
+#include "metrics.h"
+#include "capture.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,6 +49,124 @@ typedef SOCKET socket_t;
 typedef int socket_t;
 #endif
 
+/**
+ * @private
+ * Defined if `enable_ktls` is honored by this build.
+ */
+#if defined(LIBMUMBLE_KTLS) && defined(__linux__) &&                          \
+    defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#define MUMBLE_HAVE_KTLS
+#endif
+
+/**
+ * @private
+ * Call a user callback of a server, if set.
+ */
+#define MUMBLE_EMIT_CALLBACK(server, n, ...)                                   \
+    do                                                                         \
+    {                                                                          \
+        if ((server)->callbacks.n)                                             \
+            (server)->callbacks.n(__VA_ARGS__);                                \
+    } while (0)
+
+/**
+ * @private
+ * The kinds of blobs that can be requested with a RequestBlob message.
+ */
+typedef enum mumble_blob_kind_t
+{
+    MUMBLE_BLOB_TEXTURE     = 0,
+    MUMBLE_BLOB_COMMENT     = 1,
+    MUMBLE_BLOB_DESCRIPTION = 2,
+    MUMBLE_BLOB_KIND_MAX    = 3
+} mumble_blob_kind_t;
+
+/**
+ * @private
+ * The default number of pending bytes at which data packets are turned away.
+ */
+static const size_t kMumbleWriteHighWatermark = 1024 * 1024;
+
+/**
+ * @private
+ * The default number of pending bytes at which a server is writable again.
+ */
+static const size_t kMumbleWriteLowWatermark = 1024 * 256;
+
+/**
+ * @private
+ * The default number of seconds a queued voice packet is sent within before
+ * it is dropped.
+ */
+static const double kMumbleVoiceDeadline = 0.2;
+
+/**
+ * @private
+ * The number of voice packets that are sent in a row while bulk packets are
+ * waiting.
+ */
+static const unsigned int kMumbleVoiceBurst = 8;
+
+/**
+ * @private
+ * The number of seconds the TCP connection and TLS handshake may take.
+ */
+static const double kMumbleConnectTimeout = 15;
+
+/**
+ * @private
+ * The number of seconds between pings on an idle connection.
+ */
+static const double kMumblePingInterval = 5;
+
+/**
+ * @private
+ * The number of seconds the ping interval backs off to while other packets
+ * are received. Servers drop clients after 30 seconds of silence.
+ */
+static const double kMumblePingMaxInterval = 20;
+
+/**
+ * @private
+ * The number of pings in a row without anything received in between after
+ * which the server is considered dead.
+ */
+static const unsigned int kMumblePingMaxMissed = 3;
+
+/**
+ * @private
+ * The send lanes of a server, in order of priority.
+ *
+ * Control packets are always sent first. Voice packets go before bulk
+ * packets, but a bulk packet is let through after every `kMumbleVoiceBurst`
+ * voice packets so it can't be starved. Lanes are only switched at packet
+ * boundaries.
+ */
+typedef enum mumble_lane_t
+{
+    /** Small protocol packets, such as pings and authentication. */
+    MUMBLE_LANE_CONTROL = 0,
+    /** Tunneled voice packets, dropped when they miss their deadline. */
+    MUMBLE_LANE_VOICE   = 1,
+    /** Text messages, user state updates and blob requests. */
+    MUMBLE_LANE_BULK    = 2,
+    MUMBLE_LANE_MAX     = 3
+} mumble_lane_t;
+
+/**
+ * @private
+ * A growable list of session or channel ids.
+ */
+typedef struct mumble_id_list_t
+{
+    /** Pointer to the ids. */
+    uint32_t* ids;
+    /** The number of ids in the list. */
+    size_t size;
+    /** The number of ids there is room for. */
+    size_t capacity;
+} mumble_id_list_t;
+
 /**
  * @private
  * The mumble server structure.
@@ -56,16 +181,64 @@ struct mumble_server_t
     socket_t fd;
     /** The associated SSL object. */
     SSL* ssl;
+    /**
+     * Non-zero if the kernel encrypts outgoing records, in which case queued
+     * data is written straight to the socket with `sendmsg`.
+     */
+    int ktls_send;
     /** The I/O watcher for the socket file descriptor. */
     ev_io watcher;
-    /** The periodic heartbeat timer. */
-    ev_timer ping_timer;
+    /** The connect and handshake timeout, on the timing wheel of the client. */
+    mumble_timer_t connect_timer;
+    /** The keepalive timer, on the timing wheel of the client. */
+    mumble_timer_t ping_timer;
+    /** The number of seconds until the next ping. */
+    double ping_interval;
+    /** The time the last ping was sent at, from `mumble_clock_us`. */
+    uint64_t ping_sent;
+    /** The time data was last received at, from `mumble_clock_us`. */
+    uint64_t last_received;
+    /** The time a packet other than a ping reply was last received at, from
+     * `mumble_clock_us`. */
+    uint64_t last_activity;
+    /** The number of pings in a row that nothing was received after. */
+    unsigned int missed_pings;
+    /** Round-trip time statistics measured with pings. */
+    mumble_ping_stats_t ping_stats;
     /** The read buffer. */
     mumble_buffer_t rbuffer;
-    /** The write buffer. */
-    mumble_buffer_t wbuffer;
+    /** Packets waiting to be written, one queue per `mumble_lane_t`. */
+    mumble_write_queue_t lanes[MUMBLE_LANE_MAX];
+    /** The segment that is being written, or NULL. */
+    mumble_segment_t* inflight;
+    /** The number of bytes of `inflight` that have been written. */
+    size_t inflight_offset;
+    /** Scratch segment that small packets are coalesced into for writing. */
+    mumble_segment_t* scratch;
+    /** The number of pending bytes at which `on_writable` is called. */
+    size_t write_low_watermark;
+    /** The number of pending bytes at which data packets are turned away. */
+    size_t write_high_watermark;
+    /** Non-zero if a data packet was turned away since last writable. */
+    int write_blocked;
+    /** The number of voice packets sent in a row while bulk was waiting. */
+    unsigned int voice_streak;
+    /** The number of seconds a voice packet may wait in the queue. */
+    double voice_deadline;
+    /** The number of voice packets dropped for missing their deadline. */
+    uint64_t voice_dropped;
+    /** Token bucket limiting voice to the servers maximum bandwidth. */
+    mumble_token_bucket_t shaper;
+    /** Timer that resumes writing when the shaper has tokens again. */
+    ev_timer shaper_timer;
+    /** The last voice packet held back by the shaper. */
+    const mumble_segment_t* shaped_segment;
+    /** The number of voice bytes held back by the shaper. */
+    uint64_t throttled_bytes;
     /** A pointer to the client context this server belongs to. */
     struct mumble_t* client;
+    /** The protocol version the server announced, or zero. */
+    uint32_t version;
     /** The connection session id. */
     int session;
     /** The maximum bandwidth we're allowed to use. */
@@ -76,12 +249,31 @@ struct mumble_server_t
     uint64_t permissions;
     /** A pointer to a list of callback handlers. */
     struct mumble_callback_t callbacks;
-    /** A pointer to a linked list with channels. */
+    /** A pointer attached by the application. */
+    void* user_data;
+    /** The capture received packets are recorded to, or NULL. */
+    mumble_capture_t* capture;
+    /**
+     * Bit mask of packet types that are skipped without being decoded,
+     * because they only feed callbacks that aren't set.
+     */
+    uint32_t skipped_packets;
+    /** A pointer to a doubly-linked list with channels. */
     struct mumble_channel_t* channels;
-    /** A pointer to a linked list with users. */
+    /** A pointer to a doubly-linked list with users. */
     struct mumble_user_t* users;
+    /** Map of channel ids to channels. */
+    mumble_map_t channel_index;
+    /** Map of session ids to users. */
+    mumble_map_t user_index;
+    /** Compact table of user sessions, channels and flags. */
+    mumble_user_table_t user_table;
+    /** Session and channel ids with blobs pending a RequestBlob message. */
+    mumble_id_list_t blob_requests[MUMBLE_BLOB_KIND_MAX];
     /** A pointer to the next server in the linked list. */
     struct mumble_server_t* next;
+    /** Counters, on their own cache lines. */
+    mumble_server_metrics_t metrics;
 };
 
 /**
@@ -148,7 +340,8 @@ int mumble_server_handle_packet(struct mumble_server_t* server, uint16_t type,
  *
  * @param[in] server a pointer to the server.
  *
- * @returns one if a packet was received, zero otherwise.,
+ * @returns one if a packet was received, zero if more data is needed and -1
+ *   if the data is malformed, in which case the connection should be closed.
  */
 int mumble_server_read_packet(struct mumble_server_t* server);
 
@@ -194,6 +387,22 @@ void mumble_server_disconnected(struct mumble_server_t* server);
 int mumble_server_send(struct mumble_server_t* server,
                        mumble_packet_type_t packet_type, void* message);
 
+/**
+ * @private
+ * Queue a shared segment of framed packets to be sent to the server.
+ *
+ * The segment is referenced, not copied. Segments outside the control lane
+ * are turned away while the high watermark is exceeded.
+ *
+ * @param[in] server  a pointer to the server.
+ * @param[in] lane    the lane to queue the segment in.
+ * @param[in] segment a pointer to the segment.
+ *
+ * @returns one if successful, zero otherwise.
+ */
+int mumble_server_send_segment(struct mumble_server_t* server,
+                               mumble_lane_t lane, mumble_segment_t* segment);
+
 /**
  * @private
  * Send a version packet to the server.
@@ -229,9 +438,110 @@ int mumble_server_send_ping(struct mumble_server_t* server);
 
 /**
  * @private
- * Called periodically to send a ping packet to the server.
+ * Find a user by session id.
+ *
+ * @param[in] server  a pointer to the server.
+ * @param[in] session the session id.
+ *
+ * @returns a pointer to the user, or NULL if not found.
+ */
+struct mumble_user_t* mumble_server_find_user(struct mumble_server_t* server,
+                                              uint32_t session);
+
+/**
+ * @private
+ * Create a new user and add it to the server.
+ *
+ * @param[in] server  a pointer to the server.
+ * @param[in] session the session id of the new user.
+ *
+ * @returns a pointer to the user, or NULL on failure.
+ */
+struct mumble_user_t* mumble_server_add_user(struct mumble_server_t* server,
+                                             uint32_t session);
+
+/**
+ * @private
+ * Remove a user from the server and free it.
+ *
+ * @param[in] server a pointer to the server.
+ * @param[in] user   a pointer to the user.
+ */
+void mumble_server_remove_user(struct mumble_server_t* server,
+                               struct mumble_user_t* user);
+
+/**
+ * @private
+ * Find a channel by channel id.
+ *
+ * @param[in] server     a pointer to the server.
+ * @param[in] channel_id the channel id.
+ *
+ * @returns a pointer to the channel, or NULL if not found.
+ */
+struct mumble_channel_t*
+mumble_server_find_channel(struct mumble_server_t* server, uint32_t channel_id);
+
+/**
+ * @private
+ * Create a new channel and add it to the server.
+ *
+ * @param[in] server     a pointer to the server.
+ * @param[in] channel_id the channel id of the new channel.
+ *
+ * @returns a pointer to the channel, or NULL on failure.
+ */
+struct mumble_channel_t*
+mumble_server_add_channel(struct mumble_server_t* server, uint32_t channel_id);
+
+/**
+ * @private
+ * Remove a channel from the server and free it.
+ *
+ * @param[in] server  a pointer to the server.
+ * @param[in] channel a pointer to the channel.
+ */
+void mumble_server_remove_channel(struct mumble_server_t* server,
+                                  struct mumble_channel_t* channel);
+
+/**
+ * @private
+ * Queue a blob to be requested from the server.
+ *
+ * Requests are batched and sent in a single RequestBlob message by
+ * `mumble_server_send_blob_requests`.
+ *
+ * @param[in] server a pointer to the server.
+ * @param[in] kind   the kind of blob.
+ * @param[in] id     the session id of the user, or the channel id.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_server_request_blob(struct mumble_server_t* server,
+                               mumble_blob_kind_t kind, uint32_t id);
+
+/**
+ * @private
+ * Send a RequestBlob packet with all the queued blob requests, if any.
+ *
+ * @param[in] server a pointer to the server.
+ *
+ * @returns one if successful or nothing was queued, zero otherwise.
+ */
+int mumble_server_send_blob_requests(struct mumble_server_t* server);
+
+/**
+ * @private
+ * Called when the connection or TLS handshake takes too long.
+ */
+void mumble_server_connect_timeout(mumble_timer_t* timer);
+
+/**
+ * @private
+ * Called by the keepalive timer to check that the server is alive and send a
+ * ping packet.
  */
-void mumble_server_ping(EV_P_ ev_timer* w, int revents);
+void mumble_server_ping(mumble_timer_t* timer);
 
 #ifdef __cplusplus
 }
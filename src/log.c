@@ -1,11 +1,21 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <pthread.h>
 
 #include "log.h"
 
+/** The maximum number of arguments captured for a message. */
+#define LOG_MAX_ARGS 8
+/** The number of bytes of string arguments a record can hold. */
+#define LOG_STRING_SPACE 160
+/** The number of records in the ring of each thread. Must be a power of two. */
+#define LOG_RING_SIZE 1024
+
 /**
  * Strings representing each debug level.
  */
@@ -31,55 +41,706 @@ static const char* g_log_level_colors[] = {
 };
 
 /**
- * The default log-level.
+ * Names of the subsystems, as used in `LIBMUMBLE_LOG`.
  */
-static const int kLogLevel = LOG_LEVEL;
+static const char* g_log_subsystem_names[LOG_SUBSYSTEM_MAX] = {
+    "core",    /* LOG_SUBSYSTEM_CORE */
+    "net",     /* LOG_SUBSYSTEM_NET */
+    "protocol" /* LOG_SUBSYSTEM_PROTOCOL */
+};
 
-static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+int g_log_levels[LOG_SUBSYSTEM_MAX] = {LOG_LEVEL, LOG_LEVEL, LOG_LEVEL};
 
-static size_t log_write_timestamp(char* buffer, size_t size)
+/**
+ * The types of captured arguments.
+ */
+typedef enum log_arg_type_t
 {
-    size_t result;
-    time_t current_time = time(NULL);
-    struct tm local_time;
+    /** A conversion that isn't supported. Capturing stops here. */
+    LOG_ARG_NONE = 0,
+    /** A literal `%%`, which takes no argument. */
+    LOG_ARG_PERCENT,
+    LOG_ARG_INT,
+    LOG_ARG_LONG,
+    LOG_ARG_LLONG,
+    LOG_ARG_SIZE,
+    LOG_ARG_INTMAX,
+    LOG_ARG_PTRDIFF,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING
+} log_arg_type_t;
+
+/**
+ * A parsed conversion specification.
+ */
+typedef struct log_spec_t
+{
+    /** The type of the argument. */
+    log_arg_type_t type;
+    /** The number of `*` widths and precisions, which take an int each. */
+    int stars;
+} log_spec_t;
+
+/**
+ * A captured argument.
+ */
+typedef union log_arg_t
+{
+    intmax_t i;
+    double d;
+    const void* p;
+    /** The offset of a copied string in the strings of the record. */
+    size_t offset;
+} log_arg_t;
+
+/**
+ * A binary log record.
+ */
+typedef struct log_record_t
+{
+    /** The time the message was recorded at. */
+    time_t time;
+    /** The message format. */
+    const char* format;
+    /** The source file. */
+    const char* file;
+    /** The source line. */
+    unsigned long line;
+    /** The log level. */
+    log_level_t level;
+    /** The number of captured arguments, including `*` widths. */
+    unsigned int num_args;
+    /** The number of bytes used in `strings`. */
+    size_t length;
+    /** The captured arguments. */
+    log_arg_t args[LOG_MAX_ARGS];
+    /** Null-terminated copies of string arguments. */
+    char strings[LOG_STRING_SPACE];
+} log_record_t;
+
+/**
+ * A ring of records written by one thread and read by the writer.
+ *
+ * The producer and consumer indices are on separate cache lines so the two
+ * threads don't contend for them.
+ */
+typedef struct log_ring_t
+{
+    /** The index of the next record to write. Only the owner writes it. */
+    size_t head __attribute__((aligned(64)));
+    /** The index of the next record to read. Only the writer writes it. */
+    size_t tail __attribute__((aligned(64)));
+    /** The number of records dropped because the ring was full. */
+    unsigned long dropped;
+    /** Non-zero while a thread owns the ring. */
+    int owned;
+    /** The next ring in the list of all rings. */
+    struct log_ring_t* next;
+    /** The records. */
+    log_record_t records[LOG_RING_SIZE];
+} log_ring_t;
+
+/** All rings, including those of threads that have exited. */
+static log_ring_t* g_log_rings = NULL;
+/** The ring of the calling thread. */
+static __thread log_ring_t* t_log_ring = NULL;
 
-    if (localtime_r(&current_time, &local_time) == NULL)
-        return 0;
+static pthread_once_t g_log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_log_key;
+static pthread_t g_log_writer;
+static int g_log_writer_running = 0;
+static int g_log_writer_stop = 0;
+/** Serializes readers of the rings, which are the writer and `log_flush`. */
+static pthread_mutex_t g_log_drain_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** Guards parking and waking the writer. */
+static pthread_mutex_t g_log_wake_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** Signaled when the writer has something to do. */
+static pthread_cond_t g_log_wake_cond = PTHREAD_COND_INITIALIZER;
+/** Non-zero while the writer is parked, or about to be. */
+static int g_log_writer_parked = 0;
 
-    result = strftime(buffer, size, "%X", &local_time);
+/**
+ * Parse the conversion specification after a `%`.
+ *
+ * @returns a pointer to the character after the specification.
+ */
+static const char* log_parse_spec(const char* p, log_spec_t* spec)
+{
+    int length = 0;
+
+    spec->type = LOG_ARG_NONE;
+    spec->stars = 0;
+
+    if (*p == '%')
+    {
+        spec->type = LOG_ARG_PERCENT;
+
+        return p + 1;
+    }
+
+    while (*p && strchr("-+ #0", *p))
+        p++;
+
+    if (*p == '*')
+        spec->stars++, p++;
+    else
+        while (*p >= '0' && *p <= '9')
+            p++;
+
+    if (*p == '.')
+    {
+        p++;
+
+        if (*p == '*')
+            spec->stars++, p++;
+        else
+            while (*p >= '0' && *p <= '9')
+                p++;
+    }
+
+    switch (*p)
+    {
+        case 'h':
+            p += p[1] == 'h' ? 2 : 1;
+            break;
+        case 'l':
+            length = p[1] == 'l' ? LOG_ARG_LLONG : LOG_ARG_LONG;
+            p += p[1] == 'l' ? 2 : 1;
+            break;
+        case 'z':
+            length = LOG_ARG_SIZE, p++;
+            break;
+        case 'j':
+            length = LOG_ARG_INTMAX, p++;
+            break;
+        case 't':
+            length = LOG_ARG_PTRDIFF, p++;
+            break;
+        case 'L':
+            /* Long doubles aren't supported. */
+            return p;
+    }
 
-    return result;
+    switch (*p)
+    {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+            spec->type = length ? (log_arg_type_t)length : LOG_ARG_INT;
+            break;
+        case 'c':
+            spec->type = length ? LOG_ARG_NONE : LOG_ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E':
+        case 'g': case 'G': case 'a': case 'A':
+            spec->type = LOG_ARG_DOUBLE;
+            break;
+        case 's':
+            spec->type = length ? LOG_ARG_NONE : LOG_ARG_STRING;
+            break;
+        case 'p':
+            spec->type = LOG_ARG_POINTER;
+            break;
+        default:
+            return p;
+    }
+
+    return p + 1;
 }
 
-void log_write(log_level_t level, const char* func, const char* file,
-               unsigned long line, const char* format, ...)
+/**
+ * Capture the arguments of `format` into a record.
+ */
+static void log_capture(log_record_t* record, const char* format, va_list ap)
 {
-    (void)func;
-    static char time_buffer[12];
-    static char message_buffer[1024];
-    static char file_buffer[21];
-    va_list ap;
+    int i;
+    log_spec_t spec;
+    log_arg_t* arg;
+    const char* p = format;
 
-    if (level > kLogLevel)
-        return;
+    while ((p = strchr(p, '%')) != NULL)
+    {
+        p = log_parse_spec(p + 1, &spec);
 
-    va_start(ap, format);
-    pthread_mutex_lock(&log_mutex);
+        if (spec.type == LOG_ARG_PERCENT)
+            continue;
+
+        if (spec.type == LOG_ARG_NONE ||
+            record->num_args + spec.stars + 1 > LOG_MAX_ARGS)
+            return;
+
+        for (i = 0; i < spec.stars; i++)
+            record->args[record->num_args++].i = va_arg(ap, int);
+
+        arg = &record->args[record->num_args++];
+
+        switch (spec.type)
+        {
+            case LOG_ARG_INT:
+                arg->i = va_arg(ap, int);
+                break;
+            case LOG_ARG_LONG:
+                arg->i = va_arg(ap, long);
+                break;
+            case LOG_ARG_LLONG:
+                arg->i = va_arg(ap, long long);
+                break;
+            case LOG_ARG_SIZE:
+                arg->i = (intmax_t)va_arg(ap, size_t);
+                break;
+            case LOG_ARG_INTMAX:
+                arg->i = va_arg(ap, intmax_t);
+                break;
+            case LOG_ARG_PTRDIFF:
+                arg->i = va_arg(ap, ptrdiff_t);
+                break;
+            case LOG_ARG_DOUBLE:
+                arg->d = va_arg(ap, double);
+                break;
+            case LOG_ARG_POINTER:
+                arg->p = va_arg(ap, const void*);
+                break;
+            case LOG_ARG_STRING:
+            {
+                const char* string = va_arg(ap, const char*);
+                size_t space = LOG_STRING_SPACE - record->length;
+                size_t length;
+
+                if (!string)
+                    string = "(null)";
+
+                /* Copy as much as fits. The last string always has room for
+                 * at least its terminator. */
+                length = strlen(string);
+
+                if (length >= space)
+                    length = space - 1;
+
+                memcpy(record->strings + record->length, string, length);
+                record->strings[record->length + length] = '\0';
+                arg->offset = record->length;
+                record->length += length + 1;
+
+                /* Arguments after a full string buffer aren't captured. */
+                if (record->length == LOG_STRING_SPACE)
+                    return;
+
+                break;
+            }
+            default:
+                return;
+        }
+    }
+}
+
+/**
+ * Format one captured conversion into `out`.
+ *
+ * @returns the number of characters that would have been written.
+ */
+static int log_format_arg(char* out, size_t size, const char* spec,
+                          const log_spec_t* parsed, const log_record_t* record,
+                          const log_arg_t* args)
+{
+    int s0 = parsed->stars > 0 ? (int)args[0].i : 0;
+    int s1 = parsed->stars > 1 ? (int)args[1].i : 0;
+    const log_arg_t* arg = &args[parsed->stars];
+
+#define LOG_FORMAT_ARG(value)                                                  \
+    (parsed->stars == 0   ? snprintf(out, size, spec, value)                   \
+     : parsed->stars == 1 ? snprintf(out, size, spec, s0, value)               \
+                          : snprintf(out, size, spec, s0, s1, value))
+
+    switch (parsed->type)
+    {
+        case LOG_ARG_INT:
+            return LOG_FORMAT_ARG((int)arg->i);
+        case LOG_ARG_LONG:
+            return LOG_FORMAT_ARG((long)arg->i);
+        case LOG_ARG_LLONG:
+            return LOG_FORMAT_ARG((long long)arg->i);
+        case LOG_ARG_SIZE:
+            return LOG_FORMAT_ARG((size_t)arg->i);
+        case LOG_ARG_INTMAX:
+            return LOG_FORMAT_ARG(arg->i);
+        case LOG_ARG_PTRDIFF:
+            return LOG_FORMAT_ARG((ptrdiff_t)arg->i);
+        case LOG_ARG_DOUBLE:
+            return LOG_FORMAT_ARG(arg->d);
+        case LOG_ARG_POINTER:
+            return LOG_FORMAT_ARG(arg->p);
+        case LOG_ARG_STRING:
+            return LOG_FORMAT_ARG(record->strings + arg->offset);
+        default:
+            return 0;
+    }
+
+#undef LOG_FORMAT_ARG
+}
+
+/**
+ * Format the message of a record.
+ *
+ * Conversions that weren't captured are written as they are.
+ */
+static void log_format_message(const log_record_t* record, char* out,
+                               size_t size)
+{
+    log_spec_t spec;
+    char spec_buffer[32];
+    size_t pos = 0;
+    unsigned int arg = 0;
+    const char* p = record->format;
+
+    while (*p && pos + 1 < size)
+    {
+        const char* start = p;
+        size_t length;
+        int written = 0;
+
+        if (*p != '%')
+        {
+            out[pos++] = *p++;
+
+            continue;
+        }
+
+        p = log_parse_spec(p + 1, &spec);
+        length = (size_t)(p - start);
+
+        if (spec.type == LOG_ARG_PERCENT)
+        {
+            out[pos++] = '%';
+
+            continue;
+        }
+
+        if (spec.type != LOG_ARG_NONE && length < sizeof spec_buffer &&
+            arg + spec.stars + 1 <= record->num_args)
+        {
+            memcpy(spec_buffer, start, length);
+            spec_buffer[length] = '\0';
+
+            written = log_format_arg(out + pos, size - pos, spec_buffer, &spec,
+                                     record, &record->args[arg]);
+            arg += spec.stars + 1;
+        }
+        else
+        {
+            /* Nothing after this was captured. */
+            arg = record->num_args;
+            written = snprintf(out + pos, size - pos, "%.*s", (int)length,
+                               start);
+        }
+
+        if (written > 0)
+            pos += (size_t)written;
+
+        if (pos >= size)
+            pos = size - 1;
+    }
+
+    out[pos] = '\0';
+}
+
+/**
+ * Format and print a record.
+ */
+static void log_print(const log_record_t* record)
+{
+    char time_buffer[12];
+    char message_buffer[1024];
+    char file_buffer[21];
+    struct tm local_time;
+    const char* file = strrchr(record->file, '/');
+
+    file = file ? file + 1 : record->file;
 
     /* Write the file name and line number into `file_buffer.` */
-    snprintf(file_buffer, sizeof file_buffer, "%s:%lu", file, line);
+    snprintf(file_buffer, sizeof file_buffer, "%s:%lu", file, record->line);
 
-    /* Format and write the log message into `message_buffer.` */
-    vsnprintf(message_buffer, sizeof message_buffer, format, ap);
+    /* Format the log message into `message_buffer.` */
+    log_format_message(record, message_buffer, sizeof message_buffer);
 
     /* Write a timestamp into `time_buffer.` */
-    log_write_timestamp(time_buffer, sizeof time_buffer);
+    if (localtime_r(&record->time, &local_time) == NULL ||
+        strftime(time_buffer, sizeof time_buffer, "%X", &local_time) == 0)
+        time_buffer[0] = '\0';
 
     /* Now put it all together and print it. */
-    printf(LOG_FORMAT, time_buffer, file_buffer, g_log_level_colors[level - 1],
-           g_log_level_strings[level - 1], message_buffer);
+    printf(LOG_FORMAT, time_buffer, file_buffer,
+           g_log_level_colors[record->level - 1],
+           g_log_level_strings[record->level - 1], message_buffer);
+}
+
+/**
+ * Print all records in all rings.
+ *
+ * @returns the number of records printed.
+ */
+static size_t log_drain(void)
+{
+    log_ring_t* ring;
+    size_t count = 0;
+
+    pthread_mutex_lock(&g_log_drain_mutex);
+
+    for (ring = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE); ring != NULL;
+         ring = ring->next)
+    {
+        size_t tail = ring->tail;
+        size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        unsigned long dropped =
+            __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
 
-    pthread_mutex_unlock(&log_mutex);
+        for (; tail != head; tail++, count++)
+        {
+            log_print(&ring->records[tail & (LOG_RING_SIZE - 1)]);
+
+            /* Hand the slot back to the producer. */
+            __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+        }
+
+        if (dropped)
+        {
+            char message[64];
+
+            snprintf(message, sizeof message, "Dropped %lu log messages",
+                     dropped);
+            printf(LOG_FORMAT, "", "log.c",
+                   g_log_level_colors[LOG_LEVEL_WARN - 1],
+                   g_log_level_strings[LOG_LEVEL_WARN - 1], message);
+        }
+    }
+
+    if (count)
+        fflush(stdout);
+
+    pthread_mutex_unlock(&g_log_drain_mutex);
+
+    return count;
+}
+
+/**
+ * Check whether any ring has records that weren't printed yet.
+ */
+static int log_pending(void)
+{
+    log_ring_t* ring;
+
+    for (ring = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE); ring != NULL;
+         ring = ring->next)
+        if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) !=
+            __atomic_load_n(&ring->tail, __ATOMIC_RELAXED))
+            return 1;
+
+    return 0;
+}
+
+/**
+ * Wake the writer up if it's parked.
+ */
+static void log_wake(void)
+{
+    pthread_mutex_lock(&g_log_wake_mutex);
+    pthread_cond_signal(&g_log_wake_cond);
+    pthread_mutex_unlock(&g_log_wake_mutex);
+}
+
+static void* log_writer_main(void* arg)
+{
+    (void)arg;
+
+    while (!__atomic_load_n(&g_log_writer_stop, __ATOMIC_ACQUIRE))
+    {
+        if (log_drain() > 0)
+            continue;
+
+        /* Announce that the writer is about to park before looking at the
+         * rings one last time. A record published after that look sees the
+         * flag and signals, which can't happen before the wait as the mutex
+         * is held until then. */
+        pthread_mutex_lock(&g_log_wake_mutex);
+        __atomic_store_n(&g_log_writer_parked, 1, __ATOMIC_SEQ_CST);
+
+        if (!log_pending() &&
+            !__atomic_load_n(&g_log_writer_stop, __ATOMIC_ACQUIRE))
+            pthread_cond_wait(&g_log_wake_cond, &g_log_wake_mutex);
+
+        __atomic_store_n(&g_log_writer_parked, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&g_log_wake_mutex);
+    }
+
+    return NULL;
+}
+
+static void log_stop(void)
+{
+    if (g_log_writer_running)
+    {
+        __atomic_store_n(&g_log_writer_stop, 1, __ATOMIC_RELEASE);
+        log_wake();
+        pthread_join(g_log_writer, NULL);
+        g_log_writer_running = 0;
+    }
+
+    log_drain();
+}
+
+/**
+ * Give the ring of an exiting thread back, so another thread can use it.
+ */
+static void log_ring_release(void* ptr)
+{
+    log_ring_t* ring = (log_ring_t*)ptr;
+
+    __atomic_store_n(&ring->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void log_start(void)
+{
+    pthread_key_create(&g_log_key, log_ring_release);
+
+    /* Without a writer thread, records are printed by the thread that wrote
+     * them. */
+    g_log_writer_running =
+        pthread_create(&g_log_writer, NULL, log_writer_main, NULL) == 0;
+
+    atexit(log_stop);
+}
+
+/**
+ * Get the ring of the calling thread, adopting or creating one if needed.
+ */
+static log_ring_t* log_ring_get(void)
+{
+    log_ring_t* ring;
+
+    if (t_log_ring)
+        return t_log_ring;
+
+    pthread_once(&g_log_once, log_start);
+
+    for (ring = __atomic_load_n(&g_log_rings, __ATOMIC_ACQUIRE); ring != NULL;
+         ring = ring->next)
+    {
+        int expected = 0;
+
+        if (__atomic_compare_exchange_n(&ring->owned, &expected, 1, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+            break;
+    }
+
+    if (!ring)
+    {
+        if (posix_memalign((void**)&ring, 64, sizeof(log_ring_t)) != 0)
+            return NULL;
+
+        memset(ring, 0, sizeof(log_ring_t));
+        ring->owned = 1;
+        ring->next = __atomic_load_n(&g_log_rings, __ATOMIC_RELAXED);
+
+        while (!__atomic_compare_exchange_n(&g_log_rings, &ring->next, ring, 1,
+                                            __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED))
+            ;
+    }
+
+    pthread_setspecific(g_log_key, ring);
+    t_log_ring = ring;
+
+    return ring;
+}
+
+void log_write(log_level_t level, const char* file, unsigned long line,
+               const char* format, ...)
+{
+    va_list ap;
+    size_t head;
+    log_record_t* record;
+    log_ring_t* ring = log_ring_get();
+
+    if (!ring)
+        return;
+
+    head = ring->head;
+
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SIZE)
+    {
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+
+        return;
+    }
+
+    record = &ring->records[head & (LOG_RING_SIZE - 1)];
+    record->time = time(NULL);
+    record->format = format;
+    record->file = file;
+    record->line = line;
+    record->level = level;
+    record->num_args = 0;
+    record->length = 0;
+
+    va_start(ap, format);
+    log_capture(record, format, ap);
     va_end(ap);
+
+    /* Publish the record to the writer. The writer only parks once all
+     * rings are empty, so it's only woken by the first record after that. */
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+
+    if (level == LOG_LEVEL_FATAL || !g_log_writer_running)
+        log_flush();
+    else if (__atomic_load_n(&g_log_writer_parked, __ATOMIC_SEQ_CST))
+        log_wake();
 }
 
+void log_flush(void)
+{
+    log_drain();
+}
+
+int log_set_level(const char* subsystem, int level)
+{
+    int i;
+
+    for (i = 0; i < LOG_SUBSYSTEM_MAX; i++)
+    {
+        if (!subsystem || strcmp(subsystem, g_log_subsystem_names[i]) == 0)
+        {
+            __atomic_store_n(&g_log_levels[i], level, __ATOMIC_RELAXED);
+
+            if (subsystem)
+                return 0;
+        }
+    }
+
+    return subsystem != NULL;
+}
+
+void log_init(void)
+{
+    char buffer[128];
+    char* token, *save;
+    const char* value = getenv("LIBMUMBLE_LOG");
+
+    if (!value || strlen(value) >= sizeof buffer)
+        return;
+
+    strcpy(buffer, value);
+
+    for (token = strtok_r(buffer, ",", &save); token != NULL;
+         token = strtok_r(NULL, ",", &save))
+    {
+        char* level = strchr(token, '=');
+
+        if (level)
+        {
+            *level++ = '\0';
+            log_set_level(token, atoi(level));
+        }
+        else
+        {
+            log_set_level(NULL, atoi(token));
+        }
+    }
+}
@@ -21,6 +21,17 @@
  * @author Mikkel Kroman
  * @date 15 Jan 2015
  * @brief Logging facility for debugging purposes.
+ *
+ * Log calls don't format anything on the calling thread. The format string,
+ * its arguments and copies of any string arguments are stored as a binary
+ * record in a ring buffer that belongs to the thread, and a background writer
+ * thread formats and prints the records. The rings are single-producer,
+ * single-consumer and lock-free, so logging never blocks. If a ring is full,
+ * the record is dropped and counted.
+ *
+ * Messages above `LOG_LEVEL` are compiled out. The rest are filtered at
+ * runtime by the level of the subsystem of the source file, which is set with
+ * `LOG_SUBSYSTEM` before including this header.
  */
 
 #pragma once
@@ -54,6 +65,10 @@
 # define LOG_LEVEL 4
 #endif
 
+#ifndef LOG_SUBSYSTEM
+# define LOG_SUBSYSTEM LOG_SUBSYSTEM_CORE
+#endif
+
 /**
  * The different levels of logging.
  */
@@ -67,7 +82,44 @@ typedef enum log_level_t
 } log_level_t;
 
 /**
- * Write a log message.
+ * The subsystems that have their own runtime log level.
+ */
+typedef enum log_subsystem_t
+{
+    /** The client context, blob cache and everything else. */
+    LOG_SUBSYSTEM_CORE     = 0,
+    /** Connections, TLS and the send path. */
+    LOG_SUBSYSTEM_NET      = 1,
+    /** Packet handlers. */
+    LOG_SUBSYSTEM_PROTOCOL = 2,
+    LOG_SUBSYSTEM_MAX      = 3
+} log_subsystem_t;
+
+/**
+ * The runtime log level of each subsystem.
+ */
+extern int g_log_levels[LOG_SUBSYSTEM_MAX];
+
+/**
+ * Read the runtime log levels from the `LIBMUMBLE_LOG` environment variable.
+ *
+ * The variable is either a single level for all subsystems, or a comma
+ * separated list of `subsystem=level` pairs, e.g. `net=5,protocol=2`.
+ */
+void log_init(void);
+
+/**
+ * Set the runtime log level of a subsystem.
+ *
+ * @param[in] subsystem the name of the subsystem, or NULL for all of them.
+ * @param[in] level     the log level.
+ *
+ * @returns zero on success, non-zero if the subsystem is unknown.
+ */
+int log_set_level(const char* subsystem, int level);
+
+/**
+ * Record a log message.
  *
  * The log format is:
  * 00:00:00 file.c:10       Debug    Message
@@ -76,23 +128,32 @@ typedef enum log_level_t
  * source line, Debug is the log level and Message is the message provided in
  * `format`.
  *
+ * `format` has to outlive the process, which string literals do. Integer,
+ * floating point, pointer and string conversions are supported, and strings
+ * are copied, truncated if they don't fit in the record.
+ *
  * @param[in] level  the log level.
- * @param[in] func   the current function name.
  * @param[in] file   the current source file.
  * @param[in] line   the current source line.
  * @param[in] format the message format.
  * @param[in] ...    arguments to be formatted into the message.
  */
-void log_write(log_level_t level, const char* func, const char* file,
-               unsigned long line, const char* format, ...);
+void log_write(log_level_t level, const char* file, unsigned long line,
+               const char* format, ...);
 
-#define __FILENAME__                                                           \
-    (strrchr(__FILE__, '/') ? strrchr(__FILE__, '/') + 1 : __FILE__)
+/**
+ * Write all recorded messages before returning.
+ *
+ * This is called for fatal messages and when the process exits.
+ */
+void log_flush(void);
 
 #define LOG_WRITE(level, ...)                                                  \
     do                                                                         \
     {                                                                          \
-        log_write(level, __FUNCTION__, __FILENAME__, __LINE__, __VA_ARGS__);   \
+        if ((int)(level) <= __atomic_load_n(&g_log_levels[LOG_SUBSYSTEM],     \
+                                            __ATOMIC_RELAXED))                 \
+            log_write(level, __FILE__, __LINE__, __VA_ARGS__);                 \
     } while (0)
 
 #if LOG_LEVEL >= 1
@@ -0,0 +1,174 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "map.h"
+
+/**
+ * Get the preferred slot of a key (Fibonacci hashing).
+ *
+ * The top bits of the product are used, since they depend on every bit of
+ * the key. The low bits only depend on the low bits of the key, so keys that
+ * are multiples of the capacity would all land in the same slot.
+ */
+static size_t map_slot(const mumble_map_t* map, uint32_t key)
+{
+    return (size_t)((uint32_t)(key * 2654435769u) >> map->shift);
+}
+
+static int map_alloc(mumble_map_t* map, size_t capacity)
+{
+    unsigned int bits = 0;
+
+    while (((size_t)1 << bits) < capacity)
+        bits++;
+
+    map->keys = (uint32_t*)malloc(capacity * sizeof(uint32_t));
+    map->values = (uintptr_t*)malloc(capacity * sizeof(uintptr_t));
+    map->used = (uint8_t*)calloc(capacity, sizeof(uint8_t));
+
+    if (!map->keys || !map->values || !map->used)
+    {
+        free(map->keys);
+        free(map->values);
+        free(map->used);
+
+        return 1;
+    }
+
+    map->capacity = capacity;
+    map->shift = 32 - bits;
+    map->size = 0;
+
+    return 0;
+}
+
+/**
+ * Double the capacity of the map and reinsert all entries.
+ */
+static int map_grow(mumble_map_t* map)
+{
+    size_t i;
+    mumble_map_t old = *map;
+
+    if (map_alloc(map, old.capacity * 2) != 0)
+    {
+        *map = old;
+
+        return 1;
+    }
+
+    for (i = 0; i < old.capacity; i++)
+        if (old.used[i])
+            mumble_map_set(map, old.keys[i], old.values[i]);
+
+    free(old.keys);
+    free(old.values);
+    free(old.used);
+
+    return 0;
+}
+
+int mumble_map_init(mumble_map_t* map)
+{
+    if (!map)
+        return 1;
+
+    return map_alloc(map, kMumbleMapCapacity);
+}
+
+void mumble_map_free(mumble_map_t* map)
+{
+    if (!map)
+        return;
+
+    free(map->keys);
+    free(map->values);
+    free(map->used);
+
+    map->keys = NULL;
+    map->values = NULL;
+    map->used = NULL;
+    map->capacity = 0;
+    map->size = 0;
+}
+
+void mumble_map_clear(mumble_map_t* map)
+{
+    memset(map->used, 0, map->capacity);
+    map->size = 0;
+}
+
+int mumble_map_get(const mumble_map_t* map, uint32_t key, uintptr_t* value)
+{
+    size_t i;
+
+    for (i = map_slot(map, key); map->used[i]; i = (i + 1) & (map->capacity - 1))
+    {
+        if (map->keys[i] == key)
+        {
+            if (value)
+                *value = map->values[i];
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int mumble_map_set(mumble_map_t* map, uint32_t key, uintptr_t value)
+{
+    size_t i;
+
+    /* Keep the load factor below 3/4. */
+    if ((map->size + 1) * 4 > map->capacity * 3 && map_grow(map) != 0)
+        return 1;
+
+    for (i = map_slot(map, key); map->used[i]; i = (i + 1) & (map->capacity - 1))
+    {
+        if (map->keys[i] == key)
+        {
+            map->values[i] = value;
+
+            return 0;
+        }
+    }
+
+    map->used[i] = 1;
+    map->keys[i] = key;
+    map->values[i] = value;
+    map->size++;
+
+    return 0;
+}
+
+int mumble_map_remove(mumble_map_t* map, uint32_t key)
+{
+    size_t i, j, k;
+    size_t mask = map->capacity - 1;
+
+    for (i = map_slot(map, key); map->used[i]; i = (i + 1) & mask)
+        if (map->keys[i] == key)
+            break;
+
+    if (!map->used[i])
+        return 0;
+
+    /* Shift back any following entries that would be cut off by the hole. */
+    for (j = (i + 1) & mask; map->used[j]; j = (j + 1) & mask)
+    {
+        k = map_slot(map, map->keys[j]);
+
+        if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j)))
+        {
+            map->keys[i] = map->keys[j];
+            map->values[i] = map->values[j];
+            i = j;
+        }
+    }
+
+    map->used[i] = 0;
+    map->size--;
+
+    return 1;
+}
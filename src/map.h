@@ -0,0 +1,121 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file map.h
+ * @brief Open-addressing hash map from 32-bit ids to pointer-sized values.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_MAP_H
+#define MUMBLE_MAP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The initial capacity of a map. Must be a power of two.
+ */
+static const size_t kMumbleMapCapacity = 16;
+
+/**
+ * The map structure.
+ *
+ * Collisions are resolved with linear probing, and removal shifts entries
+ * back instead of leaving tombstones, so lookups stay short under churn.
+ */
+typedef struct mumble_map_t
+{
+    /** The keys of each slot. */
+    uint32_t* keys;
+    /** The values of each slot. */
+    uintptr_t* values;
+    /** Non-zero for each slot that is in use. */
+    uint8_t* used;
+    /** The number of slots. This is always a power of two. */
+    size_t capacity;
+    /** The shift that takes a hash down to a slot, 32 - log2(capacity). */
+    unsigned int shift;
+    /** The number of slots in use. */
+    size_t size;
+} mumble_map_t;
+
+/**
+ * Initialize a map.
+ *
+ * @param[in] map a pointer to memory space to initialize.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_map_init(mumble_map_t* map);
+
+/**
+ * Free the memory used by a map.
+ *
+ * @param[in] map a pointer to the map.
+ */
+void mumble_map_free(mumble_map_t* map);
+
+/**
+ * Remove all entries from a map without releasing its memory.
+ *
+ * @param[in] map a pointer to the map.
+ */
+void mumble_map_clear(mumble_map_t* map);
+
+/**
+ * Look up the value of a key.
+ *
+ * @param[in]  map   a pointer to the map.
+ * @param[in]  key   the key.
+ * @param[out] value a pointer to store the value in, or NULL.
+ *
+ * @returns one if the key was found, zero otherwise.
+ */
+int mumble_map_get(const mumble_map_t* map, uint32_t key, uintptr_t* value);
+
+/**
+ * Insert or replace the value of a key.
+ *
+ * @param[in] map   a pointer to the map.
+ * @param[in] key   the key.
+ * @param[in] value the value.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_map_set(mumble_map_t* map, uint32_t key, uintptr_t value);
+
+/**
+ * Remove a key from a map.
+ *
+ * @param[in] map a pointer to the map.
+ * @param[in] key the key.
+ *
+ * @returns one if the key was removed, zero if it wasn't found.
+ */
+int mumble_map_remove(mumble_map_t* map, uint32_t key);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_MAP_H */
@@ -0,0 +1,345 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include "metrics.h"
+#include "iserver.h"
+#include "internal.h"
+
+/**
+ * Output of the metrics renderer, with `snprintf` semantics.
+ */
+typedef struct mumble_metrics_writer_t
+{
+    /** The output buffer, or NULL. */
+    char* buffer;
+    /** The size of the output buffer. */
+    size_t size;
+    /** The length of the full output so far. */
+    size_t length;
+} mumble_metrics_writer_t;
+
+/**
+ * A per-server counter that is labeled by packet type.
+ */
+typedef struct mumble_packet_metric_t
+{
+    const char* name;
+    const char* help;
+    /** The offset of the counter array in `mumble_server_metrics_t`. */
+    size_t offset;
+    /** The factor to scale the counter to the base unit with. */
+    double scale;
+} mumble_packet_metric_t;
+
+/**
+ * A per-server value.
+ */
+typedef struct mumble_server_metric_t
+{
+    const char* name;
+    const char* help;
+    /** Either `counter` or `gauge`. */
+    const char* type;
+    /** Get the value of the metric of a server. */
+    double (*value)(const struct mumble_server_t* server);
+} mumble_server_metric_t;
+
+static const mumble_packet_metric_t kMumblePacketMetrics[] = {
+    {"mumble_packets_received_total", "Packets received, by type.",
+     offsetof(mumble_server_metrics_t, packets_in), 1},
+    {"mumble_packet_bytes_received_total",
+     "Bytes received, by packet type, including headers.",
+     offsetof(mumble_server_metrics_t, bytes_in), 1},
+    {"mumble_packet_decode_seconds_total",
+     "Time spent decoding and handling packets, by type.",
+     offsetof(mumble_server_metrics_t, decode_ns), 1e-9},
+    {"mumble_packets_sent_total", "Packets queued for sending, by type.",
+     offsetof(mumble_server_metrics_t, packets_out), 1},
+    {"mumble_packet_bytes_sent_total",
+     "Bytes queued for sending, by packet type, including headers.",
+     offsetof(mumble_server_metrics_t, bytes_out), 1},
+};
+
+#define MUMBLE_SERVER_COUNTER(field)                                           \
+    static double mumble_metric_##field(const struct mumble_server_t* server) \
+    {                                                                          \
+        return (double)server->metrics.field;                                  \
+    }
+
+MUMBLE_SERVER_COUNTER(packets_rejected)
+MUMBLE_SERVER_COUNTER(tls_bytes_read)
+MUMBLE_SERVER_COUNTER(tls_bytes_written)
+MUMBLE_SERVER_COUNTER(allocations)
+MUMBLE_SERVER_COUNTER(pending_max)
+MUMBLE_SERVER_COUNTER(rbuffer_max)
+MUMBLE_SERVER_COUNTER(connects)
+MUMBLE_SERVER_COUNTER(disconnects)
+
+#undef MUMBLE_SERVER_COUNTER
+
+static double mumble_metric_voice_dropped(const struct mumble_server_t* server)
+{
+    return (double)server->voice_dropped;
+}
+
+static double
+mumble_metric_throttled_bytes(const struct mumble_server_t* server)
+{
+    return (double)server->throttled_bytes;
+}
+
+static double mumble_metric_pending(const struct mumble_server_t* server)
+{
+    return (double)mumble_server_get_pending_bytes(server);
+}
+
+static double mumble_metric_handshake(const struct mumble_server_t* server)
+{
+    return server->metrics.handshake_us / 1e6;
+}
+
+static double mumble_metric_rtt(const struct mumble_server_t* server)
+{
+    return server->ping_stats.srtt / 1e6;
+}
+
+static double mumble_metric_missed_pings(const struct mumble_server_t* server)
+{
+    return (double)server->missed_pings;
+}
+
+static const mumble_server_metric_t kMumbleServerMetrics[] = {
+    {"mumble_packets_rejected_total",
+     "Packets turned away at the high watermark.", "counter",
+     mumble_metric_packets_rejected},
+    {"mumble_voice_packets_dropped_total",
+     "Voice packets dropped after missing their deadline.", "counter",
+     mumble_metric_voice_dropped},
+    {"mumble_voice_bytes_throttled_total",
+     "Voice bytes held back by the bandwidth shaper.", "counter",
+     mumble_metric_throttled_bytes},
+    {"mumble_tls_bytes_read_total", "Decrypted bytes read.", "counter",
+     mumble_metric_tls_bytes_read},
+    {"mumble_tls_bytes_written_total", "Plaintext bytes written.", "counter",
+     mumble_metric_tls_bytes_written},
+    {"mumble_allocations_total",
+     "Allocations made for sending and receiving.", "counter",
+     mumble_metric_allocations},
+    {"mumble_connects_total", "Completed TLS handshakes.", "counter",
+     mumble_metric_connects},
+    {"mumble_disconnects_total", "Lost connections.", "counter",
+     mumble_metric_disconnects},
+    {"mumble_send_queue_bytes", "Bytes waiting to be sent.", "gauge",
+     mumble_metric_pending},
+    {"mumble_send_queue_bytes_max", "Most bytes that have waited to be sent.",
+     "gauge", mumble_metric_pending_max},
+    {"mumble_read_buffer_bytes_max",
+     "Most bytes that have waited in the read buffer.", "gauge",
+     mumble_metric_rbuffer_max},
+    {"mumble_handshake_seconds",
+     "Time the last connect and TLS handshake took.", "gauge",
+     mumble_metric_handshake},
+    {"mumble_ping_rtt_seconds", "Smoothed round-trip time of pings.", "gauge",
+     mumble_metric_rtt},
+    {"mumble_ping_missed", "Pings in a row without a reply.", "gauge",
+     mumble_metric_missed_pings},
+};
+
+static void mumble_metrics_printf(mumble_metrics_writer_t* writer,
+                                  const char* format, ...)
+{
+    int result;
+    va_list ap;
+    char* output = NULL;
+    size_t space = 0;
+
+    if (writer->buffer && writer->length < writer->size)
+    {
+        output = writer->buffer + writer->length;
+        space = writer->size - writer->length;
+    }
+
+    va_start(ap, format);
+    result = vsnprintf(output, space, format, ap);
+    va_end(ap);
+
+    if (result > 0)
+        writer->length += (size_t)result;
+}
+
+static void mumble_metrics_header(mumble_metrics_writer_t* writer,
+                                  const char* name, const char* help,
+                                  const char* type)
+{
+    mumble_metrics_printf(writer, "# HELP %s %s\n# TYPE %s %s\n", name, help,
+                          name, type);
+}
+
+/**
+ * Write the `server` label of a server, escaping the host name.
+ */
+static void mumble_metrics_server_label(mumble_metrics_writer_t* writer,
+                                        const struct mumble_server_t* server)
+{
+    const char* p;
+
+    mumble_metrics_printf(writer, "server=\"");
+
+    for (p = server->host ? server->host : ""; *p; p++)
+    {
+        if (*p == '\\' || *p == '"')
+            mumble_metrics_printf(writer, "\\%c", *p);
+        else if (*p == '\n')
+            mumble_metrics_printf(writer, "\\n");
+        else
+            mumble_metrics_printf(writer, "%c", *p);
+    }
+
+    mumble_metrics_printf(writer, ":%u\"", server->port);
+}
+
+static void mumble_metrics_value(mumble_metrics_writer_t* writer,
+                                 const char* name,
+                                 const struct mumble_server_t* server,
+                                 const char* type, double value)
+{
+    mumble_metrics_printf(writer, "%s{", name);
+    mumble_metrics_server_label(writer, server);
+
+    if (type)
+        mumble_metrics_printf(writer, ",type=\"%s\"", type);
+
+    /* Counters are printed exactly, everything else with enough precision. */
+    if (value >= 0 && value < 9007199254740992.0 &&
+        value == (double)(uint64_t)value)
+        mumble_metrics_printf(writer, "} %.0f\n", value);
+    else
+        mumble_metrics_printf(writer, "} %.9g\n", value);
+}
+
+size_t mumble_render_metrics(struct mumble_t* client, char* buffer,
+                             size_t size)
+{
+    size_t i;
+    int type;
+    struct mumble_server_t* server;
+    mumble_metrics_writer_t writer;
+
+    writer.buffer = buffer;
+    writer.size = size;
+    writer.length = 0;
+
+    if (buffer && size > 0)
+        buffer[0] = '\0';
+
+    if (!client)
+        return 0;
+
+    /* Counters of the event loop. */
+    mumble_metrics_header(&writer, "mumble_loop_iterations_total",
+                          "Event loop iterations.", "counter");
+    mumble_metrics_printf(&writer, "mumble_loop_iterations_total %u\n",
+                          ev_iteration(client->loop));
+    mumble_metrics_header(&writer, "mumble_read_events_total",
+                          "Times a server socket was readable.", "counter");
+    mumble_metrics_printf(&writer, "mumble_read_events_total %llu\n",
+                          (unsigned long long)client->metrics.read_events);
+    mumble_metrics_header(&writer, "mumble_write_events_total",
+                          "Times a server socket was writable.", "counter");
+    mumble_metrics_printf(&writer, "mumble_write_events_total %llu\n",
+                          (unsigned long long)client->metrics.write_events);
+    mumble_metrics_header(&writer, "mumble_timers_expired_total",
+                          "Timers that have expired.", "counter");
+    mumble_metrics_printf(&writer, "mumble_timers_expired_total %llu\n",
+                          (unsigned long long)client->timers.expired);
+    mumble_metrics_header(&writer, "mumble_timers", "Active timers.", "gauge");
+    mumble_metrics_printf(&writer, "mumble_timers %zu\n",
+                          client->timers.count);
+    mumble_metrics_header(&writer, "mumble_servers", "Attached servers.",
+                          "gauge");
+    mumble_metrics_printf(&writer, "mumble_servers %d\n", client->num_servers);
+    mumble_metrics_header(&writer, "mumble_interned_strings",
+                          "Distinct interned strings.", "gauge");
+    mumble_metrics_printf(&writer, "mumble_interned_strings %zu\n",
+                          client->strings.num_entries);
+    mumble_metrics_header(&writer, "mumble_blob_cache_blobs",
+                          "Comments, descriptions and textures in memory.",
+                          "gauge");
+    mumble_metrics_printf(&writer, "mumble_blob_cache_blobs %zu\n",
+                          client->blobs.num_blobs);
+    mumble_metrics_header(&writer, "mumble_buffer_pool_blocks",
+                          "Free buffers kept for reuse by servers.", "gauge");
+    mumble_metrics_printf(&writer, "mumble_buffer_pool_blocks %zu\n",
+                          client->buffers.num_free);
+
+    /* Counters of each server, by packet type. Types that were never seen
+     * are left out. */
+    for (i = 0; i < sizeof kMumblePacketMetrics / sizeof *kMumblePacketMetrics;
+         i++)
+    {
+        const mumble_packet_metric_t* metric = &kMumblePacketMetrics[i];
+
+        mumble_metrics_header(&writer, metric->name, metric->help, "counter");
+
+        for (server = client->servers; server != NULL; server = server->next)
+        {
+            const uint64_t* counters =
+                (const uint64_t*)((const char*)&server->metrics +
+                                  metric->offset);
+
+            for (type = 0; type < MUMBLE_PACKET_MAX; type++)
+                if (counters[type])
+                    mumble_metrics_value(
+                        &writer, metric->name, server,
+                        mumble_packet_name((mumble_packet_type_t)type),
+                        counters[type] * metric->scale);
+        }
+    }
+
+    /* Other counters and gauges of each server. */
+    for (i = 0; i < sizeof kMumbleServerMetrics / sizeof *kMumbleServerMetrics;
+         i++)
+    {
+        const mumble_server_metric_t* metric = &kMumbleServerMetrics[i];
+
+        mumble_metrics_header(&writer, metric->name, metric->help,
+                              metric->type);
+
+        for (server = client->servers; server != NULL; server = server->next)
+            mumble_metrics_value(&writer, metric->name, server, NULL,
+                                 metric->value(server));
+    }
+
+    return writer.length;
+}
+
+void* mumble_aligned_alloc(size_t size)
+{
+#ifdef _WIN32
+    return _aligned_malloc(size, MUMBLE_CACHE_LINE);
+#else
+    void* ptr;
+
+    if (posix_memalign(&ptr, MUMBLE_CACHE_LINE, size) != 0)
+        return NULL;
+
+    return ptr;
+#endif
+}
+
+void mumble_aligned_free(void* ptr)
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
@@ -0,0 +1,120 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file metrics.h
+ * @brief Per-server and per-loop counters.
+ *
+ * Counters are plain integers that are only written by the thread that runs
+ * the event loop, so updating them costs no more than an increment. Each
+ * block of counters starts on its own cache line. They are read and summed
+ * up when the metrics are rendered, which has to happen on the same thread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol.h"
+
+#pragma once
+#ifndef MUMBLE_METRICS_H
+#define MUMBLE_METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The assumed size of a cache line, in bytes. */
+#define MUMBLE_CACHE_LINE 64
+
+#ifdef _MSC_VER
+# define MUMBLE_CACHE_ALIGNED __declspec(align(MUMBLE_CACHE_LINE))
+#else
+# define MUMBLE_CACHE_ALIGNED __attribute__((aligned(MUMBLE_CACHE_LINE)))
+#endif
+
+/**
+ * Counters of a single server connection.
+ */
+typedef struct MUMBLE_CACHE_ALIGNED mumble_server_metrics_t
+{
+    /** The number of packets handled, by type. */
+    uint64_t packets_in[MUMBLE_PACKET_MAX];
+    /** The number of bytes handled, by type, including headers. */
+    uint64_t bytes_in[MUMBLE_PACKET_MAX];
+    /** The number of nanoseconds spent decoding and handling, by type. */
+    uint64_t decode_ns[MUMBLE_PACKET_MAX];
+    /** The number of packets queued for sending, by type. */
+    uint64_t packets_out[MUMBLE_PACKET_MAX];
+    /** The number of bytes queued for sending, by type, including headers. */
+    uint64_t bytes_out[MUMBLE_PACKET_MAX];
+    /** The number of packets turned away at the high watermark. */
+    uint64_t packets_rejected;
+    /** The number of decrypted bytes read from the connection. */
+    uint64_t tls_bytes_read;
+    /** The number of plaintext bytes written to the connection. */
+    uint64_t tls_bytes_written;
+    /** The number of allocations made for sending and receiving. */
+    uint64_t allocations;
+    /** The highest number of bytes waiting to be sent. */
+    uint64_t pending_max;
+    /** The highest number of bytes waiting in the read buffer. */
+    uint64_t rbuffer_max;
+    /** The number of completed TLS handshakes. */
+    uint64_t connects;
+    /** The number of lost connections. */
+    uint64_t disconnects;
+    /** The time the current connection attempt started, in microseconds. */
+    uint64_t connect_start;
+    /** The number of microseconds the last connect and handshake took. */
+    uint64_t handshake_us;
+} mumble_server_metrics_t;
+
+/**
+ * Counters of an event loop, shared by all servers of a client context.
+ */
+typedef struct MUMBLE_CACHE_ALIGNED mumble_loop_metrics_t
+{
+    /** The number of times a server socket was readable. */
+    uint64_t read_events;
+    /** The number of times a server socket was writable. */
+    uint64_t write_events;
+} mumble_loop_metrics_t;
+
+/**
+ * Allocate memory aligned to a cache line.
+ *
+ * @param[in] size the number of bytes to allocate.
+ *
+ * @returns a pointer to the memory, or NULL. Free it with
+ *   `mumble_aligned_free`.
+ */
+void* mumble_aligned_alloc(size_t size);
+
+/**
+ * Free memory allocated with `mumble_aligned_alloc`.
+ *
+ * @param[in] ptr a pointer to the memory, or NULL.
+ */
+void mumble_aligned_free(void* ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_METRICS_H */
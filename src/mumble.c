@@ -18,6 +18,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <mumble/mumble.h>
@@ -30,15 +31,21 @@ const mumble_version_t kMumbleClientVersion = {1, 2, 8};
 
 struct mumble_t* mumble_new(mumble_settings_t settings)
 {
-    struct mumble_t* client = (struct mumble_t*)malloc(sizeof(struct mumble_t));
+    struct mumble_t* client =
+        (struct mumble_t*)mumble_aligned_alloc(sizeof(struct mumble_t));
 
     if (!client)
         return NULL;
 
+    memset(client, 0, sizeof *client);
     client->settings = settings;
 
     if (mumble_init(client) != 0)
+    {
+        mumble_free(client);
+
         return NULL;
+    }
 
     return client;
 }
@@ -60,12 +67,28 @@ int mumble_init(struct mumble_t* client)
     client->servers = NULL;
     client->num_servers = 0;
 
+    log_init();
+
+    if (mumble_intern_init(&client->strings) != 0)
+        return 1;
+
+    if (mumble_blob_cache_init(&client->blobs,
+                               client->settings.blob_cache_path) != 0)
+        return 1;
+
     if (mumble_ssl_init(client) != 0)
         return 1;
 
     /* Initialize a new event loop. */
     client->loop = ev_loop_new(0);
 
+    if (!client->loop)
+        return 1;
+
+    mumble_timer_wheel_init(&client->timers, client->loop);
+    mumble_buffer_pool_init(&client->buffers, client->settings.buffer_size,
+                            client->settings.buffer_size_cap);
+
     return 0;
 }
 
@@ -85,6 +108,10 @@ int mumble_ssl_init(struct mumble_t* client)
         return 1;
     }
 
+    /* Servers let users without a certificate in as guests. */
+    if (!client->settings.cert_file && !client->settings.key_file)
+        return 0;
+
     if (!SSL_CTX_use_certificate_chain_file(client->ssl_ctx,
                                             client->settings.cert_file))
     {
@@ -121,14 +148,29 @@ void mumble_free(struct mumble_t* client)
         mumble_server_free(ptr);
     }
 
+    /* Free the string table after the servers that reference it. */
+    mumble_intern_free(&client->strings);
+    mumble_blob_cache_free(&client->blobs);
+
+    /* The servers have given their buffers back by now. */
+    mumble_buffer_pool_free(&client->buffers);
+
     /* Free SSL resources. */
     SSL_CTX_free(client->ssl_ctx);
 
     /* Close any open connections and stop the event loop. */
     if (client->loop)
+    {
+        mumble_timer_wheel_free(&client->timers);
         ev_loop_destroy(client->loop);
+    }
 
-    free(client);
+    mumble_aligned_free(client);
+}
+
+int mumble_set_log_level(const char* subsystem, int level)
+{
+    return log_set_level(subsystem, level);
 }
 
 int mumble_connect(struct mumble_t* client, struct mumble_server_t* server)
@@ -136,6 +178,16 @@ int mumble_connect(struct mumble_t* client, struct mumble_server_t* server)
     if (!client || !server)
         return 1;
 
+    mumble_attach(client, server);
+
+    if (mumble_server_connect(server) != 0)
+        return 1;
+
+    return 0;
+}
+
+void mumble_attach(struct mumble_t* client, struct mumble_server_t* server)
+{
     if (client->servers)
         server->next = client->servers;
     else
@@ -145,10 +197,14 @@ int mumble_connect(struct mumble_t* client, struct mumble_server_t* server)
     client->servers = server;
     server->client = client;
 
-    if (mumble_server_connect(server) != 0)
-        return 1;
+    /* Draw the read buffer from the pool of the client from now on. */
+    mumble_buffer_free(&server->rbuffer);
+    mumble_buffer_init_pooled(&server->rbuffer, &client->buffers);
+}
 
-    return 0;
+struct ev_loop* mumble_get_loop(struct mumble_t* client)
+{
+    return client->loop;
 }
 
 int mumble_run(struct mumble_t* client)
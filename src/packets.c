@@ -1,23 +1,102 @@
 #include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
 
 #include <mumble/server.h>
 #include <mumble/channel.h>
 #include <mumble/user.h>
 #include "protocol.h"
 #include "packets.h"
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_PROTOCOL
 #include "log.h"
 #include "iserver.h"
+#include "internal.h"
+#include "intern.h"
+#include "blob.h"
+#include "wire.h"
+#include "clock.h"
 #include "Mumble.pb-c.h"
 
+/**
+ * Update a blob-backed field of a user or channel.
+ *
+ * If the data itself is present it is added to the blob cache. If only the
+ * hash is present, the blob is looked up in the cache, and requested from the
+ * server if it isn't cached.
+ *
+ * @param[in] server a pointer to the server.
+ * @param[in] slot   a pointer to the blob currently held by the field.
+ * @param[in] data   the inline data, or NULL if not present.
+ * @param[in] size   the size of the inline data.
+ * @param[in] hash   the blob hash. Its data is NULL if not present.
+ * @param[in] kind   the kind of blob, in case it has to be requested.
+ * @param[in] id     the user session or channel id the blob belongs to.
+ *
+ * @returns one if the field changed, zero otherwise.
+ */
+static int mumble_packet_update_blob(struct mumble_server_t* server,
+                                     mumble_blob_t** slot, const uint8_t* data,
+                                     size_t size,
+                                     const mumble_wire_slice_t* hash,
+                                     mumble_blob_kind_t kind, uint32_t id)
+{
+    mumble_blob_t* blob = NULL;
+    mumble_blob_cache_t* blobs = &server->client->blobs;
+
+    if (data != NULL)
+    {
+        /* An empty value means the field was cleared. */
+        if (size > 0)
+            blob = mumble_blob_cache_put(blobs, data, size);
+    }
+    else if (hash->data != NULL)
+    {
+        if (mumble_blob_has_hash(*slot, hash->data, hash->length))
+            return 0;
+
+        blob = mumble_blob_cache_get(blobs, hash->data, hash->length);
+
+        if (blob == NULL)
+        {
+            mumble_server_request_blob(server, kind, id);
+
+            return 0;
+        }
+    }
+    else
+        return 0;
+
+    mumble_blob_release(*slot);
+    *slot = blob;
+
+    return 1;
+}
+
 int mumble_packet_handle_ping(struct mumble_server_t* srv, const uint8_t* body,
                               uint32_t length)
 {
-    (void)srv;
-    MumbleProto__Ping* ping = mumble_proto__ping__unpack(NULL, length, body);
+    uint64_t now;
+    mumble_wire_ping_t ping;
+
+    if (mumble_wire_parse_ping(body, length, &ping) != 0)
+    {
+        LOG_WARN("Could not parse ping packet");
+
+        return 1;
+    }
+
+    now = mumble_clock_us();
 
-    LOG_DEBUG("Received ping packet");
+    /* Replies carry the timestamp of the ping they answer. */
+    if (ping.has_timestamp && ping.timestamp <= now)
+    {
+        mumble_ping_stats_update(&srv->ping_stats, now - ping.timestamp);
 
-    mumble_proto__ping__free_unpacked(ping, NULL);
+        LOG_DEBUG("Received ping reply (rtt=%" PRIu64 "us srtt=%" PRIu64
+                  "us rttvar=%" PRIu64 "us)",
+                  now - ping.timestamp, srv->ping_stats.srtt,
+                  srv->ping_stats.rttvar);
+    }
 
     return 1;
 }
@@ -29,6 +108,13 @@ int mumble_packet_handle_crypt_setup(struct mumble_server_t* srv,
     MumbleProto__CryptSetup* crypt_setup =
         mumble_proto__crypt_setup__unpack(NULL, length, body);
 
+    if (!crypt_setup)
+    {
+        LOG_WARN("Could not unpack crypt setup packet");
+
+        return 1;
+    }
+
     LOG_DEBUG("Received crypt setup packet");
 
     mumble_proto__crypt_setup__free_unpacked(crypt_setup, NULL);
@@ -43,6 +129,13 @@ int mumble_packet_handle_codec_version(struct mumble_server_t* srv,
     MumbleProto__CodecVersion* codec_version =
         mumble_proto__codec_version__unpack(NULL, length, body);
 
+    if (!codec_version)
+    {
+        LOG_WARN("Could not unpack codec version packet");
+
+        return 1;
+    }
+
     LOG_DEBUG("Server codec (opus=%u)", codec_version->opus);
 
     mumble_proto__codec_version__free_unpacked(codec_version, NULL);
@@ -55,12 +148,25 @@ int mumble_packet_handle_server_sync(struct mumble_server_t* srv,
     MumbleProto__ServerSync* server_sync =
         mumble_proto__server_sync__unpack(NULL, length, body);
 
+    if (!server_sync)
+    {
+        LOG_WARN("Could not unpack server sync packet");
+
+        return 1;
+    }
+
     if (server_sync->has_session)
         srv->session = server_sync->session;
 
     if (server_sync->has_max_bandwidth)
+    {
         srv->max_bandwidth = server_sync->max_bandwidth;
 
+        /* Shape outgoing voice to the bandwidth the server allows. */
+        mumble_token_bucket_init(&srv->shaper, srv->max_bandwidth / 8.0,
+                                 mumble_clock_us());
+    }
+
     if (server_sync->welcome_text != NULL)
     {
         if (srv->welcome_text)
@@ -77,6 +183,8 @@ int mumble_packet_handle_server_sync(struct mumble_server_t* srv,
 
     mumble_proto__server_sync__free_unpacked(server_sync, NULL);
 
+    MUMBLE_EMIT_CALLBACK(srv, on_server_sync, srv);
+
     return 1;
 }
 
@@ -84,59 +192,67 @@ int mumble_packet_handle_channel_state(struct mumble_server_t* srv,
                                        const uint8_t* body, uint32_t length)
 {
     mumble_channel_t* channel = NULL;
-    MumbleProto__ChannelState* channel_state =
-        mumble_proto__channel_state__unpack(NULL, length, body);
+    mumble_intern_t* strings = &srv->client->strings;
+    mumble_wire_channel_state_t channel_state;
 
-    if (!channel_state->has_channel_id)
+    if (mumble_wire_parse_channel_state(body, length, &channel_state) != 0)
     {
-        LOG_WARN("Received channel state that didn't contain a channel id");
+        LOG_WARN("Could not parse channel state packet");
+
         return 1;
     }
 
-    for (channel = srv->channels; channel != NULL; channel = channel->next)
+    if (!channel_state.has_channel_id)
     {
-        if (channel->id == (int)channel_state->channel_id)
-            break;
+        LOG_WARN("Received channel state that didn't contain a channel id");
+
+        return 1;
     }
 
+    channel = mumble_server_find_channel(srv, channel_state.channel_id);
+
     if (channel == NULL)
     {
-        channel = (mumble_channel_t*)malloc(sizeof(mumble_channel_t));
-        mumble_channel_init(channel);
+        channel = mumble_server_add_channel(srv, channel_state.channel_id);
 
-        channel->id = channel_state->channel_id;
-        channel->next = srv->channels;
+        /* Out of memory, so drop the packet rather than retry it forever. */
+        if (channel == NULL)
+        {
+            LOG_ERROR("Could not add channel %u, dropping channel state",
+                      channel_state.channel_id);
 
-        srv->channels = channel;
+            return 1;
+        }
 
         LOG_DEBUG("Created new channel");
     }
 
-    if (channel_state->has_parent)
-        channel->parent = channel_state->parent;
+    if (channel_state.has_parent)
+        channel->parent = channel_state.parent;
 
-    if (channel_state->name != NULL)
-    {
-        if (channel->name)
-            free(channel->name);
+    if (channel_state.name.data != NULL)
+        mumble_intern_assign_n(strings, &channel->name,
+                               (const char*)channel_state.name.data,
+                               channel_state.name.length);
 
-        channel->name = strdup(channel_state->name);
-    }
-
-    if (channel_state->description != NULL)
+    if (mumble_packet_update_blob(srv, &channel->description_blob,
+                                  channel_state.description.data,
+                                  channel_state.description.length,
+                                  &channel_state.description_hash,
+                                  MUMBLE_BLOB_DESCRIPTION, channel->id))
     {
-        if (channel->description)
-            free(channel->description);
-
-        channel->description = strdup(channel_state->description);
+        channel->description =
+            channel->description_blob
+                ? (const char*)channel->description_blob->data
+                : NULL;
     }
 
-    if (channel_state->has_position)
-        channel->position = channel_state->position;
+    if (channel_state.has_position)
+        channel->position = channel_state.position;
 
-    if (channel_state->has_temporary)
+    if (channel_state.has_temporary)
     {
-        if (channel_state->temporary)
+        if (channel_state.temporary)
             channel->flags |= MUMBLE_CHANNEL_TEMPORARY;
         else
             channel->flags &= ~MUMBLE_CHANNEL_TEMPORARY;
@@ -145,147 +261,230 @@ int mumble_packet_handle_channel_state(struct mumble_server_t* srv,
     LOG_DEBUG("Received channel state for channel (id=%d name='%s')",
               channel->id, channel->name);
 
-    mumble_proto__channel_state__free_unpacked(channel_state, NULL);
+    MUMBLE_EMIT_CALLBACK(srv, on_channel_state, srv, channel);
 
     return 1;
 }
+
 int mumble_packet_handle_user_state(struct mumble_server_t* server,
                                     const uint8_t* body, uint32_t length)
 {
     int new_user = 0;
     mumble_user_t* user, *actor = NULL;
-    MumbleProto__UserState* user_state =
-        mumble_proto__user_state__unpack(NULL, length, body);
+    mumble_intern_t* strings = &server->client->strings;
+    mumble_wire_user_state_t user_state;
 
-    if (!user_state->has_session)
+    /* Textures and plugin contexts are skipped over, not copied. */
+    if (mumble_wire_parse_user_state(body, length, &user_state) != 0)
     {
-        LOG_WARN("Received user state doesn't have a session id");
+        LOG_WARN("Could not parse user state packet");
 
         return 1;
     }
 
-    for (user = server->users; user != NULL; user = user->next)
+    if (!user_state.has_session)
     {
-        if (user->session == user_state->session)
-            break;
+        LOG_WARN("Received user state doesn't have a session id");
+
+        return 1;
     }
 
+    user = mumble_server_find_user(server, user_state.session);
+
     if (user == NULL)
     {
         /* Create a new user. */
-        user = (mumble_user_t*)malloc(sizeof(mumble_user_t));
-        mumble_user_init(user);
-        user->next = server->users;
-        server->users = user;
-        new_user = 1;
-    }
+        user = mumble_server_add_user(server, user_state.session);
 
-    if (user_state->has_session)
-        user->session = user_state->session;
+        /* Out of memory, so drop the packet rather than retry it forever. */
+        if (user == NULL)
+        {
+            LOG_ERROR("Could not add user %u, dropping user state",
+                      user_state.session);
 
-    if (user_state->has_actor)
-    {
-        for (actor = server->users; actor != NULL; actor = actor->next)
-            if (actor->session == user_state->actor)
-                break;
+            return 1;
+        }
+
+        new_user = 1;
     }
 
-    if (user_state->name != NULL)
-    {
-        if (user->name)
-            free(user->name);
+    if (user_state.has_actor)
+        actor = mumble_server_find_user(server, user_state.actor);
 
-        user->name = strdup(user_state->name);
-    }
+    if (user_state.name.data != NULL)
+        mumble_intern_assign_n(strings, &user->name,
+                               (const char*)user_state.name.data,
+                               user_state.name.length);
 
-    if (user_state->has_user_id)
-        user->id = user_state->user_id;
+    if (user_state.has_user_id)
+        user->id = user_state.user_id;
 
-    if (user_state->has_channel_id)
+    if (user_state.has_channel_id)
     {
-        if (!new_user && user->channel != user_state->channel_id)
+        if (!new_user && user->channel != user_state.channel_id)
             LOG_DEBUG("User changed channel (channel %d -> channel %d)",
-                      user->channel, user_state->channel_id);
+                      user->channel, user_state.channel_id);
 
-        if (actor && actor != user && (user->channel != user_state->channel_id))
+        if (actor && actor != user && (user->channel != user_state.channel_id))
         {
             LOG_DEBUG("%s was forcibly moved by %s", user->name, actor->name);
         }
 
-        user->channel = user_state->channel_id;
+        user->channel = user_state.channel_id;
     }
 
-    if (user_state->has_mute)
+    if (user_state.has_mute)
     {
-        if (user_state->mute)
+        if (user_state.mute)
             user->flags |= MUMBLE_USER_MUTE;
         else
             user->flags &= ~MUMBLE_USER_MUTE;
     }
 
-    if (user_state->has_deaf)
+    if (user_state.has_deaf)
     {
-        if (user_state->deaf)
+        if (user_state.deaf)
             user->flags |= MUMBLE_USER_DEAF;
         else
-            user->flags &= MUMBLE_USER_DEAF;
+            user->flags &= ~MUMBLE_USER_DEAF;
     }
 
-    if (user_state->has_suppress)
+    if (user_state.has_suppress)
     {
-        if (user_state->suppress)
+        if (user_state.suppress)
             user->flags |= MUMBLE_USER_SUPPRESS;
         else
             user->flags &= ~MUMBLE_USER_SUPPRESS;
     }
 
-    if (user_state->has_self_mute)
+    if (user_state.has_self_mute)
     {
-        if (user_state->self_mute)
+        if (user_state.self_mute)
             user->flags |= MUMBLE_USER_SELF_MUTE;
         else
-            user->flags &= MUMBLE_USER_SELF_MUTE;
+            user->flags &= ~MUMBLE_USER_SELF_MUTE;
     }
 
-    if (user_state->has_self_deaf)
+    if (user_state.has_self_deaf)
     {
-        if (user_state->self_deaf)
+        if (user_state.self_deaf)
             user->flags |= MUMBLE_USER_SELF_DEAF;
         else
             user->flags &= ~MUMBLE_USER_SELF_DEAF;
     }
 
-    if (user_state->has_recording)
+    if (user_state.has_priority_speaker)
     {
-        if (user_state->recording)
-            user->flags |= MUMBLE_USER_RECORDING;
+        if (user_state.priority_speaker)
+            user->flags |= MUMBLE_USER_PRIORITY_SPEAKER;
         else
-            user->flags &= MUMBLE_USER_RECORDING;
+            user->flags &= ~MUMBLE_USER_PRIORITY_SPEAKER;
     }
 
-    if (user_state->comment != NULL)
+    if (user_state.has_recording)
     {
-        if (user->comment)
-            free(user->comment);
-
-        user->comment = strdup(user_state->comment);
+        if (user_state.recording)
+            user->flags |= MUMBLE_USER_RECORDING;
+        else
+            user->flags &= ~MUMBLE_USER_RECORDING;
     }
 
-    if (user_state->hash != NULL)
+    if (mumble_packet_update_blob(server, &user->comment_blob,
+                                  user_state.comment.data,
+                                  user_state.comment.length,
+                                  &user_state.comment_hash,
+                                  MUMBLE_BLOB_COMMENT, user->session))
     {
-        if (user->hash)
-            free(user->hash);
+        user->comment = user->comment_blob
+                            ? (const char*)user->comment_blob->data
+                            : NULL;
+    }
 
-        user->hash = strdup(user_state->hash);
+    if (mumble_packet_update_blob(server, &user->texture_blob,
+                                  user_state.texture.data,
+                                  user_state.texture.length,
+                                  &user_state.texture_hash,
+                                  MUMBLE_BLOB_TEXTURE, user->session))
+    {
+        user->texture = user->texture_blob ? user->texture_blob->data : NULL;
+        user->texture_size = user->texture_blob ? user->texture_blob->size : 0;
     }
 
-    if (user_state->has_channel_id)
-        user->channel = user_state->channel_id;
+    if (user_state.hash.data != NULL)
+        mumble_intern_assign_n(strings, &user->hash,
+                               (const char*)user_state.hash.data,
+                               user_state.hash.length);
+
+    mumble_user_table_update(&server->user_table, user->session, user->channel,
+                             user->flags);
 
     LOG_DEBUG("Received user state (session=%d name='%s' channel=%d)",
               user->session, user->name, user->channel);
 
-    mumble_proto__user_state__free_unpacked(user_state, NULL);
+    if (new_user)
+        MUMBLE_EMIT_CALLBACK(server, on_user_join, server, user);
+    else
+        MUMBLE_EMIT_CALLBACK(server, on_user_state, server, user);
+
+    return 1;
+}
+
+int mumble_packet_handle_user_remove(struct mumble_server_t* server,
+                                     const uint8_t* body, uint32_t length)
+{
+    mumble_user_t* user;
+    MumbleProto__UserRemove* user_remove =
+        mumble_proto__user_remove__unpack(NULL, length, body);
+
+    if (!user_remove)
+    {
+        LOG_WARN("Could not unpack user remove packet");
+
+        return 1;
+    }
+
+    user = mumble_server_find_user(server, user_remove->session);
+
+    if (user != NULL)
+    {
+        LOG_DEBUG("User left (session=%d name='%s' reason='%s')",
+                  user->session, user->name, user_remove->reason);
+
+        MUMBLE_EMIT_CALLBACK(server, on_user_remove, server, user);
+        mumble_server_remove_user(server, user);
+    }
+
+    mumble_proto__user_remove__free_unpacked(user_remove, NULL);
+
+    return 1;
+}
+
+int mumble_packet_handle_channel_remove(struct mumble_server_t* server,
+                                        const uint8_t* body, uint32_t length)
+{
+    mumble_channel_t* channel;
+    MumbleProto__ChannelRemove* channel_remove =
+        mumble_proto__channel_remove__unpack(NULL, length, body);
+
+    if (!channel_remove)
+    {
+        LOG_WARN("Could not unpack channel remove packet");
+
+        return 1;
+    }
+
+    channel = mumble_server_find_channel(server, channel_remove->channel_id);
+
+    if (channel != NULL)
+    {
+        LOG_DEBUG("Channel removed (id=%d name='%s')", channel->id,
+                  channel->name);
+
+        MUMBLE_EMIT_CALLBACK(server, on_channel_remove, server, channel);
+        mumble_server_remove_channel(server, channel);
+    }
+
+    mumble_proto__channel_remove__free_unpacked(channel_remove, NULL);
 
     return 1;
 }
@@ -293,21 +492,131 @@ int mumble_packet_handle_user_state(struct mumble_server_t* server,
 int mumble_packet_handle_text_message(struct mumble_server_t* server,
                                       const uint8_t* body, uint32_t length)
 {
-    struct mumble_user_t* actor = NULL;
-    MumbleProto__TextMessage* text_message =
-        mumble_proto__text_message__unpack(NULL, length, body);
+    size_t num_targets;
+    uint32_t* targets;
+    char* message;
+    mumble_text_message_t event;
+    mumble_wire_text_message_t text_message;
 
-    if (text_message->has_actor)
+    if (mumble_wire_parse_text_message(body, length, &text_message) != 0)
     {
-        for (actor = server->users; actor != NULL; actor = actor->next)
-            if (actor->session == text_message->actor)
-                break;
+        LOG_WARN("Could not parse text message packet");
+
+        return 1;
     }
 
-    LOG_DEBUG("< %s> %s", (actor != NULL ? actor->name : "(null)"),
-              text_message->message);
+    num_targets = text_message.num_sessions + text_message.num_channels +
+                  text_message.num_trees;
+
+    /* Copy the message so it can be null-terminated, and decode the targets
+     * into the same allocation. */
+    targets = (uint32_t*)malloc(num_targets * sizeof(uint32_t) +
+                                text_message.message.length + 1);
+
+    if (!targets)
+    {
+        LOG_ERROR("Could not allocate text message, dropping it");
+
+        return 1;
+    }
+
+    message = (char*)(targets + num_targets);
+    memcpy(message, text_message.message.data, text_message.message.length);
+    message[text_message.message.length] = '\0';
+
+    event.actor = NULL;
+
+    if (text_message.has_actor)
+        event.actor = mumble_server_find_user(server, text_message.actor);
+
+    event.message = message;
+    event.sessions = targets;
+    event.num_sessions = mumble_wire_collect_uint32(
+        body, length, 2, targets, text_message.num_sessions);
+    event.channels = event.sessions + event.num_sessions;
+    event.num_channels = mumble_wire_collect_uint32(
+        body, length, 3, targets + event.num_sessions,
+        text_message.num_channels);
+    event.trees = event.channels + event.num_channels;
+    event.num_trees = mumble_wire_collect_uint32(
+        body, length, 4, targets + event.num_sessions + event.num_channels,
+        text_message.num_trees);
+
+    LOG_DEBUG("< %s> %s", (event.actor != NULL ? event.actor->name : "(null)"),
+              event.message);
+
+    MUMBLE_EMIT_CALLBACK(server, on_text_message, server, &event);
 
-    mumble_proto__text_message__free_unpacked(text_message, NULL);
+    free(targets);
+
+    return 1;
+}
+
+int mumble_packet_handle_permission_denied(struct mumble_server_t* server,
+                                           const uint8_t* body,
+                                           uint32_t length)
+{
+    mumble_permission_denied_t event;
+    MumbleProto__PermissionDenied* permission_denied =
+        mumble_proto__permission_denied__unpack(NULL, length, body);
+
+    if (!permission_denied)
+    {
+        LOG_WARN("Could not unpack permission denied packet");
+
+        return 1;
+    }
+
+    event.type = (mumble_deny_type_t)permission_denied->type;
+    event.permission = permission_denied->permission;
+    event.channel_id = permission_denied->channel_id;
+    event.session = permission_denied->session;
+    event.reason = permission_denied->reason;
+    event.name = permission_denied->name;
+
+    LOG_DEBUG("Permission denied (type=%d reason='%s')", event.type,
+              event.reason);
+
+    MUMBLE_EMIT_CALLBACK(server, on_permission_denied, server, &event);
+
+    mumble_proto__permission_denied__free_unpacked(permission_denied, NULL);
+
+    return 1;
+}
+
+int mumble_packet_handle_reject(struct mumble_server_t* server,
+                                const uint8_t* body, uint32_t length)
+{
+    mumble_reject_t event;
+    MumbleProto__Reject* reject =
+        mumble_proto__reject__unpack(NULL, length, body);
+
+    if (!reject)
+    {
+        LOG_WARN("Could not unpack reject packet");
+
+        return 1;
+    }
+
+    event.type = reject->has_type ? (mumble_reject_type_t)reject->type
+                                  : MUMBLE_REJECT_NONE;
+    event.reason = reject->reason;
+
+    LOG_ERROR("Connection rejected by %s (type=%d reason='%s')", server->host,
+              event.type, event.reason);
+
+    MUMBLE_EMIT_CALLBACK(server, on_reject, server, &event);
+
+    mumble_proto__reject__free_unpacked(reject, NULL);
+
+    return 1;
+}
+
+int mumble_packet_handle_udp_tunnel(struct mumble_server_t* server,
+                                    const uint8_t* body, uint32_t length)
+{
+    /* Tunneled voice packets are raw, not protobuf encoded. */
+    MUMBLE_EMIT_CALLBACK(server, on_voice, server, body, length);
 
     return 1;
 }
@@ -317,11 +626,20 @@ int mumble_packet_handle_version(struct mumble_server_t* srv,
 {
     MumbleProto__Version* version =
         mumble_proto__version__unpack(NULL, length, body);
-    (void)srv;
+
+    if (!version)
+    {
+        LOG_WARN("Could not unpack version packet");
+
+        return 1;
+    }
 
     LOG_DEBUG("Received version message: %s - %s (%s)", version->release,
               version->os, version->os_version);
 
+    if (version->has_version)
+        srv->version = version->version;
+
     mumble_proto__version__free_unpacked(version, NULL);
 
     return 1;
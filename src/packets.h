@@ -44,34 +44,31 @@ MUMBLE_HANDLER_FUNC(user_state);
 MUMBLE_HANDLER_FUNC(crypt_setup);
 MUMBLE_HANDLER_FUNC(codec_version);
 MUMBLE_HANDLER_FUNC(server_sync);
+MUMBLE_HANDLER_FUNC(user_remove);
+MUMBLE_HANDLER_FUNC(channel_remove);
+MUMBLE_HANDLER_FUNC(permission_denied);
+MUMBLE_HANDLER_FUNC(reject);
+MUMBLE_HANDLER_FUNC(udp_tunnel);
 
-static mumble_handler_func_t g_mumble_packet_handlers[MUMBLE_PACKET_MAX] = {
-    mumble_packet_handle_version,       /* MUMBLE_PACKET_VERSION */
-    NULL,                               /* MUMBLE_PACKET_UDPTUNNEL */
-    NULL,                               /* MUMBLE_PACKET_AUTHENTICATE */
-    mumble_packet_handle_ping,          /* MUMBLE_PACKET_PING */
-    NULL,                               /* MUMBLE_PACKET_REJECT */
-    mumble_packet_handle_server_sync,   /* MUMBLE_PACKET_SERVER_SYNC */
-    NULL,                               /* MUMBLE_PACKET_CHANNEL_REMOVE */
-    mumble_packet_handle_channel_state, /* MUMBLE_PACKET_CHANNEL_STATE */
-    NULL,                               /* MUMBLE_PACKET_USER_REMOVE */
-    mumble_packet_handle_user_state,    /* MUMBLE_PACKET_USER_STATE */
-    NULL,                               /* MUMBLE_PACKET_BAN_LIST */
-    mumble_packet_handle_text_message,  /* MUMBLE_PACKET_TEXT_MESSAGE */
-    NULL,                               /* MUMBLE_PACKET_PERMISSION_DENIED */
-    NULL,                               /* MUMBLE_PACKET_ACL */
-    NULL,                               /* MUMBLE_PACKET_QUERY_USERS */
-    mumble_packet_handle_crypt_setup,   /* MUMBLE_PACKET_CRYPT_SETUP */
-    NULL,                               /* MUMBLE_PACKET_CONTEXT_ACTION_MODIFY */
-    NULL,                               /* MUMBLE_PACKET_CONTEXT_ACTION */
-    NULL,                               /* MUMBLE_PACKET_USER_LIST */
-    NULL,                               /* MUMBLE_PACKET_VOICE_TARGET */
-    NULL,                               /* MUMBLE_PACKET_PERMISSION_QUERY */
-    mumble_packet_handle_codec_version, /* MUMBLE_PACKET_CODEC_VERSION */
-    NULL,                               /* MUMBLE_PACKET_USER_STATS */
-    NULL,                               /* MUMBLE_PACKET_REQUEST_BLOB */
-    NULL,                               /* MUMBLE_PACKET_SERVER_CONFIG */
-    NULL                                /* MUMBLE_PACKET_SUGGEST_CONFIG */
+/**
+ * Packet handlers indexed by packet type.
+ *
+ * UDPTunnel packets never go through this table, they are passed straight to
+ * `mumble_packet_handle_udp_tunnel`.
+ */
+static const mumble_handler_func_t g_mumble_packet_handlers[MUMBLE_PACKET_MAX] = {
+    [MUMBLE_PACKET_VERSION] = mumble_packet_handle_version,
+    [MUMBLE_PACKET_PING] = mumble_packet_handle_ping,
+    [MUMBLE_PACKET_REJECT] = mumble_packet_handle_reject,
+    [MUMBLE_PACKET_SERVER_SYNC] = mumble_packet_handle_server_sync,
+    [MUMBLE_PACKET_CHANNEL_REMOVE] = mumble_packet_handle_channel_remove,
+    [MUMBLE_PACKET_CHANNEL_STATE] = mumble_packet_handle_channel_state,
+    [MUMBLE_PACKET_USER_REMOVE] = mumble_packet_handle_user_remove,
+    [MUMBLE_PACKET_USER_STATE] = mumble_packet_handle_user_state,
+    [MUMBLE_PACKET_TEXT_MESSAGE] = mumble_packet_handle_text_message,
+    [MUMBLE_PACKET_PERMISSION_DENIED] = mumble_packet_handle_permission_denied,
+    [MUMBLE_PACKET_CRYPT_SETUP] = mumble_packet_handle_crypt_setup,
+    [MUMBLE_PACKET_CODEC_VERSION] = mumble_packet_handle_codec_version
 };
 
 #endif
@@ -0,0 +1,53 @@
+#include <string.h>
+
+#include "ping.h"
+
+void mumble_ping_stats_init(mumble_ping_stats_t* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+/**
+ * Get the histogram bucket of a round-trip time.
+ */
+static unsigned int mumble_ping_bucket(uint64_t rtt)
+{
+    unsigned int bucket = 0;
+    uint64_t ms = rtt / 1000;
+
+    while (ms > 0 && bucket < MUMBLE_PING_HISTOGRAM_SIZE - 1)
+    {
+        ms >>= 1;
+        bucket++;
+    }
+
+    return bucket;
+}
+
+void mumble_ping_stats_update(mumble_ping_stats_t* stats, uint64_t rtt)
+{
+    uint64_t delta;
+
+    if (stats->samples == 0)
+    {
+        /* RFC 6298 2.2: SRTT <- R, RTTVAR <- R/2 */
+        stats->srtt = rtt;
+        stats->rttvar = rtt / 2;
+        stats->min_rtt = rtt;
+    }
+    else
+    {
+        /* RFC 6298 2.3: RTTVAR <- 3/4 RTTVAR + 1/4 |SRTT - R|,
+         * SRTT <- 7/8 SRTT + 1/8 R */
+        delta = stats->srtt > rtt ? stats->srtt - rtt : rtt - stats->srtt;
+        stats->rttvar = (3 * stats->rttvar + delta) / 4;
+        stats->srtt = (7 * stats->srtt + rtt) / 8;
+
+        if (rtt < stats->min_rtt)
+            stats->min_rtt = rtt;
+    }
+
+    stats->last_rtt = rtt;
+    stats->samples++;
+    stats->histogram[mumble_ping_bucket(rtt)]++;
+}
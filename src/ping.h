@@ -0,0 +1,58 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file ping.h
+ * @brief Round-trip time estimation from ping replies.
+ *
+ * The smoothed round-trip time and its variation are estimated like the TCP
+ * retransmission timer in RFC 6298.
+ */
+
+#include <stdint.h>
+
+#include <mumble/server.h>
+
+#pragma once
+#ifndef MUMBLE_PING_H
+#define MUMBLE_PING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Reset ping statistics.
+ *
+ * @param[in] stats a pointer to the statistics.
+ */
+void mumble_ping_stats_init(mumble_ping_stats_t* stats);
+
+/**
+ * Add a round-trip time sample to ping statistics.
+ *
+ * @param[in] stats a pointer to the statistics.
+ * @param[in] rtt   the round-trip time, in microseconds.
+ */
+void mumble_ping_stats_update(mumble_ping_stats_t* stats, uint64_t rtt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_PING_H */
@@ -0,0 +1,64 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file probes.h
+ * @brief USDT probes on the packet path.
+ *
+ * When the library is built with `LIBMUMBLE_USDT`, these expand to the
+ * `sys/sdt.h` probe macros, which compile to a single nop each and a note in
+ * the ELF file that tools such as bpftrace and perf attach to at runtime.
+ * Otherwise they expand to nothing. All probes are in the `libmumble`
+ * provider:
+ *
+ * | Probe             | Arguments                                   |
+ * |-------------------|---------------------------------------------|
+ * | packet-receive    | server, packet type, body length            |
+ * | dispatch-start    | server, packet type, body length            |
+ * | dispatch-done     | server, packet type, handler result         |
+ * | send-enqueue      | server, lane, packet type, packet size      |
+ * | tls-read          | server, bytes read or SSL_read result       |
+ * | tls-write         | server, bytes written                       |
+ * | handshake-done    | server, host, handshake time in microseconds|
+ *
+ * For example, a latency histogram of each packet type:
+ *
+ *     bpftrace -e '
+ *       usdt:libmumble.so:libmumble:dispatch-start { @start[tid] = nsecs; }
+ *       usdt:libmumble.so:libmumble:dispatch-done /@start[tid]/ {
+ *         @ns[arg1] = hist(nsecs - @start[tid]); delete(@start[tid]); }'
+ */
+
+#pragma once
+#ifndef MUMBLE_PROBES_H
+#define MUMBLE_PROBES_H
+
+#ifdef LIBMUMBLE_USDT
+# include <sys/sdt.h>
+
+# define MUMBLE_PROBE2(name, a, b) DTRACE_PROBE2(libmumble, name, a, b)
+# define MUMBLE_PROBE3(name, a, b, c) DTRACE_PROBE3(libmumble, name, a, b, c)
+# define MUMBLE_PROBE4(name, a, b, c, d)                                       \
+    DTRACE_PROBE4(libmumble, name, a, b, c, d)
+#else
+# define MUMBLE_PROBE2(name, a, b) do {} while (0)
+# define MUMBLE_PROBE3(name, a, b, c) do {} while (0)
+# define MUMBLE_PROBE4(name, a, b, c, d) do {} while (0)
+#endif
+
+#endif /* MUMBLE_PROBES_H */
@@ -1,53 +1,334 @@
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
 
 #include "protocol.h"
 #include "Mumble.pb-c.h"
 
+/**
+ * Message descriptors indexed by packet type.
+ */
+static const ProtobufCMessageDescriptor* const
+    kMumblePacketDescriptors[MUMBLE_PACKET_MAX] = {
+        [MUMBLE_PACKET_VERSION] = &mumble_proto__version__descriptor,
+        /* UDPTunnel bodies are raw voice packets. */
+        [MUMBLE_PACKET_UDPTUNNEL] = NULL,
+        [MUMBLE_PACKET_AUTHENTICATE] = &mumble_proto__authenticate__descriptor,
+        [MUMBLE_PACKET_PING] = &mumble_proto__ping__descriptor,
+        [MUMBLE_PACKET_REJECT] = &mumble_proto__reject__descriptor,
+        [MUMBLE_PACKET_SERVER_SYNC] = &mumble_proto__server_sync__descriptor,
+        [MUMBLE_PACKET_CHANNEL_REMOVE] =
+            &mumble_proto__channel_remove__descriptor,
+        [MUMBLE_PACKET_CHANNEL_STATE] = &mumble_proto__channel_state__descriptor,
+        [MUMBLE_PACKET_USER_REMOVE] = &mumble_proto__user_remove__descriptor,
+        [MUMBLE_PACKET_USER_STATE] = &mumble_proto__user_state__descriptor,
+        [MUMBLE_PACKET_BAN_LIST] = &mumble_proto__ban_list__descriptor,
+        [MUMBLE_PACKET_TEXT_MESSAGE] = &mumble_proto__text_message__descriptor,
+        [MUMBLE_PACKET_PERMISSION_DENIED] =
+            &mumble_proto__permission_denied__descriptor,
+        [MUMBLE_PACKET_ACL] = &mumble_proto__acl__descriptor,
+        [MUMBLE_PACKET_QUERY_USERS] = &mumble_proto__query_users__descriptor,
+        [MUMBLE_PACKET_CRYPT_SETUP] = &mumble_proto__crypt_setup__descriptor,
+        [MUMBLE_PACKET_CONTEXT_ACTION_MODIFY] =
+            &mumble_proto__context_action_modify__descriptor,
+        [MUMBLE_PACKET_CONTEXT_ACTION] =
+            &mumble_proto__context_action__descriptor,
+        [MUMBLE_PACKET_USER_LIST] = &mumble_proto__user_list__descriptor,
+        [MUMBLE_PACKET_VOICE_TARGET] = &mumble_proto__voice_target__descriptor,
+        [MUMBLE_PACKET_PERMISSION_QUERY] =
+            &mumble_proto__permission_query__descriptor,
+        [MUMBLE_PACKET_CODEC_VERSION] = &mumble_proto__codec_version__descriptor,
+        [MUMBLE_PACKET_USER_STATS] = &mumble_proto__user_stats__descriptor,
+        [MUMBLE_PACKET_REQUEST_BLOB] = &mumble_proto__request_blob__descriptor,
+        [MUMBLE_PACKET_SERVER_CONFIG] = &mumble_proto__server_config__descriptor,
+        [MUMBLE_PACKET_SUGGEST_CONFIG] =
+            &mumble_proto__suggest_config__descriptor,
+};
+
+/**
+ * The largest body accepted for each packet type, in bytes.
+ *
+ * The limits leave room for what a server can legitimately send, such as
+ * image messages, comments and full ACL lists, while keeping a single length
+ * field from making the read buffer grow without bound.
+ */
+static const uint32_t kMumblePacketMaxSizes[MUMBLE_PACKET_MAX] = {
+    [MUMBLE_PACKET_VERSION] = 4096,
+    [MUMBLE_PACKET_UDPTUNNEL] = 1024,
+    [MUMBLE_PACKET_AUTHENTICATE] = 4096,
+    [MUMBLE_PACKET_PING] = 256,
+    [MUMBLE_PACKET_REJECT] = 4096,
+    [MUMBLE_PACKET_SERVER_SYNC] = 1024 * 1024,
+    [MUMBLE_PACKET_CHANNEL_REMOVE] = 64,
+    [MUMBLE_PACKET_CHANNEL_STATE] = 1024 * 1024,
+    [MUMBLE_PACKET_USER_REMOVE] = 4096,
+    [MUMBLE_PACKET_USER_STATE] = 1024 * 1024,
+    [MUMBLE_PACKET_BAN_LIST] = 1024 * 1024,
+    [MUMBLE_PACKET_TEXT_MESSAGE] = 1024 * 1024,
+    [MUMBLE_PACKET_PERMISSION_DENIED] = 4096,
+    [MUMBLE_PACKET_ACL] = 1024 * 1024,
+    [MUMBLE_PACKET_QUERY_USERS] = 64 * 1024,
+    [MUMBLE_PACKET_CRYPT_SETUP] = 256,
+    [MUMBLE_PACKET_CONTEXT_ACTION_MODIFY] = 4096,
+    [MUMBLE_PACKET_CONTEXT_ACTION] = 4096,
+    [MUMBLE_PACKET_USER_LIST] = 1024 * 1024,
+    [MUMBLE_PACKET_VOICE_TARGET] = 4096,
+    [MUMBLE_PACKET_PERMISSION_QUERY] = 256,
+    [MUMBLE_PACKET_CODEC_VERSION] = 256,
+    [MUMBLE_PACKET_USER_STATS] = 64 * 1024,
+    [MUMBLE_PACKET_REQUEST_BLOB] = 64 * 1024,
+    [MUMBLE_PACKET_SERVER_CONFIG] = 1024 * 1024,
+    [MUMBLE_PACKET_SUGGEST_CONFIG] = 256,
+};
+
+/**
+ * The largest body accepted for types added after this library was written.
+ * They are skipped by the dispatcher, but must still fit in the buffer.
+ */
+static const uint32_t kMumblePacketMaxUnknownSize = 64 * 1024;
+
+/**
+ * A protobuf-c output buffer that appends to a `mumble_buffer_t`.
+ */
+typedef struct mumble_packet_appender_t
+{
+    ProtobufCBuffer base;
+    mumble_buffer_t* buffer;
+    int failed;
+} mumble_packet_appender_t;
+
+static void mumble_packet_append(ProtobufCBuffer* base, size_t length,
+                                 const uint8_t* data)
+{
+    mumble_packet_appender_t* appender = (mumble_packet_appender_t*)base;
+
+    if (appender->failed || length == 0)
+        return;
+
+    if (mumble_buffer_write(appender->buffer, data, length) != length)
+        appender->failed = 1;
+}
+
+/**
+ * The room a segment starts out with when a message is packed into it, which
+ * holds most control packets without growing.
+ */
+static const size_t kMumblePacketSegmentSize = 256;
+
+/**
+ * A protobuf-c output buffer that appends to a segment nobody else references
+ * yet, growing it as needed.
+ */
+typedef struct mumble_packet_segment_appender_t
+{
+    ProtobufCBuffer base;
+    mumble_segment_t* segment;
+    /** The number of bytes the segment has room for. */
+    size_t capacity;
+    int failed;
+} mumble_packet_segment_appender_t;
+
+/**
+ * Resize a segment that nobody else references yet.
+ *
+ * @returns zero on success, non-zero if out of memory, in which case the
+ *   segment is left as it was.
+ */
+static int mumble_packet_segment_resize(mumble_packet_segment_appender_t* appender,
+                                        size_t capacity)
+{
+    mumble_segment_t* segment = (mumble_segment_t*)realloc(
+        appender->segment, sizeof(mumble_segment_t) + capacity);
+
+    if (!segment)
+        return 1;
+
+    segment->data = segment->inline_data;
+    appender->segment = segment;
+    appender->capacity = capacity;
+
+    return 0;
+}
+
+static void mumble_packet_append_segment(ProtobufCBuffer* base, size_t length,
+                                         const uint8_t* data)
+{
+    mumble_packet_segment_appender_t* appender =
+        (mumble_packet_segment_appender_t*)base;
+    mumble_segment_t* segment = appender->segment;
+    size_t capacity = appender->capacity;
+
+    if (appender->failed || length == 0)
+        return;
+
+    if (capacity - segment->size < length)
+    {
+        while (capacity - segment->size < length)
+            capacity *= 2;
+
+        if (mumble_packet_segment_resize(appender, capacity) != 0)
+        {
+            appender->failed = 1;
+
+            return;
+        }
+
+        segment = appender->segment;
+    }
+
+    memcpy(segment->data + segment->size, data, length);
+    segment->size += length;
+}
+
+const ProtobufCMessageDescriptor*
+mumble_packet_descriptor(mumble_packet_type_t packet_type)
+{
+    if ((unsigned)packet_type >= MUMBLE_PACKET_MAX)
+        return NULL;
+
+    return kMumblePacketDescriptors[packet_type];
+}
+
+uint32_t mumble_packet_max_size(mumble_packet_type_t packet_type)
+{
+    if ((unsigned)packet_type >= MUMBLE_PACKET_MAX)
+        return kMumblePacketMaxUnknownSize;
+
+    return kMumblePacketMaxSizes[packet_type];
+}
+
+const char* mumble_packet_name(mumble_packet_type_t packet_type)
+{
+    const ProtobufCMessageDescriptor* descriptor;
+
+    if (packet_type == MUMBLE_PACKET_UDPTUNNEL)
+        return "UDPTunnel";
+
+    descriptor = mumble_packet_descriptor(packet_type);
+
+    return descriptor ? descriptor->short_name : NULL;
+}
+
+/**
+ * Get the descriptor of a packet type and check that it matches the message.
+ */
+static const ProtobufCMessageDescriptor*
+mumble_packet_message_descriptor(mumble_packet_type_t packet_type,
+                                 const void* message)
+{
+    const ProtobufCMessageDescriptor* descriptor =
+        mumble_packet_descriptor(packet_type);
+
+    /* Only checked in debug builds. */
+    (void)message;
+
+    if (descriptor == NULL)
+    {
+        assert(0 && "unknown packet type");
+
+        return NULL;
+    }
+
+    assert(((const ProtobufCMessage*)message)->descriptor == descriptor);
+
+    return descriptor;
+}
+
 size_t mumble_packet_size_packed(mumble_packet_type_t packet_type,
                                  const void* buffer)
 {
-    size_t size = 0;
+    if (!mumble_packet_message_descriptor(packet_type, buffer))
+        return 0;
+
+    return protobuf_c_message_get_packed_size((const ProtobufCMessage*)buffer);
+}
+
+void mumble_packet_write_header(uint8_t* output,
+                                mumble_packet_type_t packet_type,
+                                uint32_t length)
+{
+    uint16_t type = htons((uint16_t)packet_type);
+
+    length = htonl(length);
+
+    memcpy(output, &type, sizeof(type));
+    memcpy(output + sizeof(type), &length, sizeof(length));
+}
+
+size_t mumble_packet_pack(mumble_buffer_t* buffer,
+                          mumble_packet_type_t packet_type, const void* message)
+{
+    size_t start = buffer->pos;
+    size_t body_length;
+    mumble_packet_appender_t appender;
+    static const uint8_t header[sizeof(uint16_t) + sizeof(uint32_t)] = { 0 };
+
+    if (!mumble_packet_message_descriptor(packet_type, message))
+        return 0;
+
+    /* Reserve room for the header, then pack the body behind it. */
+    if (mumble_buffer_write(buffer, header, kMumbleHeaderSize) !=
+        kMumbleHeaderSize)
+        return 0;
+
+    appender.base.append = mumble_packet_append;
+    appender.buffer = buffer;
+    appender.failed = 0;
+
+    body_length = protobuf_c_message_pack_to_buffer(
+        (const ProtobufCMessage*)message, &appender.base);
 
-    switch (packet_type)
+    if (appender.failed || body_length > UINT32_MAX)
     {
-        case MUMBLE_PACKET_PING:
-            size = mumble_proto__ping__get_packed_size(buffer);
-            break;
-        case MUMBLE_PACKET_VERSION:
-            size = mumble_proto__version__get_packed_size(buffer);
-            break;
-        case MUMBLE_PACKET_AUTHENTICATE:
-            size = mumble_proto__authenticate__get_packed_size(buffer);
-            break;
-        default:
-            assert(0 && "unknown packet type");
-            size = 0;
+        buffer->size -= buffer->pos - start;
+        buffer->pos = start;
+
+        return 0;
     }
 
-    return size;
+    mumble_packet_write_header(buffer->ptr + start, packet_type,
+                               (uint32_t)body_length);
+
+    return kMumbleHeaderSize + body_length;
 }
 
-size_t mumble_packet_proto_pack(mumble_packet_type_t packet_type, void* message,
-                                void* buffer)
+mumble_segment_t* mumble_packet_pack_segment(mumble_packet_type_t packet_type,
+                                             const void* message)
 {
-    size_t result;
+    size_t body_length;
+    mumble_packet_segment_appender_t appender;
+
+    if (!mumble_packet_message_descriptor(packet_type, message))
+        return NULL;
+
+    if (!(appender.segment = mumble_segment_new(kMumblePacketSegmentSize)))
+        return NULL;
+
+    /* The header is filled in once the length of the body is known. */
+    appender.base.append = mumble_packet_append_segment;
+    appender.capacity = kMumblePacketSegmentSize;
+    appender.failed = 0;
+    appender.segment->size = kMumbleHeaderSize;
 
-    switch (packet_type)
+    body_length = protobuf_c_message_pack_to_buffer(
+        (const ProtobufCMessage*)message, &appender.base);
+
+    if (appender.failed || body_length > UINT32_MAX)
     {
-        case MUMBLE_PACKET_PING:
-            result = mumble_proto__ping__pack(message, buffer);
-            break;
-        case MUMBLE_PACKET_VERSION:
-            result = mumble_proto__version__pack(message, buffer);
-            break;
-        case MUMBLE_PACKET_AUTHENTICATE:
-            result = mumble_proto__authenticate__pack(message, buffer);
-            break;
-        default:
-            assert(0 && "unknown packet type");
-            result = 0;
+        mumble_segment_unref(appender.segment);
+
+        return NULL;
     }
 
-    return result;
+    mumble_packet_write_header(appender.segment->data, packet_type,
+                               (uint32_t)body_length);
+
+    /* Give back what the last doubling left unused, as the segment may stay
+     * queued for a while. Shrinking can't fail in a way that matters. */
+    if (appender.capacity - appender.segment->size > kMumblePacketSegmentSize)
+        mumble_packet_segment_resize(&appender, appender.segment->size);
+
+    return appender.segment;
 }
@@ -24,11 +24,20 @@
 #include <stdint.h>
 #include <stdlib.h>
 
+#include "buffer.h"
+#include "segment.h"
+
 #pragma once
 #ifndef MUMBLE_PROTOCOL_H
 #define MUMBLE_PROTOCOL_H
 
 struct mumble_server_t;
+struct ProtobufCMessageDescriptor;
+
+/**
+ * The mumble message header length.
+ */
+static const size_t kMumbleHeaderSize = (sizeof(uint16_t) + sizeof(uint32_t));
 
 /** 
  * Function pointer to a packet handler function.
@@ -41,7 +50,7 @@ typedef int (*mumble_handler_func_t)(struct mumble_server_t* srv,
  */
 typedef enum mumble_packet_type_t
 {
-    MUMBLE_PACKET_VERSION               = 1,
+    MUMBLE_PACKET_VERSION               = 0,
     MUMBLE_PACKET_UDPTUNNEL             = 1,
     MUMBLE_PACKET_AUTHENTICATE          = 2,
     MUMBLE_PACKET_PING                  = 3,
@@ -70,6 +79,17 @@ typedef enum mumble_packet_type_t
     MUMBLE_PACKET_MAX                   = 26
 } mumble_packet_type_t;
 
+/**
+ * Get the protobuf message descriptor of a packet type.
+ *
+ * @param[in] packet_type the packet type.
+ *
+ * @returns the descriptor, or NULL if the packet type is unknown or its body
+ *   isn't a protobuf message.
+ */
+const struct ProtobufCMessageDescriptor*
+mumble_packet_descriptor(mumble_packet_type_t packet_type);
+
 /**
  * Get the packed size of the protobuf packet.
  *
@@ -82,15 +102,67 @@ size_t mumble_packet_size_packed(mumble_packet_type_t packet_type,
                                  const void* buffer);
 
 /**
- * Pack a packets protobuf structure to a buffer.
+ * Get the largest body accepted for a packet type.
+ *
+ * Packets with a longer length field are treated as malformed before their
+ * body is read.
+ *
+ * @param[in] packet_type the packet type, which may be unknown.
+ *
+ * @returns the maximum body length, in bytes.
+ */
+uint32_t mumble_packet_max_size(mumble_packet_type_t packet_type);
+
+/**
+ * Get the name of a packet type, such as `UserState`.
+ *
+ * @returns the name, or NULL if the type is unknown.
+ */
+const char* mumble_packet_name(mumble_packet_type_t packet_type);
+
+/**
+ * Write a packet header.
+ *
+ * @param[out] output      a buffer with room for `kMumbleHeaderSize` bytes.
+ * @param[in]  packet_type the packet type.
+ * @param[in]  length      the length of the packet body.
+ */
+void mumble_packet_write_header(uint8_t* output,
+                                mumble_packet_type_t packet_type,
+                                uint32_t length);
+
+/**
+ * Append a framed packet to a buffer.
+ *
+ * The header is reserved up front and the message is packed straight into
+ * the buffer behind it in a single pass, after which the header is filled in
+ * with the resulting length.
+ *
+ * @param[in] buffer      the buffer to append to.
+ * @param[in] packet_type the packet type.
+ * @param[in] message     a pointer to the protobuf structure.
+ *
+ * @returns the number of bytes appended including the header, or zero if the
+ *   packet type is unknown or the buffer couldn't grow. Nothing is appended on
+ *   failure.
+ */
+size_t mumble_packet_pack(mumble_buffer_t* buffer,
+                          mumble_packet_type_t packet_type,
+                          const void* message);
+
+/**
+ * Frame a packet into a new segment.
+ *
+ * Like `mumble_packet_pack`, the message is packed in a single pass straight
+ * behind the header, into a segment that grows as needed.
  *
  * @param[in] packet_type the packet type.
  * @param[in] message     a pointer to the protobuf structure.
- * @param[in] buffer      the buffer to write to.
  *
- * @returns the number of bytes written.
+ * @returns a segment with a single reference, or NULL if the packet type has
+ *   no message, such as UDPTunnel, or if out of memory.
  */
-size_t mumble_packet_proto_pack(mumble_packet_type_t packet_type, void* message,
-                                void* buffer);
+mumble_segment_t* mumble_packet_pack_segment(mumble_packet_type_t packet_type,
+                                             const void* message);
 
 #endif /* MUMBLE_PROTOCOL_H */
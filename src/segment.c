@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "segment.h"
+
+mumble_segment_t* mumble_segment_new(size_t size)
+{
+    mumble_segment_t* segment =
+        (mumble_segment_t*)malloc(sizeof(mumble_segment_t) + size);
+
+    if (!segment)
+        return NULL;
+
+    segment->refcount = 1;
+    segment->size = size;
+    segment->data = segment->inline_data;
+
+    return segment;
+}
+
+mumble_segment_t* mumble_segment_ref(mumble_segment_t* segment)
+{
+    segment->refcount++;
+
+    return segment;
+}
+
+void mumble_segment_unref(mumble_segment_t* segment)
+{
+    if (!segment || --segment->refcount > 0)
+        return;
+
+    free(segment);
+}
+
+void mumble_write_queue_init(mumble_write_queue_t* queue)
+{
+    queue->entries = NULL;
+    queue->head = 0;
+    queue->count = 0;
+    queue->capacity = 0;
+    queue->size = 0;
+}
+
+void mumble_write_queue_free(mumble_write_queue_t* queue)
+{
+    while (queue->count > 0)
+        mumble_segment_unref(mumble_write_queue_pop(queue));
+
+    free(queue->entries);
+    mumble_write_queue_init(queue);
+}
+
+/**
+ * Grow the ring, unwrapping the entries to the start of the new array.
+ */
+static int mumble_write_queue_grow(mumble_write_queue_t* queue)
+{
+    size_t i;
+    size_t capacity = queue->capacity ? queue->capacity * 2 : 16;
+    mumble_write_entry_t* entries = (mumble_write_entry_t*)malloc(
+        capacity * sizeof(mumble_write_entry_t));
+
+    if (!entries)
+        return 1;
+
+    for (i = 0; i < queue->count; i++)
+        entries[i] = queue->entries[(queue->head + i) % queue->capacity];
+
+    free(queue->entries);
+
+    queue->entries = entries;
+    queue->head = 0;
+    queue->capacity = capacity;
+
+    return 0;
+}
+
+int mumble_write_queue_push(mumble_write_queue_t* queue,
+                            mumble_segment_t* segment, double time)
+{
+    mumble_write_entry_t* entry;
+
+    if (segment->size == 0)
+        return 0;
+
+    if (queue->count == queue->capacity && mumble_write_queue_grow(queue) != 0)
+        return 1;
+
+    entry = &queue->entries[(queue->head + queue->count) % queue->capacity];
+    entry->segment = mumble_segment_ref(segment);
+    entry->time = time;
+
+    queue->count++;
+    queue->size += segment->size;
+
+    return 0;
+}
+
+mumble_segment_t* mumble_write_queue_front(const mumble_write_queue_t* queue)
+{
+    return mumble_write_queue_at(queue, 0);
+}
+
+mumble_segment_t* mumble_write_queue_at(const mumble_write_queue_t* queue,
+                                        size_t index)
+{
+    if (index >= queue->count)
+        return NULL;
+
+    return queue->entries[(queue->head + index) % queue->capacity].segment;
+}
+
+double mumble_write_queue_front_time(const mumble_write_queue_t* queue)
+{
+    if (queue->count == 0)
+        return 0;
+
+    return queue->entries[queue->head].time;
+}
+
+mumble_segment_t* mumble_write_queue_pop(mumble_write_queue_t* queue)
+{
+    mumble_segment_t* segment;
+
+    if (queue->count == 0)
+        return NULL;
+
+    segment = queue->entries[queue->head].segment;
+
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    queue->size -= segment->size;
+
+    return segment;
+}
@@ -0,0 +1,172 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file segment.h
+ * @brief Shared packet segments and a chained write queue.
+ *
+ * A segment holds the serialized bytes of one or more framed packets. Once
+ * created it is immutable and reference counted, so a packet that is
+ * broadcast to many servers is encoded once and queued on every connection
+ * without being copied.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_SEGMENT_H
+#define MUMBLE_SEGMENT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The number of bytes that are coalesced into a single TLS write.
+ *
+ * This matches the maximum TLS record payload.
+ */
+static const size_t kMumbleWriteCoalesceSize = 1024 * 16;
+
+/**
+ * A reference counted, immutable buffer of packet data.
+ */
+typedef struct mumble_segment_t
+{
+    /** The number of references to the segment. */
+    unsigned int refcount;
+    /** The number of bytes in `data`. */
+    size_t size;
+    /** Pointer to the data, which is `inline_data`. */
+    uint8_t* data;
+    /** The data, allocated along with the segment. */
+    uint8_t inline_data[];
+} mumble_segment_t;
+
+/**
+ * A queued reference to a segment.
+ */
+typedef struct mumble_write_entry_t
+{
+    /** The queued segment. */
+    mumble_segment_t* segment;
+    /** The time the segment was queued at, in seconds. */
+    double time;
+} mumble_write_entry_t;
+
+/**
+ * A FIFO of segments waiting to be written, kept in a ring.
+ */
+typedef struct mumble_write_queue_t
+{
+    /** The ring of queued entries. */
+    mumble_write_entry_t* entries;
+    /** The index of the first segment. */
+    size_t head;
+    /** The number of queued segments. */
+    size_t count;
+    /** The number of segments there is room for. */
+    size_t capacity;
+    /** The total number of bytes in the queued segments. */
+    size_t size;
+} mumble_write_queue_t;
+
+/**
+ * Create a segment with room for `size` bytes.
+ *
+ * The caller fills in the data before sharing the segment.
+ *
+ * @param[in] size the number of bytes.
+ *
+ * @returns a segment with a single reference, or NULL if out of memory.
+ */
+mumble_segment_t* mumble_segment_new(size_t size);
+
+/**
+ * Add a reference to a segment.
+ *
+ * @returns the segment.
+ */
+mumble_segment_t* mumble_segment_ref(mumble_segment_t* segment);
+
+/**
+ * Drop a reference to a segment, freeing it when none remain.
+ */
+void mumble_segment_unref(mumble_segment_t* segment);
+
+/**
+ * Initialize an empty write queue.
+ */
+void mumble_write_queue_init(mumble_write_queue_t* queue);
+
+/**
+ * Drop all queued segments and free the memory used by a write queue.
+ */
+void mumble_write_queue_free(mumble_write_queue_t* queue);
+
+/**
+ * Append a segment to a write queue.
+ *
+ * The queue takes its own reference to the segment.
+ *
+ * @param[in] queue   a pointer to the queue.
+ * @param[in] segment a pointer to the segment.
+ * @param[in] time    the current time, in seconds.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_write_queue_push(mumble_write_queue_t* queue,
+                            mumble_segment_t* segment, double time);
+
+/**
+ * Get the first queued segment, without removing it.
+ *
+ * @returns a pointer to the segment, or NULL if the queue is empty.
+ */
+mumble_segment_t* mumble_write_queue_front(const mumble_write_queue_t* queue);
+
+/**
+ * Get a queued segment by its position from the front of the queue.
+ *
+ * @returns a pointer to the segment, or NULL if out of range.
+ */
+mumble_segment_t* mumble_write_queue_at(const mumble_write_queue_t* queue,
+                                        size_t index);
+
+/**
+ * Get the time the first queued segment was queued at.
+ *
+ * @returns the time in seconds, or zero if the queue is empty.
+ */
+double mumble_write_queue_front_time(const mumble_write_queue_t* queue);
+
+/**
+ * Remove the first queued segment.
+ *
+ * The queues reference is handed to the caller.
+ *
+ * @returns a pointer to the segment, or NULL if the queue is empty.
+ */
+mumble_segment_t* mumble_write_queue_pop(mumble_write_queue_t* queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_SEGMENT_H */
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <limits.h>
 #include <errno.h>
 #include <unistd.h>
 #include <fcntl.h>
@@ -16,7 +17,14 @@
 #include "buffer.h"
 #include "iserver.h"
 #include "internal.h"
+#define LOG_SUBSYSTEM LOG_SUBSYSTEM_NET
 #include "log.h"
+#include "clock.h"
+#include "probes.h"
+
+#ifdef MUMBLE_HAVE_KTLS
+#include <sys/socket.h>
+#endif
 
 #define EV_IO_RESET(x, y, z)                                                   \
     do                                                                         \
@@ -26,20 +34,16 @@
         ev_io_start((x), (y));                                                 \
     } while (0)
 
-/**
- * The mumble message header length.
- */
-static const size_t kMumbleHeaderSize = (sizeof(uint16_t) + sizeof(uint32_t));
-
 /**
  * The client name to be sent in the version message.
  */
 static const char* kMumbleClientName =
     "libmumble (github.com/mkroman/libmumble)";
 
-#define MUMBLE_EMIT_CALLBACK(n, ...)                                           \
-    if (server->callbacks.n)                                                   \
-        server->callbacks.n(__VA_ARGS__);
+/**
+ * An empty set of callbacks.
+ */
+static const struct mumble_callback_t kMumbleNoCallbacks = MUMBLE_CALLBACK_INIT;
 
 static int setnonblock(socket_t fd)
 {
@@ -86,7 +90,8 @@ socket_t mumble_server_create_socket()
 struct mumble_server_t* mumble_server_new(const char* host, uint32_t port)
 {
     struct mumble_server_t* server =
-        (struct mumble_server_t*)malloc(sizeof(struct mumble_server_t));
+        (struct mumble_server_t*)mumble_aligned_alloc(
+            sizeof(struct mumble_server_t));
 
     if (!server)
         return NULL;
@@ -98,22 +103,101 @@ struct mumble_server_t* mumble_server_new(const char* host, uint32_t port)
     return server;
 }
 
+/**
+ * Resume writing once the shaper has tokens for the next voice packet.
+ */
+static void mumble_server_shaper_ready(struct ev_loop* loop, ev_timer* w,
+                                       int revents)
+{
+    struct mumble_server_t* server = (struct mumble_server_t*)w->data;
+
+    (void)revents;
+
+    EV_IO_RESET(loop, &server->watcher, EV_READ | EV_WRITE);
+}
+
+/**
+ * Get the number of bytes queued on a server that haven't been written yet.
+ */
+static size_t mumble_server_pending(const struct mumble_server_t* server)
+{
+    int lane;
+    size_t pending = 0;
+
+    if (server->inflight)
+        pending = server->inflight->size - server->inflight_offset;
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        pending += server->lanes[lane].size;
+
+    return pending;
+}
+
+/**
+ * Drop the segment that is being written.
+ */
+static void mumble_server_release_inflight(struct mumble_server_t* server)
+{
+    if (server->inflight != server->scratch)
+        mumble_segment_unref(server->inflight);
+
+    server->inflight = NULL;
+    server->inflight_offset = 0;
+}
+
 int mumble_server_init(struct mumble_server_t* server)
 {
+    int i;
+
     if (!server)
         return 1;
 
     server->users = NULL;
     server->client = NULL;
+    server->fd = -1;
+    server->ssl = NULL;
+    server->user_data = NULL;
+    server->version = 0;
+    server->capture = NULL;
     server->channels = NULL;
-    server->callbacks = (struct mumble_callback_t)MUMBLE_CALLBACK_INIT;
+    mumble_server_set_callbacks(server, &kMumbleNoCallbacks);
     server->welcome_text = NULL;
-    mumble_buffer_init(&server->wbuffer);
-    mumble_buffer_init(&server->rbuffer);
-
-    ev_init(&server->ping_timer, mumble_server_ping);
-    server->ping_timer.repeat = 5;
-    server->ping_timer.data = server;
+    memset(server->blob_requests, 0, sizeof server->blob_requests);
+    mumble_user_table_init(&server->user_table);
+    mumble_map_init(&server->user_index);
+    mumble_map_init(&server->channel_index);
+    server->ktls_send = 0;
+    server->inflight = NULL;
+    server->inflight_offset = 0;
+    server->scratch = NULL;
+    server->write_low_watermark = kMumbleWriteLowWatermark;
+    server->write_high_watermark = kMumbleWriteHighWatermark;
+    server->write_blocked = 0;
+    server->voice_streak = 0;
+    server->voice_deadline = kMumbleVoiceDeadline;
+    server->voice_dropped = 0;
+    server->shaped_segment = NULL;
+    server->throttled_bytes = 0;
+    mumble_token_bucket_init(&server->shaper, 0, 0);
+    ev_init(&server->shaper_timer, mumble_server_shaper_ready);
+    server->shaper_timer.data = server;
+
+    for (i = 0; i < MUMBLE_LANE_MAX; i++)
+        mumble_write_queue_init(&server->lanes[i]);
+
+    /* Nothing is allocated until there is data to read or write. */
+    mumble_buffer_init_pooled(&server->rbuffer, NULL);
+
+    mumble_timer_init(&server->connect_timer, mumble_server_connect_timeout,
+                      server);
+    mumble_timer_init(&server->ping_timer, mumble_server_ping, server);
+    server->ping_interval = kMumblePingInterval;
+    server->ping_sent = 0;
+    server->last_received = 0;
+    server->last_activity = 0;
+    server->missed_pings = 0;
+    mumble_ping_stats_init(&server->ping_stats);
+    memset(&server->metrics, 0, sizeof server->metrics);
 
     return 0;
 }
@@ -130,6 +214,16 @@ int mumble_server_ssl_init(struct mumble_server_t* server)
         return 1;
     }
 
+#ifdef MUMBLE_HAVE_KTLS
+    /* Ask OpenSSL to hand the connection to the kernel after the handshake,
+     * if the kernel and the negotiated cipher allow it. */
+    if (server->client->settings.enable_ktls)
+        SSL_set_options(server->ssl, SSL_OP_ENABLE_KTLS);
+#endif
+
+    /* Let large packets be written a TLS record at a time. */
+    SSL_set_mode(server->ssl, SSL_MODE_ENABLE_PARTIAL_WRITE);
+
     if (!SSL_set_fd(server->ssl, server->fd))
     {
         LOG_ERROR("Could not set file descriptor on SSL object");
@@ -140,20 +234,106 @@ int mumble_server_ssl_init(struct mumble_server_t* server)
     return 0;
 }
 
+/**
+ * Drop everything that is queued or being written.
+ */
+static void mumble_server_drop_writes(struct mumble_server_t* server)
+{
+    int lane;
+    mumble_segment_t* segment;
+
+    mumble_server_release_inflight(server);
+    mumble_segment_unref(server->scratch);
+    server->scratch = NULL;
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        while ((segment = mumble_write_queue_pop(&server->lanes[lane])))
+            mumble_segment_unref(segment);
+
+    server->shaped_segment = NULL;
+    server->write_blocked = 0;
+    server->voice_streak = 0;
+}
+
 void mumble_server_close(struct mumble_server_t* server)
 {
+    mumble_timer_stop(&server->client->timers, &server->connect_timer);
+    mumble_timer_stop(&server->client->timers, &server->ping_timer);
+    ev_timer_stop(server->client->loop, &server->shaper_timer);
     close(server->fd);
+    server->fd = -1;
     ev_io_stop(server->client->loop, &server->watcher);
+    mumble_server_drop_writes(server);
+}
+
+/**
+ * Free the channels and users known on a server.
+ *
+ * The interned strings they hold are released back to the client context, so
+ * this has to happen before the context is freed.
+ */
+static void mumble_server_free_state(struct mumble_server_t* server)
+{
+    int i;
+    mumble_channel_t* channel, *channelptr;
+    mumble_user_t* user, *userptr;
+
+    for (channel = server->channels; channel != NULL; channel = channelptr)
+    {
+        channelptr = channel->next;
+        mumble_channel_free(channel);
+    }
+
+    for (user = server->users; user != NULL; user = userptr)
+    {
+        userptr = user->next;
+        mumble_user_free(user);
+    }
+
+    server->channels = NULL;
+    server->users = NULL;
+    server->version = 0;
+    mumble_user_table_clear(&server->user_table);
+    mumble_map_clear(&server->user_index);
+    mumble_map_clear(&server->channel_index);
+
+    for (i = 0; i < MUMBLE_BLOB_KIND_MAX; i++)
+        server->blob_requests[i].size = 0;
+
+    /* Whatever is left of a packet belongs to the old connection. */
+    mumble_buffer_free(&server->rbuffer);
 }
 
 void mumble_server_free(struct mumble_server_t* server)
 {
+    int i;
+
+    if (server->client)
+    {
+        mumble_timer_stop(&server->client->timers, &server->connect_timer);
+        mumble_timer_stop(&server->client->timers, &server->ping_timer);
+        ev_timer_stop(server->client->loop, &server->shaper_timer);
+    }
+
+    mumble_server_free_state(server);
+    mumble_server_set_capture(server, NULL);
     SSL_free(server->ssl);
 
-    free(server->wbuffer.ptr);
-    free(server->rbuffer.ptr);
+    for (i = 0; i < MUMBLE_BLOB_KIND_MAX; i++)
+        free(server->blob_requests[i].ids);
+
+    mumble_user_table_free(&server->user_table);
+    mumble_map_free(&server->user_index);
+    mumble_map_free(&server->channel_index);
+
+    mumble_server_drop_writes(server);
+
+    for (i = 0; i < MUMBLE_LANE_MAX; i++)
+        mumble_write_queue_free(&server->lanes[i]);
+
+    mumble_buffer_free(&server->rbuffer);
     free(server->welcome_text);
-    free(server);
+    mumble_aligned_free(server);
 }
 
 int mumble_server_connect(struct mumble_server_t* server)
@@ -232,9 +412,22 @@ int mumble_server_connect(struct mumble_server_t* server)
                EV_READ | EV_WRITE);
     ev_io_start(server->client->loop, &server->watcher);
 
+    mumble_timer_start(&server->client->timers, &server->connect_timer,
+                       kMumbleConnectTimeout);
+    server->metrics.connect_start = mumble_clock_us();
+
     return result;
 }
 
+void mumble_server_connect_timeout(mumble_timer_t* timer)
+{
+    struct mumble_server_t* srv = (struct mumble_server_t*)timer->data;
+
+    LOG_ERROR("Timed out connecting to %s:%d", srv->host, srv->port);
+
+    mumble_server_close(srv);
+}
+
 void mumble_server_handshake(struct ev_loop* loop, ev_io* w, int revents)
 {
     struct mumble_server_t* srv = (struct mumble_server_t*)w->data;
@@ -246,10 +439,25 @@ void mumble_server_handshake(struct ev_loop* loop, ev_io* w, int revents)
     {
         /* SSL handshake complete */
         LOG_DEBUG("SSL handshake complete");
+        mumble_timer_stop(&srv->client->timers, &srv->connect_timer);
+        srv->metrics.connects++;
+        srv->metrics.handshake_us =
+            mumble_clock_us() - srv->metrics.connect_start;
+        MUMBLE_PROBE3(handshake__done, srv, srv->host,
+                      srv->metrics.handshake_us);
 
         EV_IO_RESET(loop, w, EV_READ);
         ev_set_cb(w, mumble_server_callback);
 
+#ifdef MUMBLE_HAVE_KTLS
+        srv->ktls_send = BIO_get_ktls_send(SSL_get_wbio(srv->ssl)) > 0;
+
+        if (srv->ktls_send)
+        {
+            LOG_INFO("Kernel TLS enabled for writes (host=%s)", srv->host);
+        }
+#endif
+
         /* Announce that the connection has been established. */
         mumble_server_connected(srv);
     }
@@ -311,246 +519,860 @@ void mumble_server_handshake(struct ev_loop* loop, ev_io* w, int revents)
     }
 }
 
-void mumble_server_callback(EV_P_ ev_io* w, int revents)
+/**
+ * Account for `sent` bytes having been written.
+ *
+ * Once the pending data drops to the low watermark after a sender was turned
+ * away, the `on_writable` callback is called.
+ */
+static void mumble_server_sent(struct mumble_server_t* server, size_t sent)
 {
-    int result;
-    struct mumble_server_t* srv = (struct mumble_server_t*)w->data;
+    LOG_INFO("Sent %zu bytes", sent);
+    MUMBLE_PROBE2(tls__write, server, sent);
+    server->metrics.tls_bytes_written += sent;
 
-    if (revents & EV_WRITE)
+    if (server->write_blocked &&
+        mumble_server_pending(server) <= server->write_low_watermark)
     {
-        /* Write any pending data. */
-        size_t sent;
-        size_t buffer_size = srv->wbuffer.size;
+        server->write_blocked = 0;
 
-        assert(buffer_size > 0);
-        sent = SSL_write(srv->ssl, srv->wbuffer.ptr, buffer_size);
-        assert(sent > 0);
-
-        if (sent > 0)
-        {
-            LOG_INFO("Sent %zu bytes", sent);
-            mumble_buffer_read(&srv->wbuffer, NULL, sent);
-        }
-        else
-        {
-            int err = SSL_get_error(srv->ssl, sent);
+        MUMBLE_EMIT_CALLBACK(server, on_writable, server);
+    }
+}
 
-            if (err == SSL_ERROR_ZERO_RETURN)
-            {
-                /* The connection was closed. */
-                mumble_server_disconnected(srv);
-            }
-            else
-            {
-                LOG_INFO("Could not read from SSL object (err=%d ret=%zu)", err,
-                         sent);
-            }
-        }
+/**
+ * Drop the queued voice packets that have missed their deadline.
+ */
+static void mumble_server_expire_voice(struct mumble_server_t* server)
+{
+    mumble_write_queue_t* voice = &server->lanes[MUMBLE_LANE_VOICE];
+    double deadline = ev_now(server->client->loop) - server->voice_deadline;
 
-        if (srv->wbuffer.size == 0)
-        {
-            /* If the buffer is empty, mark the io watcher. */
-            EV_IO_RESET(loop, w, EV_READ);
-        }
-    }
-    else /* Assume EV_READ. */
+    while (voice->count > 0 && mumble_write_queue_front_time(voice) < deadline)
     {
-        struct mumble_t* ctx = srv->client;
-        result = SSL_read(srv->ssl, ctx->buffer, sizeof(ctx->buffer));
+        mumble_segment_unref(mumble_write_queue_pop(voice));
+        server->voice_dropped++;
+    }
+}
 
-        if (result > 0)
-        {
-            LOG_INFO("Received %d bytes", result);
-            mumble_buffer_write(&srv->rbuffer, (uint8_t*)ctx->buffer, result);
+/**
+ * The state of the scheduler while picking packets for a single write.
+ */
+typedef struct mumble_send_plan_t
+{
+    /** The number of packets picked from each lane, not yet removed. */
+    size_t taken[MUMBLE_LANE_MAX];
+    /** The number of voice packets picked in a row while bulk was waiting. */
+    unsigned int voice_streak;
+    /** The voice bytes that can still be sent, or negative for no limit. */
+    double voice_tokens;
+} mumble_send_plan_t;
 
-            if (srv->rbuffer.size > kMumbleHeaderSize)
-                while (mumble_server_read_packet(srv))
-                    ;
-            ;
-        }
-        else if (result == 0)
-        {
-            mumble_server_disconnected(srv);
-        }
-        else
-        {
-            LOG_ERROR("Could not read from SSL object: %d", result);
-        }
-    }
+/**
+ * Get the number of shaper tokens a voice packet costs.
+ */
+static double mumble_voice_cost(const mumble_segment_t* segment)
+{
+    return (double)(segment->size + kMumbleTcpOverhead);
 }
 
-int mumble_server_read_packet(struct mumble_server_t* server)
+/**
+ * Start a plan from the current state of a server.
+ */
+static void mumble_server_plan_init(struct mumble_server_t* server,
+                                    mumble_send_plan_t* plan)
 {
-    uint16_t type;
-    uint32_t length;
-    size_t packet_length;
+    int lane;
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        plan->taken[lane] = 0;
 
-    if (server->rbuffer.size > kMumbleHeaderSize)
+    plan->voice_streak = server->voice_streak;
+    plan->voice_tokens = -1;
+
+    if (server->shaper.rate > 0)
     {
-        type = ntohs(*(uint16_t*)server->rbuffer.ptr);
-        length = ntohl(*(uint32_t*)(server->rbuffer.ptr + sizeof(uint16_t)));
-        packet_length = length + kMumbleHeaderSize;
+        mumble_token_bucket_fill(&server->shaper, mumble_clock_us());
+        plan->voice_tokens = server->shaper.tokens;
+    }
+}
 
-        if (server->rbuffer.size >= packet_length)
-        {
-            if (mumble_server_handle_packet(server, type, length))
-            {
-                LOG_INFO("Handled packet (size=%zu type=%d)", packet_length,
-                         type);
+/**
+ * Check whether the shaper lets the next voice packet of a plan through.
+ */
+static int mumble_server_voice_allowed(struct mumble_server_t* server,
+                                       const mumble_send_plan_t* plan)
+{
+    mumble_segment_t* segment;
 
-                /* Discard the data from the buffer. */
-                mumble_buffer_read(&server->rbuffer, NULL, packet_length);
+    if (plan->voice_tokens < 0)
+        return 1;
 
-                return 1;
-            }
-        }
+    segment = mumble_write_queue_at(&server->lanes[MUMBLE_LANE_VOICE],
+                                    plan->taken[MUMBLE_LANE_VOICE]);
+
+    if (plan->voice_tokens >= mumble_voice_cost(segment))
+        return 1;
+
+    /* Count every packet held back by the shaper once. */
+    if (segment != server->shaped_segment)
+    {
+        server->shaped_segment = segment;
+        server->throttled_bytes += segment->size;
     }
 
     return 0;
 }
 
 /**
- * Write data to the connections outgoing buffer.
+ * Pick the lane to take the next packet from.
  *
- * @param[in] server a pointer to the server structure.
- * @param[in] data   a pointer to the data to write to the buffer.
- * @param[in] length the number of bytes contained in `data`.
+ * @param[in] server a pointer to the server.
+ * @param[in] plan   the packets picked so far.
  *
- * @returns the number of bytes written.
+ * @returns the lane, or `MUMBLE_LANE_MAX` if there's nothing that can be sent
+ *   right now.
  */
-size_t mumble_server_write(struct mumble_server_t* server, char* data,
-                           size_t length)
+static mumble_lane_t mumble_server_schedule(struct mumble_server_t* server,
+                                            const mumble_send_plan_t* plan)
 {
-    size_t result =
-        mumble_buffer_write(&server->wbuffer, (uint8_t*)data, length);
-    ev_io* watcher = &server->watcher;
-    struct ev_loop* loop = server->client->loop;
+    int voice = plan->taken[MUMBLE_LANE_VOICE] <
+                    server->lanes[MUMBLE_LANE_VOICE].count &&
+                mumble_server_voice_allowed(server, plan);
+    int bulk =
+        plan->taken[MUMBLE_LANE_BULK] < server->lanes[MUMBLE_LANE_BULK].count;
 
-    /* Modify the watchers event flags. */
-    EV_IO_RESET(loop, watcher, EV_READ | EV_WRITE);
+    if (plan->taken[MUMBLE_LANE_CONTROL] <
+        server->lanes[MUMBLE_LANE_CONTROL].count)
+        return MUMBLE_LANE_CONTROL;
 
-    return result;
+    if (voice && (!bulk || plan->voice_streak < kMumbleVoiceBurst))
+        return MUMBLE_LANE_VOICE;
+
+    if (bulk)
+        return MUMBLE_LANE_BULK;
+
+    return MUMBLE_LANE_MAX;
 }
 
-int mumble_server_handle_packet(struct mumble_server_t* server, uint16_t type,
-                                uint32_t length)
+/**
+ * Add the next packet of a lane to a plan.
+ *
+ * @returns the packet.
+ */
+static mumble_segment_t* mumble_server_plan_take(struct mumble_server_t* server,
+                                                 mumble_send_plan_t* plan,
+                                                 mumble_lane_t lane)
 {
-    mumble_handler_func_t handler;
-    const uint8_t* body =
-        (const uint8_t*)server->rbuffer.ptr + kMumbleHeaderSize;
+    mumble_segment_t* segment =
+        mumble_write_queue_at(&server->lanes[lane], plan->taken[lane]++);
 
-    if (type >= MUMBLE_PACKET_MAX)
+    if (lane == MUMBLE_LANE_VOICE)
     {
-        LOG_WARN("Received invalid packet type %d", type);
+        plan->voice_streak++;
 
-        return 1;
+        if (plan->voice_tokens >= 0)
+            plan->voice_tokens -= mumble_voice_cost(segment);
+    }
+    else if (lane == MUMBLE_LANE_BULK)
+    {
+        plan->voice_streak = 0;
     }
 
-    if ((handler = g_mumble_packet_handlers[type]) != NULL)
-        return handler(server, body, length);
-
-    return 1;
+    return segment;
 }
 
-void mumble_server_set_callbacks(struct mumble_server_t* server,
-                                 const struct mumble_callback_t* callbacks)
+/**
+ * Remove the first packet of a lane once it is being written.
+ *
+ * @returns the packet, with the reference of the lane.
+ */
+static mumble_segment_t* mumble_server_pop(struct mumble_server_t* server,
+                                           mumble_lane_t lane)
 {
-    if (!server)
-        return;
+    mumble_segment_t* segment = mumble_write_queue_pop(&server->lanes[lane]);
 
-    server->callbacks = *callbacks;
+    if (lane == MUMBLE_LANE_VOICE)
+    {
+        server->voice_streak++;
+        mumble_token_bucket_take(&server->shaper, mumble_voice_cost(segment));
+    }
+    else if (lane == MUMBLE_LANE_BULK)
+    {
+        server->voice_streak = 0;
+    }
+
+    return segment;
 }
 
-void mumble_server_connected(struct mumble_server_t* server)
+/**
+ * Wake up when the shaper lets the next voice packet through.
+ */
+static void mumble_server_shaper_wait(struct mumble_server_t* server)
 {
-    LOG_DEBUG("Connected to %s:%d", server->host, server->port);
+    double delay;
+    mumble_segment_t* segment =
+        mumble_write_queue_front(&server->lanes[MUMBLE_LANE_VOICE]);
 
-    /* Start the ping timer. */
-    ev_timer_start(server->client->loop, &server->ping_timer);
+    if (!segment || ev_is_active(&server->shaper_timer))
+        return;
 
-    mumble_server_send_version(server);
-    mumble_server_send_authenticate(server, "libmumble", "");
+    delay = mumble_token_bucket_delay(&server->shaper,
+                                      mumble_voice_cost(segment));
 
-    MUMBLE_EMIT_CALLBACK(on_connect, server);
+    if (delay > 0)
+    {
+        ev_timer_set(&server->shaper_timer, delay, 0.);
+        ev_timer_start(server->client->loop, &server->shaper_timer);
+    }
 }
 
-void mumble_server_disconnected(struct mumble_server_t* server)
+#ifdef MUMBLE_HAVE_KTLS
+/**
+ * Write the pending segments straight to a socket that the kernel encrypts,
+ * in one `sendmsg` call and without coalescing.
+ */
+static void mumble_server_flush_ktls(struct mumble_server_t* server)
 {
-    mumble_channel_t* channel, *channelptr;
-    mumble_user_t* user, *userptr;
-
-    LOG_DEBUG("Connection to %s:%d lost", server->host, server->port);
-
-    MUMBLE_EMIT_CALLBACK(on_disconnect, server);
-
-    /* Stop the ping timer. */
-    LOG_INFO("Stopping ping timer");
-    ev_timer_stop(server->client->loop, &server->ping_timer);
-
-    /* Stop the io watcher. */
-    LOG_INFO("Stopping io watcher");
-    ev_io_stop(server->client->loop, &server->watcher);
-
-    for (channel = server->channels; channel != NULL; channel = channelptr)
+    ssize_t sent;
+    size_t i, remaining;
+    struct msghdr msg;
+    struct iovec iov[64];
+    mumble_lane_t lanes[64];
+    mumble_segment_t* segment;
+    const size_t max_iov = sizeof(iov) / sizeof(iov[0]);
+    mumble_send_plan_t plan;
+    mumble_lane_t lane;
+
+    mumble_server_expire_voice(server);
+    mumble_server_plan_init(server, &plan);
+
+    memset(&msg, 0, sizeof msg);
+    msg.msg_iov = iov;
+
+    /* A partially written packet has to be finished first. */
+    if (server->inflight)
     {
-        channelptr = channel->next;
-        mumble_channel_free(channel);
+        iov[0].iov_base = server->inflight->data + server->inflight_offset;
+        iov[0].iov_len = server->inflight->size - server->inflight_offset;
+        msg.msg_iovlen = 1;
     }
 
-    for (user = server->users; user != NULL; user = userptr)
+    /* Then whole packets in the order the scheduler picks them. */
+    while (msg.msg_iovlen < max_iov &&
+           (lane = mumble_server_schedule(server, &plan)) != MUMBLE_LANE_MAX)
     {
-        userptr = user->next;
-        mumble_user_free(user);
+        segment = mumble_server_plan_take(server, &plan, lane);
+
+        iov[msg.msg_iovlen].iov_base = segment->data;
+        iov[msg.msg_iovlen].iov_len = segment->size;
+        lanes[msg.msg_iovlen] = lane;
+        msg.msg_iovlen++;
     }
 
-    server->channels = NULL;
-    server->users = NULL;
+    if (msg.msg_iovlen == 0)
+        return;
 
-    close(server->fd);
-}
+    sent = sendmsg(server->fd, &msg, MSG_NOSIGNAL);
 
-int mumble_server_send(struct mumble_server_t* server,
-                       mumble_packet_type_t packet_type, void* message)
-{
-    size_t length;
-    size_t result;
-    uint8_t* body;
-    char* buffer;
+    if (sent < 0)
+    {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            LOG_ERROR("Could not write to socket: %s", strerror(errno));
+            mumble_server_disconnected(server);
+        }
 
-    /* Get the packed size of the packet. */
-    length = mumble_packet_size_packed(packet_type, message);
+        return;
+    }
 
-    /* Construct the packet header. */
-    buffer = (char*)malloc(kMumbleHeaderSize + length);
+    remaining = (size_t)sent;
+    i = 0;
 
-    if (!buffer)
-        return 0;
+    if (server->inflight)
+    {
+        if (remaining < iov[0].iov_len)
+        {
+            server->inflight_offset += remaining;
+            mumble_server_sent(server, sent);
 
-    body = (uint8_t*)(buffer + kMumbleHeaderSize);
+            return;
+        }
 
-    /* Write and pack the protobuf message. */
-    result = mumble_packet_proto_pack(packet_type, message, body);
+        remaining -= iov[0].iov_len;
+        mumble_server_release_inflight(server);
+        i = 1;
+    }
 
-    /* Write the packet header. */
-    *(uint16_t*)buffer = htons(packet_type);
-    *(uint32_t*)(buffer + sizeof(uint16_t)) = htonl(length);
+    /* The queued packets were taken from the front of their lanes, so they
+     * are consumed from the front as well. */
+    for (; i < msg.msg_iovlen && remaining > 0; i++)
+    {
+        segment = mumble_server_pop(server, lanes[i]);
 
-    result = mumble_server_write(server, buffer, (length + kMumbleHeaderSize));
+        if (remaining < segment->size)
+        {
+            server->inflight = segment;
+            server->inflight_offset = remaining;
 
-    /* Free the packet buffer. */
-    free(buffer);
+            break;
+        }
 
-    if (result > 0)
+        remaining -= segment->size;
+        mumble_segment_unref(segment);
+    }
+
+    mumble_server_sent(server, sent);
+}
+#endif
+
+/**
+ * Pick the next data to write.
+ *
+ * A packet that doesn't fit in one TLS record together with the next one is
+ * written in place. Otherwise whole packets are coalesced into the scratch
+ * segment in the order the scheduler picks them, until the next one wouldn't
+ * fit in `kMumbleWriteCoalesceSize` bytes, so they go out in one TLS record.
+ *
+ * @returns zero on success, non-zero if out of memory.
+ */
+static int mumble_server_fill(struct mumble_server_t* server)
+{
+    size_t size = 0;
+    mumble_send_plan_t plan;
+    mumble_lane_t lane, next;
+    mumble_segment_t* segment;
+
+    mumble_server_expire_voice(server);
+    mumble_server_plan_init(server, &plan);
+
+    if ((lane = mumble_server_schedule(server, &plan)) == MUMBLE_LANE_MAX)
+        return 0;
+
+    /* Copying only pays off if another packet goes out in the same record. */
+    segment = mumble_server_plan_take(server, &plan, lane);
+    next = mumble_server_schedule(server, &plan);
+
+    if (next == MUMBLE_LANE_MAX ||
+        segment->size +
+                mumble_write_queue_at(&server->lanes[next],
+                                      plan.taken[next])->size >
+            kMumbleWriteCoalesceSize)
+    {
+        server->inflight = mumble_server_pop(server, lane);
+
+        return 0;
+    }
+
+    if (!server->scratch)
+    {
+        if (!(server->scratch = mumble_segment_new(kMumbleWriteCoalesceSize)))
+            return 1;
+
+        server->metrics.allocations++;
+    }
+
+    /* Packets are removed as they are copied, so the plan starts over after
+     * each one. */
+    while (lane != MUMBLE_LANE_MAX)
+    {
+        segment = mumble_write_queue_front(&server->lanes[lane]);
+
+        if (size + segment->size > kMumbleWriteCoalesceSize)
+            break;
+
+        memcpy(server->scratch->inline_data + size, segment->data,
+               segment->size);
+        size += segment->size;
+
+        mumble_segment_unref(mumble_server_pop(server, lane));
+
+        mumble_server_plan_init(server, &plan);
+        lane = mumble_server_schedule(server, &plan);
+    }
+
+    server->scratch->size = size;
+    server->inflight = server->scratch;
+
+    return 0;
+}
+
+/**
+ * Write as much pending data as possible in a single TLS write.
+ *
+ * The data of a failed write stays in flight, so it is retried with the same
+ * bytes even if more urgent packets are queued in the meantime.
+ */
+static void mumble_server_flush(struct mumble_server_t* server)
+{
+    int sent;
+    size_t length;
+
+#ifdef MUMBLE_HAVE_KTLS
+    if (server->ktls_send)
+    {
+        mumble_server_flush_ktls(server);
+
+        return;
+    }
+#endif
+
+    if (!server->inflight && mumble_server_fill(server) != 0)
+    {
+        LOG_ERROR("Could not allocate write buffer");
+
+        return;
+    }
+
+    if (!server->inflight)
+        return;
+
+    length = server->inflight->size - server->inflight_offset;
+
+    if (length > INT_MAX)
+        length = INT_MAX;
+
+    sent = SSL_write(server->ssl,
+                     server->inflight->data + server->inflight_offset,
+                     (int)length);
+
+    if (sent > 0)
+    {
+        server->inflight_offset += sent;
+
+        if (server->inflight_offset == server->inflight->size)
+            mumble_server_release_inflight(server);
+
+        mumble_server_sent(server, sent);
+    }
+    else
+    {
+        int err = SSL_get_error(server->ssl, sent);
+
+        if (err == SSL_ERROR_ZERO_RETURN)
+        {
+            /* The connection was closed. */
+            mumble_server_disconnected(server);
+        }
+        else if (err != SSL_ERROR_WANT_READ && err != SSL_ERROR_WANT_WRITE)
+        {
+            /* The data would be retried on every write event forever. */
+            LOG_ERROR("Could not write to SSL object (err=%d ret=%d)", err,
+                      sent);
+            mumble_server_disconnected(server);
+        }
+    }
+}
+
+void mumble_server_callback(EV_P_ ev_io* w, int revents)
+{
+    int result;
+    struct mumble_server_t* srv = (struct mumble_server_t*)w->data;
+
+    if (revents & EV_WRITE)
+    {
+        srv->client->metrics.write_events++;
+
+        /* Write any pending data. */
+        mumble_server_flush(srv);
+
+        /* The flush may have dropped the connection, and with it the
+         * watcher, which must not be started again on the closed fd. */
+        if (srv->fd == -1)
+            return;
+
+        if (!srv->inflight)
+        {
+            mumble_send_plan_t plan;
+
+            mumble_server_plan_init(srv, &plan);
+
+            /* If there's nothing that can be sent, mark the io watcher, and
+             * wait for the shaper if voice is being held back. */
+            if (mumble_server_schedule(srv, &plan) == MUMBLE_LANE_MAX)
+            {
+                EV_IO_RESET(loop, w, EV_READ);
+                mumble_server_shaper_wait(srv);
+            }
+        }
+    }
+    else /* Assume EV_READ. */
+    {
+        struct mumble_t* ctx = srv->client;
+        size_t capacity = srv->rbuffer.capacity;
+        int received = 0;
+
+        ctx->metrics.read_events++;
+
+        /* OpenSSL reads whole records off the socket, so whatever doesn't fit
+         * in the buffer is pending in the SSL object, where the watcher
+         * wouldn't fire for it. */
+        do
+        {
+            result = SSL_read(srv->ssl, ctx->buffer, sizeof(ctx->buffer));
+            MUMBLE_PROBE2(tls__read, srv, result);
+
+            if (result <= 0)
+                break;
+
+            LOG_INFO("Received %d bytes", result);
+            received += result;
+            srv->metrics.tls_bytes_read += (uint64_t)result;
+
+            if (mumble_buffer_write(&srv->rbuffer, (uint8_t*)ctx->buffer,
+                                    result) != (size_t)result)
+            {
+                LOG_ERROR("Read buffer of %s:%d is full, disconnecting",
+                          srv->host, srv->port);
+                mumble_server_disconnected(srv);
+
+                return;
+            }
+        } while (SSL_pending(srv->ssl) > 0);
+
+        if (received > 0)
+        {
+            srv->last_received = mumble_clock_us();
+
+            if (srv->rbuffer.capacity != capacity)
+                srv->metrics.allocations++;
+
+            if (srv->rbuffer.size > srv->metrics.rbuffer_max)
+                srv->metrics.rbuffer_max = srv->rbuffer.size;
+
+            while ((result = mumble_server_read_packet(srv)) > 0)
+                ;
+
+            if (result < 0)
+            {
+                LOG_ERROR("Malformed data from %s:%d, disconnecting",
+                          srv->host, srv->port);
+                mumble_server_disconnected(srv);
+
+                return;
+            }
+
+            /* Give memory back after a burst, such as the initial sync. */
+            mumble_buffer_trim(&srv->rbuffer);
+
+            /* Request any blobs we didn't have cached in a single packet. */
+            mumble_server_send_blob_requests(srv);
+        }
+        else if (result == 0)
+        {
+            mumble_server_disconnected(srv);
+        }
+        else
+        {
+            LOG_ERROR("Could not read from SSL object: %d", result);
+        }
+    }
+}
+
+int mumble_server_read_packet(struct mumble_server_t* server)
+{
+    uint16_t type;
+    uint32_t length;
+    size_t packet_length;
+
+    if (server->rbuffer.size >= kMumbleHeaderSize)
+    {
+        type = ntohs(*(uint16_t*)server->rbuffer.ptr);
+        length = ntohl(*(uint32_t*)(server->rbuffer.ptr + sizeof(uint16_t)));
+        packet_length = length + kMumbleHeaderSize;
+
+        /* Check the length as soon as the header is in, so that a bogus
+         * length can't make us buffer the body. */
+        if (length > mumble_packet_max_size((mumble_packet_type_t)type))
+        {
+            LOG_WARN("Packet too large (size=%u type=%d)", length, type);
+
+            return -1;
+        }
+
+        if (server->rbuffer.size >= packet_length)
+        {
+            uint64_t start = mumble_clock_ns();
+
+            MUMBLE_PROBE3(packet__receive, server, type, length);
+
+            if (mumble_server_handle_packet(server, type, length))
+            {
+                if (type < MUMBLE_PACKET_MAX)
+                {
+                    server->metrics.packets_in[type]++;
+                    server->metrics.bytes_in[type] += packet_length;
+                    server->metrics.decode_ns[type] +=
+                        mumble_clock_ns() - start;
+                }
+
+                LOG_INFO("Handled packet (size=%zu type=%d)", packet_length,
+                         type);
+
+                /* Record the packet once it's handled, so that one that is
+                 * retried isn't recorded twice. */
+                if (server->capture &&
+                    mumble_capture_write(server->capture, start / 1000,
+                                         server->rbuffer.ptr,
+                                         packet_length) != 0)
+                {
+                    LOG_ERROR("Could not write capture, stopping it");
+                    mumble_server_set_capture(server, NULL);
+                }
+
+                /* Discard the data from the buffer. */
+                mumble_buffer_read(&server->rbuffer, NULL, packet_length);
+
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+int mumble_server_handle_packet(struct mumble_server_t* server, uint16_t type,
+                                uint32_t length)
+{
+    int result = 1;
+    mumble_handler_func_t handler;
+    const uint8_t* body =
+        (const uint8_t*)server->rbuffer.ptr + kMumbleHeaderSize;
+
+    if (type >= MUMBLE_PACKET_MAX)
+    {
+        LOG_WARN("Received invalid packet type %d", type);
+
+        return 1;
+    }
+
+    if (type != MUMBLE_PACKET_PING)
+        server->last_activity = server->last_received;
+
+    if (server->skipped_packets & (1u << type))
         return 1;
 
-    return 0;
+    MUMBLE_PROBE3(dispatch__start, server, type, length);
+
+    /* Voice is by far the most frequent packet type and its body is raw, so
+     * it bypasses the handler table and never reaches protobuf decoding. */
+    if (type == MUMBLE_PACKET_UDPTUNNEL)
+        result = mumble_packet_handle_udp_tunnel(server, body, length);
+    else if ((handler = g_mumble_packet_handlers[type]) != NULL)
+        result = handler(server, body, length);
+
+    MUMBLE_PROBE3(dispatch__done, server, type, result);
+
+    return result;
+}
+
+void mumble_server_set_callbacks(struct mumble_server_t* server,
+                                 const struct mumble_callback_t* callbacks)
+{
+    if (!server)
+        return;
+
+    server->callbacks = *callbacks;
+    server->skipped_packets = 0;
+
+    if (!callbacks->on_voice)
+        server->skipped_packets |= (1u << MUMBLE_PACKET_UDPTUNNEL);
+
+    if (!callbacks->on_text_message)
+        server->skipped_packets |= (1u << MUMBLE_PACKET_TEXT_MESSAGE);
+
+    if (!callbacks->on_permission_denied)
+        server->skipped_packets |= (1u << MUMBLE_PACKET_PERMISSION_DENIED);
+}
+
+void mumble_server_connected(struct mumble_server_t* server)
+{
+    uint64_t now = mumble_clock_us();
+
+    LOG_DEBUG("Connected to %s:%d", server->host, server->port);
+
+    /* Start the keepalive timer. The connection counts as the first probe. */
+    server->ping_interval = kMumblePingInterval;
+    server->ping_sent = server->last_received = server->last_activity = now;
+    server->missed_pings = 0;
+    mumble_timer_start(&server->client->timers, &server->ping_timer,
+                       server->ping_interval);
+
+    mumble_server_send_version(server);
+    mumble_server_send_authenticate(server, "libmumble", "");
+
+    MUMBLE_EMIT_CALLBACK(server, on_connect, server);
+}
+
+void mumble_server_disconnected(struct mumble_server_t* server)
+{
+    LOG_DEBUG("Connection to %s:%d lost", server->host, server->port);
+    server->metrics.disconnects++;
+
+    MUMBLE_EMIT_CALLBACK(server, on_disconnect, server);
+
+    /* Stop the ping timer. */
+    LOG_INFO("Stopping ping timer");
+    mumble_timer_stop(&server->client->timers, &server->ping_timer);
+    ev_timer_stop(server->client->loop, &server->shaper_timer);
+
+    /* Stop the io watcher. */
+    LOG_INFO("Stopping io watcher");
+    ev_io_stop(server->client->loop, &server->watcher);
+
+    /* Whatever wasn't written belongs to the old connection. */
+    mumble_server_drop_writes(server);
+    mumble_server_free_state(server);
+
+    close(server->fd);
+    server->fd = -1;
+}
+
+/**
+ * Get the lane a packet type is sent in.
+ */
+static mumble_lane_t mumble_packet_lane(mumble_packet_type_t packet_type)
+{
+    switch (packet_type)
+    {
+        case MUMBLE_PACKET_UDPTUNNEL:
+            return MUMBLE_LANE_VOICE;
+        case MUMBLE_PACKET_TEXT_MESSAGE:
+        case MUMBLE_PACKET_USER_STATE:
+        case MUMBLE_PACKET_REQUEST_BLOB:
+            return MUMBLE_LANE_BULK;
+        default:
+            return MUMBLE_LANE_CONTROL;
+    }
+}
+
+/**
+ * Frame and pack a message into a new segment.
+ *
+ * @returns the segment, or NULL if the packet type has no message or if out of
+ *   memory.
+ */
+static mumble_segment_t* mumble_packet_segment(mumble_packet_type_t packet_type,
+                                               void* message)
+{
+    mumble_segment_t* segment;
+
+    /* Checked here as well, as the check while packing is only an assertion
+     * and release builds would otherwise just fail quietly. */
+    if (!mumble_packet_descriptor(packet_type))
+    {
+        LOG_ERROR("Cannot send a message as packet type %d", packet_type);
+
+        return NULL;
+    }
+
+    if (!(segment = mumble_packet_pack_segment(packet_type, message)))
+        LOG_ERROR("Could not pack packet (type=%d)", packet_type);
+
+    return segment;
+}
+
+int mumble_server_send(struct mumble_server_t* server,
+                       mumble_packet_type_t packet_type, void* message)
+{
+    int result;
+    mumble_segment_t* segment;
+
+    if (!(segment = mumble_packet_segment(packet_type, message)))
+        return 0;
+
+    server->metrics.allocations++;
+    result = mumble_server_send_segment(server, mumble_packet_lane(packet_type),
+                                        segment);
+    mumble_segment_unref(segment);
+
+    return result;
+}
+
+int mumble_server_send_segment(struct mumble_server_t* server,
+                               mumble_lane_t lane, mumble_segment_t* segment)
+{
+    size_t pending;
+    uint16_t type;
+    ev_io* watcher = &server->watcher;
+    struct ev_loop* loop;
+
+    /* Nothing would ever be written on a closed connection. */
+    if (server->fd == -1)
+        return 0;
+
+    loop = server->client->loop;
+
+    /* Turn data away once the high watermark is reached, but never control
+     * packets, which are small and keep the connection alive. */
+    if (lane != MUMBLE_LANE_CONTROL &&
+        mumble_server_pending(server) >= server->write_high_watermark)
+    {
+        server->write_blocked = 1;
+        server->metrics.packets_rejected++;
+
+        return 0;
+    }
+
+    if (mumble_write_queue_push(&server->lanes[lane], segment,
+                                ev_now(loop)) != 0)
+        return 0;
+
+    /* Segments hold a single framed packet. */
+    type = (uint16_t)(segment->data[0] << 8 | segment->data[1]);
+    MUMBLE_PROBE4(send__enqueue, server, lane, type, segment->size);
+
+    if (type < MUMBLE_PACKET_MAX)
+    {
+        server->metrics.packets_out[type]++;
+        server->metrics.bytes_out[type] += segment->size;
+    }
+
+    if ((pending = mumble_server_pending(server)) > server->metrics.pending_max)
+        server->metrics.pending_max = pending;
+
+    /* Modify the watchers event flags. */
+    EV_IO_RESET(loop, watcher, EV_READ | EV_WRITE);
+
+    return 1;
 }
 
-void mumble_server_ping(struct ev_loop* loop, ev_timer* w, int revents)
+void mumble_server_ping(mumble_timer_t* timer)
 {
-    struct mumble_server_t* srv = (struct mumble_server_t*)w->data;
+    struct mumble_server_t* srv = (struct mumble_server_t*)timer->data;
+    uint64_t now = mumble_clock_us();
 
-    (void)revents;
+    /* Nothing at all since the last ping means the ping was missed. */
+    if (srv->last_received < srv->ping_sent)
+        srv->missed_pings++;
+    else
+        srv->missed_pings = 0;
+
+    if (srv->missed_pings >= kMumblePingMaxMissed)
+    {
+        LOG_WARN("No reply to %u pings from %s:%d, disconnecting",
+                 srv->missed_pings, srv->host, srv->port);
+
+        mumble_server_disconnected(srv);
+
+        return;
+    }
+
+    /* Other packets prove that the server is alive, so the interval backs
+     * off while they keep coming. A quiet or missed interval starts over. */
+    if (srv->missed_pings == 0 && srv->last_activity >= srv->ping_sent)
+    {
+        srv->ping_interval *= 2;
+
+        if (srv->ping_interval > kMumblePingMaxInterval)
+            srv->ping_interval = kMumblePingMaxInterval;
+    }
+    else
+    {
+        srv->ping_interval = kMumblePingInterval;
+    }
+
+    srv->ping_sent = now;
 
     if (mumble_server_send_ping(srv) != 1)
     {
@@ -561,12 +1383,40 @@ void mumble_server_ping(struct ev_loop* loop, ev_timer* w, int revents)
         LOG_INFO("Sending ping packet");
     }
 
-    ev_timer_again(loop, w);
+    /* Let a quiet server hold no read buffer until it has data again. Any
+     * other server takes it back from the pool on its next read. */
+    mumble_buffer_release(&srv->rbuffer);
+
+    mumble_timer_start(&srv->client->timers, timer, srv->ping_interval);
 }
 
 int mumble_server_send_ping(struct mumble_server_t* server)
 {
     MumbleProto__Ping ping = MUMBLE_PROTO__PING__INIT;
+    const mumble_ping_stats_t* stats = &server->ping_stats;
+
+    /* The server echoes the timestamp back, which gives the round-trip
+     * time. */
+    ping.timestamp = mumble_clock_us();
+    ping.has_timestamp = 1;
+
+    /* Voice is tunneled over TCP, so there's no UDP crypt state to report. */
+    ping.good = ping.late = ping.lost = ping.resync = 0;
+    ping.has_good = ping.has_late = ping.has_lost = ping.has_resync = 1;
+    ping.udp_packets = 0;
+    ping.has_udp_packets = 1;
+
+    ping.tcp_packets = stats->samples;
+    ping.has_tcp_packets = 1;
+
+    if (stats->samples > 0)
+    {
+        /* The server expects the average and variance in milliseconds. */
+        ping.tcp_ping_avg = stats->srtt / 1000.0f;
+        ping.tcp_ping_var =
+            (stats->rttvar / 1000.0f) * (stats->rttvar / 1000.0f);
+        ping.has_tcp_ping_avg = ping.has_tcp_ping_var = 1;
+    }
 
     return mumble_server_send(server, MUMBLE_PACKET_PING, &ping);
 }
@@ -599,6 +1449,178 @@ int mumble_server_send_authenticate(struct mumble_server_t* server,
                               &authenticate);
 }
 
+struct mumble_user_t* mumble_server_find_user(struct mumble_server_t* server,
+                                              uint32_t session)
+{
+    uintptr_t user;
+
+    if (mumble_map_get(&server->user_index, session, &user))
+        return (struct mumble_user_t*)user;
+
+    return NULL;
+}
+
+struct mumble_user_t* mumble_server_add_user(struct mumble_server_t* server,
+                                             uint32_t session)
+{
+    mumble_user_t* user = (mumble_user_t*)malloc(sizeof(mumble_user_t));
+
+    if (!user)
+        return NULL;
+
+    mumble_user_init(user);
+    user->session = session;
+
+    if (mumble_map_set(&server->user_index, session, (uintptr_t)user) != 0)
+    {
+        free(user);
+
+        return NULL;
+    }
+
+    user->next = server->users;
+
+    if (server->users)
+        server->users->prev = user;
+
+    server->users = user;
+
+    return user;
+}
+
+void mumble_server_remove_user(struct mumble_server_t* server,
+                               struct mumble_user_t* user)
+{
+    if (user->prev)
+        user->prev->next = user->next;
+    else
+        server->users = user->next;
+
+    if (user->next)
+        user->next->prev = user->prev;
+
+    mumble_map_remove(&server->user_index, user->session);
+    mumble_user_table_remove(&server->user_table, user->session);
+    mumble_user_free(user);
+}
+
+struct mumble_channel_t*
+mumble_server_find_channel(struct mumble_server_t* server, uint32_t channel_id)
+{
+    uintptr_t channel;
+
+    if (mumble_map_get(&server->channel_index, channel_id, &channel))
+        return (struct mumble_channel_t*)channel;
+
+    return NULL;
+}
+
+struct mumble_channel_t*
+mumble_server_add_channel(struct mumble_server_t* server, uint32_t channel_id)
+{
+    mumble_channel_t* channel =
+        (mumble_channel_t*)malloc(sizeof(mumble_channel_t));
+
+    if (!channel)
+        return NULL;
+
+    mumble_channel_init(channel);
+    channel->id = channel_id;
+
+    if (mumble_map_set(&server->channel_index, channel_id,
+                       (uintptr_t)channel) != 0)
+    {
+        free(channel);
+
+        return NULL;
+    }
+
+    channel->next = server->channels;
+
+    if (server->channels)
+        server->channels->prev = channel;
+
+    server->channels = channel;
+
+    return channel;
+}
+
+void mumble_server_remove_channel(struct mumble_server_t* server,
+                                  struct mumble_channel_t* channel)
+{
+    if (channel->prev)
+        channel->prev->next = channel->next;
+    else
+        server->channels = channel->next;
+
+    if (channel->next)
+        channel->next->prev = channel->prev;
+
+    mumble_map_remove(&server->channel_index, channel->id);
+    mumble_user_table_remove_channel(&server->user_table, channel->id);
+    mumble_channel_free(channel);
+}
+
+int mumble_server_request_blob(struct mumble_server_t* server,
+                               mumble_blob_kind_t kind, uint32_t id)
+{
+    size_t i;
+    mumble_id_list_t* list = &server->blob_requests[kind];
+
+    for (i = 0; i < list->size; i++)
+        if (list->ids[i] == id)
+            return 0;
+
+    if (list->size == list->capacity)
+    {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        uint32_t* ids =
+            (uint32_t*)realloc(list->ids, capacity * sizeof(uint32_t));
+
+        if (!ids)
+            return 1;
+
+        list->ids = ids;
+        list->capacity = capacity;
+    }
+
+    list->ids[list->size++] = id;
+
+    return 0;
+}
+
+int mumble_server_send_blob_requests(struct mumble_server_t* server)
+{
+    int result;
+    mumble_id_list_t* lists = server->blob_requests;
+    MumbleProto__RequestBlob request_blob = MUMBLE_PROTO__REQUEST_BLOB__INIT;
+
+    if (lists[MUMBLE_BLOB_TEXTURE].size == 0 &&
+        lists[MUMBLE_BLOB_COMMENT].size == 0 &&
+        lists[MUMBLE_BLOB_DESCRIPTION].size == 0)
+        return 1;
+
+    request_blob.n_session_texture = lists[MUMBLE_BLOB_TEXTURE].size;
+    request_blob.session_texture = lists[MUMBLE_BLOB_TEXTURE].ids;
+    request_blob.n_session_comment = lists[MUMBLE_BLOB_COMMENT].size;
+    request_blob.session_comment = lists[MUMBLE_BLOB_COMMENT].ids;
+    request_blob.n_channel_description = lists[MUMBLE_BLOB_DESCRIPTION].size;
+    request_blob.channel_description = lists[MUMBLE_BLOB_DESCRIPTION].ids;
+
+    LOG_DEBUG("Requesting blobs (textures=%zu comments=%zu descriptions=%zu)",
+              lists[MUMBLE_BLOB_TEXTURE].size, lists[MUMBLE_BLOB_COMMENT].size,
+              lists[MUMBLE_BLOB_DESCRIPTION].size);
+
+    result = mumble_server_send(server, MUMBLE_PACKET_REQUEST_BLOB,
+                                &request_blob);
+
+    lists[MUMBLE_BLOB_TEXTURE].size = 0;
+    lists[MUMBLE_BLOB_COMMENT].size = 0;
+    lists[MUMBLE_BLOB_DESCRIPTION].size = 0;
+
+    return result;
+}
+
 const struct mumble_user_t*
 mumble_server_get_user_by_id(struct mumble_server_t* server, uint32_t id)
 {
@@ -618,16 +1640,10 @@ const struct mumble_user_t*
 mumble_server_get_user_by_session_id(struct mumble_server_t* server,
                                      uint32_t session_id)
 {
-    const struct mumble_user_t* user;
-
     if (!server)
         return NULL;
 
-    for (user = server->users; user != NULL; user = user->next)
-        if (user->session == session_id)
-            break;
-
-    return user;
+    return mumble_server_find_user(server, session_id);
 }
 
 const struct mumble_user_t*
@@ -645,6 +1661,255 @@ mumble_server_get_user_by_name(struct mumble_server_t* server, const char* name)
     return user;
 }
 
+const uint32_t*
+mumble_server_get_channel_sessions(struct mumble_server_t* server,
+                                   uint32_t channel_id, size_t* count)
+{
+    if (!server || !count)
+        return NULL;
+
+    return mumble_user_table_channel_sessions(&server->user_table, channel_id,
+                                              count);
+}
+
+size_t mumble_server_get_user_columns(struct mumble_server_t* server,
+                                      const uint32_t** sessions,
+                                      const uint32_t** channels,
+                                      const uint32_t** flags)
+{
+    const mumble_user_table_t* table;
+
+    if (!server)
+        return 0;
+
+    table = &server->user_table;
+
+    if (sessions)
+        *sessions = table->sessions;
+
+    if (channels)
+        *channels = table->channels;
+
+    if (flags)
+        *flags = table->flags;
+
+    return table->size;
+}
+
+size_t mumble_server_find_sessions_by_flags(struct mumble_server_t* server,
+                                            uint32_t flags, uint32_t* sessions,
+                                            size_t max)
+{
+    size_t i, count = 0;
+    const mumble_user_table_t* table;
+
+    if (!server)
+        return 0;
+
+    table = &server->user_table;
+
+    for (i = 0; i < table->size && count < max; i++)
+        if (table->flags[i] & flags)
+            sessions[count++] = table->sessions[i];
+
+    return count;
+}
+
+/**
+ * Queue the same segment on every connected server in a list.
+ *
+ * @returns the number of servers the segment was queued on.
+ */
+static size_t mumble_servers_send_segment(struct mumble_server_t* const* servers,
+                                          size_t num_servers,
+                                          mumble_lane_t lane,
+                                          mumble_segment_t* segment)
+{
+    size_t i, count = 0;
+
+    for (i = 0; i < num_servers; i++)
+    {
+        if (!servers[i] || !servers[i]->client)
+            continue;
+
+        if (mumble_server_send_segment(servers[i], lane, segment))
+            count++;
+    }
+
+    return count;
+}
+
+/**
+ * Fill a TextMessage with a message and its recipients.
+ */
+static void mumble_server_text_message(MumbleProto__TextMessage* text_message,
+                                       const char* message,
+                                       const mumble_text_targets_t* targets)
+{
+    text_message->message = (char*)message;
+    text_message->n_session = targets->num_sessions;
+    text_message->session = (uint32_t*)targets->sessions;
+    text_message->n_channel_id = targets->num_channels;
+    text_message->channel_id = (uint32_t*)targets->channels;
+    text_message->n_tree_id = targets->num_trees;
+    text_message->tree_id = (uint32_t*)targets->trees;
+}
+
+int mumble_server_send_text_message(struct mumble_server_t* server,
+                                    const char* message,
+                                    const mumble_text_targets_t* targets)
+{
+    MumbleProto__TextMessage text_message = MUMBLE_PROTO__TEXT_MESSAGE__INIT;
+
+    if (!server || !message || !targets)
+        return 1;
+
+    mumble_server_text_message(&text_message, message, targets);
+
+    return !mumble_server_send(server, MUMBLE_PACKET_TEXT_MESSAGE,
+                               &text_message);
+}
+
+size_t mumble_servers_send_text_message(struct mumble_server_t* const* servers,
+                                        size_t num_servers,
+                                        const char* message,
+                                        const mumble_text_targets_t* targets)
+{
+    size_t count;
+    mumble_segment_t* segment;
+    MumbleProto__TextMessage text_message = MUMBLE_PROTO__TEXT_MESSAGE__INIT;
+
+    if (!servers || !message || !targets)
+        return 0;
+
+    mumble_server_text_message(&text_message, message, targets);
+
+    /* Encode the packet once and share the bytes with every server. */
+    if (!(segment = mumble_packet_segment(MUMBLE_PACKET_TEXT_MESSAGE,
+                                          &text_message)))
+        return 0;
+
+    count = mumble_servers_send_segment(servers, num_servers, MUMBLE_LANE_BULK,
+                                        segment);
+    mumble_segment_unref(segment);
+
+    return count;
+}
+
+/**
+ * Frame a voice packet into a new segment.
+ */
+static mumble_segment_t* mumble_voice_segment(const uint8_t* packet,
+                                              size_t length)
+{
+    mumble_segment_t* segment = mumble_segment_new(kMumbleHeaderSize + length);
+
+    if (!segment)
+        return NULL;
+
+    mumble_packet_write_header(segment->data, MUMBLE_PACKET_UDPTUNNEL,
+                               (uint32_t)length);
+
+    if (length > 0)
+        memcpy(segment->data + kMumbleHeaderSize, packet, length);
+
+    return segment;
+}
+
+int mumble_server_send_voice(struct mumble_server_t* server,
+                             const uint8_t* packet, size_t length)
+{
+    int result;
+    mumble_segment_t* segment;
+
+    if (!server || !server->client || (!packet && length > 0) ||
+        length > UINT32_MAX)
+        return 1;
+
+    if (!(segment = mumble_voice_segment(packet, length)))
+        return 1;
+
+    server->metrics.allocations++;
+    result = mumble_server_send_segment(server, MUMBLE_LANE_VOICE, segment);
+    mumble_segment_unref(segment);
+
+    return !result;
+}
+
+size_t mumble_servers_send_voice(struct mumble_server_t* const* servers,
+                                 size_t num_servers, const uint8_t* packet,
+                                 size_t length)
+{
+    size_t count;
+    mumble_segment_t* segment;
+
+    if (!servers || (!packet && length > 0) || length > UINT32_MAX)
+        return 0;
+
+    if (!(segment = mumble_voice_segment(packet, length)))
+        return 0;
+
+    count = mumble_servers_send_segment(servers, num_servers,
+                                        MUMBLE_LANE_VOICE, segment);
+    mumble_segment_unref(segment);
+
+    return count;
+}
+
+void mumble_server_set_write_watermarks(struct mumble_server_t* server,
+                                        size_t low, size_t high)
+{
+    if (!server || low > high)
+        return;
+
+    server->write_low_watermark = low;
+    server->write_high_watermark = high;
+}
+
+void mumble_server_set_voice_deadline(struct mumble_server_t* server,
+                                      double seconds)
+{
+    if (!server || seconds <= 0)
+        return;
+
+    server->voice_deadline = seconds;
+}
+
+void mumble_server_get_audio_settings(const struct mumble_server_t* server,
+                                      int* bitrate, int* frames)
+{
+    /* Voice is always tunneled through the TCP control channel. */
+    mumble_audio_adjust_bandwidth(server ? server->max_bandwidth : 0, 1,
+                                  bitrate, frames);
+}
+
+uint64_t mumble_server_get_throttled_bytes(const struct mumble_server_t* server)
+{
+    if (!server)
+        return 0;
+
+    return server->throttled_bytes;
+}
+
+int mumble_server_get_ping_stats(const struct mumble_server_t* server,
+                                 mumble_ping_stats_t* stats)
+{
+    if (!server || !stats || server->ping_stats.samples == 0)
+        return 1;
+
+    *stats = server->ping_stats;
+
+    return 0;
+}
+
+size_t mumble_server_get_pending_bytes(const struct mumble_server_t* server)
+{
+    if (!server)
+        return 0;
+
+    return mumble_server_pending(server);
+}
+
 const char* mumble_server_get_host(const struct mumble_server_t* server)
 {
     return server->host;
@@ -654,3 +1919,45 @@ uint32_t mumble_server_get_port(const struct mumble_server_t* server)
 {
     return server->port;
 }
+
+void mumble_server_set_user_data(struct mumble_server_t* server, void* data)
+{
+    server->user_data = data;
+}
+
+void* mumble_server_get_user_data(const struct mumble_server_t* server)
+{
+    return server->user_data;
+}
+
+int mumble_server_set_capture(struct mumble_server_t* server, const char* path)
+{
+    if (server->capture)
+    {
+        if (mumble_capture_close(server->capture) != 0)
+            LOG_ERROR("Could not finish writing capture");
+
+        free(server->capture);
+        server->capture = NULL;
+    }
+
+    if (!path)
+        return 0;
+
+    server->capture = (mumble_capture_t*)malloc(sizeof(mumble_capture_t));
+
+    if (!server->capture)
+        return 1;
+
+    if (mumble_capture_open(server->capture, path, mumble_clock_us()) != 0)
+    {
+        LOG_ERROR("Could not create capture %s", path);
+
+        free(server->capture);
+        server->capture = NULL;
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include "shaper.h"
+
+void mumble_token_bucket_init(mumble_token_bucket_t* bucket, double rate,
+                              uint64_t now)
+{
+    bucket->rate = rate;
+    bucket->burst = rate * kMumbleShaperBurst;
+
+    if (bucket->burst < kMumbleShaperMinBurst)
+        bucket->burst = kMumbleShaperMinBurst;
+
+    bucket->tokens = bucket->burst;
+    bucket->time = now;
+}
+
+void mumble_token_bucket_fill(mumble_token_bucket_t* bucket, uint64_t now)
+{
+    if (now > bucket->time)
+    {
+        bucket->tokens += (double)(now - bucket->time) / 1e6 * bucket->rate;
+
+        if (bucket->tokens > bucket->burst)
+            bucket->tokens = bucket->burst;
+    }
+
+    bucket->time = now;
+}
+
+void mumble_token_bucket_take(mumble_token_bucket_t* bucket, double tokens)
+{
+    if (bucket->rate > 0)
+        bucket->tokens -= tokens;
+}
+
+double mumble_token_bucket_delay(const mumble_token_bucket_t* bucket,
+                                 double tokens)
+{
+    if (bucket->rate <= 0 || bucket->tokens >= tokens)
+        return 0;
+
+    return (tokens - bucket->tokens) / bucket->rate;
+}
+
+int mumble_audio_bandwidth(int bitrate, int frames, int tcp)
+{
+    /* IP, UDP, crypt, header, sequence number and frame headers. */
+    int overhead = 20 + 8 + 4 + 1 + 2 + frames;
+
+    /* TCP headers are 12 bytes larger than UDP headers. */
+    if (tcp)
+        overhead += 12;
+
+    /* Bytes per packet to bits per second, at 100 frames per second. */
+    return overhead * (800 / frames) + bitrate;
+}
+
+void mumble_audio_adjust_bandwidth(int max_bandwidth, int tcp, int* bitrate,
+                                   int* frames)
+{
+    *bitrate = kMumbleAudioBitrate;
+    *frames = kMumbleAudioFrames;
+
+    if (max_bandwidth <= 0 ||
+        mumble_audio_bandwidth(*bitrate, *frames, tcp) <= max_bandwidth)
+        return;
+
+    /* Send fewer, larger packets to cut down on header overhead. */
+    if (*frames <= 4 && max_bandwidth <= 32000)
+        *frames = 4;
+    else if (*frames == 1 && max_bandwidth <= 64000)
+        *frames = 2;
+    else if (*frames == 2 && max_bandwidth <= 48000)
+        *frames = 4;
+
+    while (*bitrate > kMumbleAudioMinBitrate &&
+           mumble_audio_bandwidth(*bitrate, *frames, tcp) > max_bandwidth)
+        *bitrate -= 1000;
+
+    if (*bitrate < kMumbleAudioMinBitrate)
+        *bitrate = kMumbleAudioMinBitrate;
+}
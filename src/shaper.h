@@ -0,0 +1,155 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file shaper.h
+ * @brief Token bucket rate limiting and audio bandwidth budgeting.
+ *
+ * The server announces the maximum bandwidth a client may use for audio in
+ * its ServerSync message, and kicks clients that exceed it. Outgoing voice is
+ * passed through a token bucket filled at that rate, and the audio encoder
+ * settings are picked so the stream, including its per-packet overhead,
+ * fits within it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_SHAPER_H
+#define MUMBLE_SHAPER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The number of seconds worth of tokens a bucket can hold.
+ */
+static const double kMumbleShaperBurst = 0.25;
+
+/**
+ * The smallest number of tokens a bucket can hold, so a single voice packet
+ * always fits.
+ */
+static const double kMumbleShaperMinBurst = 1500;
+
+/**
+ * Bytes of TCP/IP headers sent along with every packet over TCP.
+ */
+static const size_t kMumbleTcpOverhead = 40;
+
+/**
+ * The default Opus bitrate, in bits per second.
+ */
+static const int kMumbleAudioBitrate = 40000;
+
+/**
+ * The lowest Opus bitrate the bitrate is lowered to, in bits per second.
+ */
+static const int kMumbleAudioMinBitrate = 8000;
+
+/**
+ * The default number of 10 ms audio frames per packet.
+ */
+static const int kMumbleAudioFrames = 2;
+
+/**
+ * A token bucket.
+ *
+ * Tokens are bytes. A rate of zero means there is no limit.
+ */
+typedef struct mumble_token_bucket_t
+{
+    /** The rate tokens are added at, in bytes per second. */
+    double rate;
+    /** The maximum number of tokens. */
+    double burst;
+    /** The current number of tokens. */
+    double tokens;
+    /** The time tokens were last added at, from `mumble_clock_us`. */
+    uint64_t time;
+} mumble_token_bucket_t;
+
+/**
+ * Initialize a token bucket, full.
+ *
+ * @param[in] bucket a pointer to the bucket.
+ * @param[in] rate   the rate in bytes per second, or zero for no limit.
+ * @param[in] now    the current time, from `mumble_clock_us`.
+ */
+void mumble_token_bucket_init(mumble_token_bucket_t* bucket, double rate,
+                              uint64_t now);
+
+/**
+ * Add the tokens accumulated since the bucket was last filled.
+ *
+ * @param[in] bucket a pointer to the bucket.
+ * @param[in] now    the current time, from `mumble_clock_us`.
+ */
+void mumble_token_bucket_fill(mumble_token_bucket_t* bucket, uint64_t now);
+
+/**
+ * Take tokens from a bucket.
+ *
+ * The bucket may go into debt, which is paid back before anything else can
+ * be taken.
+ */
+void mumble_token_bucket_take(mumble_token_bucket_t* bucket, double tokens);
+
+/**
+ * Get the number of seconds until a bucket holds `tokens` tokens.
+ *
+ * @returns the delay, or zero if the tokens are available now.
+ */
+double mumble_token_bucket_delay(const mumble_token_bucket_t* bucket,
+                                 double tokens);
+
+/**
+ * Get the network bandwidth used by an audio stream.
+ *
+ * This follows the calculation of the Mumble client, including the IP, UDP
+ * or TCP, encryption and voice packet headers.
+ *
+ * @param[in] bitrate the Opus bitrate, in bits per second.
+ * @param[in] frames  the number of 10 ms frames per packet.
+ * @param[in] tcp     non-zero if the audio is tunneled over TCP.
+ *
+ * @returns the bandwidth in bits per second.
+ */
+int mumble_audio_bandwidth(int bitrate, int frames, int tcp);
+
+/**
+ * Pick the audio bitrate and frames per packet that fit a bandwidth limit.
+ *
+ * Packets are made larger before the bitrate is lowered, like the Mumble
+ * client does.
+ *
+ * @param[in]  max_bandwidth the limit in bits per second, or zero for none.
+ * @param[in]  tcp           non-zero if the audio is tunneled over TCP.
+ * @param[out] bitrate       a pointer to store the bitrate in.
+ * @param[out] frames        a pointer to store the frames per packet in.
+ */
+void mumble_audio_adjust_bandwidth(int max_bandwidth, int tcp, int* bitrate,
+                                   int* frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_SHAPER_H */
@@ -0,0 +1,356 @@
+#include <string.h>
+
+#include "timer.h"
+#include "clock.h"
+
+#define MUMBLE_TIMER_MASK (MUMBLE_TIMER_SLOTS - 1)
+
+/** The number of ticks the wheel can hold timers for. */
+#define MUMBLE_TIMER_RANGE \
+    ((uint64_t)1 << (MUMBLE_TIMER_LEVELS * MUMBLE_TIMER_BITS))
+
+/**
+ * Count the trailing zero bits of a non-zero value.
+ */
+static unsigned int mumble_timer_ctz(uint64_t value)
+{
+#ifdef __GNUC__
+    return (unsigned int)__builtin_ctzll(value);
+#else
+    unsigned int count = 0;
+
+    while (!(value & 1))
+    {
+        value >>= 1;
+        count++;
+    }
+
+    return count;
+#endif
+}
+
+/**
+ * Get the number of seconds since the wheel was initialized.
+ *
+ * The monotonic clock is used rather than `ev_now`, which follows the wall
+ * clock.
+ */
+static double mumble_timer_wheel_elapsed(const mumble_timer_wheel_t* wheel)
+{
+    return (double)(mumble_clock_us() - wheel->epoch) / 1e6;
+}
+
+/**
+ * Get the current tick.
+ */
+static uint64_t mumble_timer_wheel_now(const mumble_timer_wheel_t* wheel)
+{
+    /* Allow for rounding when the watcher fires right at a tick. */
+    return (uint64_t)(mumble_timer_wheel_elapsed(wheel) /
+                          kMumbleTimerResolution +
+                      1e-6);
+}
+
+static void mumble_timer_link(mumble_timer_wheel_t* wheel, unsigned int slot,
+                              mumble_timer_t* timer)
+{
+    mumble_timer_t** head = &wheel->slots[slot];
+
+    timer->next = *head;
+
+    if (timer->next)
+        timer->next->pprev = &timer->next;
+
+    timer->pprev = head;
+    timer->slot = slot;
+    *head = timer;
+
+    wheel->occupied[slot / MUMBLE_TIMER_SLOTS] |=
+        (uint64_t)1 << (slot & MUMBLE_TIMER_MASK);
+}
+
+static void mumble_timer_unlink(mumble_timer_wheel_t* wheel,
+                                mumble_timer_t* timer)
+{
+    *timer->pprev = timer->next;
+
+    if (timer->next)
+        timer->next->pprev = timer->pprev;
+
+    timer->next = NULL;
+    timer->pprev = NULL;
+
+    if (!wheel->slots[timer->slot])
+        wheel->occupied[timer->slot / MUMBLE_TIMER_SLOTS] &=
+            ~((uint64_t)1 << (timer->slot & MUMBLE_TIMER_MASK));
+}
+
+/**
+ * Put a timer in the lowest level that reaches its expiry tick.
+ */
+static void mumble_timer_place(mumble_timer_wheel_t* wheel,
+                               mumble_timer_t* timer)
+{
+    unsigned int level;
+    uint64_t expires = timer->expires;
+    uint64_t delta;
+
+    if (expires < wheel->tick)
+        expires = wheel->tick;
+
+    delta = expires - wheel->tick;
+
+    /* Timers beyond the range are parked in the last slot they can reach,
+     * and placed again when the wheel gets there. */
+    if (delta >= MUMBLE_TIMER_RANGE)
+        expires = wheel->tick + MUMBLE_TIMER_RANGE - 1;
+
+    for (level = 0; level < MUMBLE_TIMER_LEVELS - 1; level++)
+        if (delta < ((uint64_t)1 << ((level + 1) * MUMBLE_TIMER_BITS)))
+            break;
+
+    mumble_timer_link(wheel, level * MUMBLE_TIMER_SLOTS +
+                                 ((expires >> (level * MUMBLE_TIMER_BITS)) &
+                                  MUMBLE_TIMER_MASK),
+                      timer);
+}
+
+/**
+ * Take all timers out of a slot.
+ *
+ * The timers are moved to `pending`, so callbacks that arm timers in the same
+ * slot or stop timers that haven't been handled yet keep both lists intact.
+ */
+static void mumble_timer_take(mumble_timer_wheel_t* wheel, unsigned int slot,
+                              mumble_timer_t** pending)
+{
+    if ((*pending = wheel->slots[slot]) != NULL)
+    {
+        (*pending)->pprev = pending;
+        wheel->slots[slot] = NULL;
+        wheel->occupied[slot / MUMBLE_TIMER_SLOTS] &=
+            ~((uint64_t)1 << (slot & MUMBLE_TIMER_MASK));
+    }
+}
+
+/**
+ * Get the next tick that has to be processed, or UINT64_MAX if there is none.
+ */
+static uint64_t mumble_timer_wheel_next(const mumble_timer_wheel_t* wheel)
+{
+    int level;
+    uint64_t next = UINT64_MAX;
+    uint64_t bits = wheel->occupied[0];
+    unsigned int start = (unsigned int)((wheel->tick + 1) & MUMBLE_TIMER_MASK);
+
+    /* Every timer in the lowest level expires within a turn, so the first
+     * occupied slot from the next tick onwards is the earliest. */
+    if (bits)
+    {
+        if (start)
+            bits = (bits >> start) | (bits << (MUMBLE_TIMER_SLOTS - start));
+
+        next = wheel->tick + 1 + mumble_timer_ctz(bits);
+    }
+
+    /* Timers in the higher levels are moved down at the end of a turn. */
+    for (level = 1; level < MUMBLE_TIMER_LEVELS; level++)
+    {
+        if (wheel->occupied[level])
+        {
+            uint64_t turn = (wheel->tick | MUMBLE_TIMER_MASK) + 1;
+
+            if (turn < next)
+                next = turn;
+
+            break;
+        }
+    }
+
+    return next;
+}
+
+/**
+ * Advance the wheel to `tick`, moving timers down and calling the expired.
+ */
+static void mumble_timer_wheel_advance(mumble_timer_wheel_t* wheel,
+                                       uint64_t tick)
+{
+    int level;
+    mumble_timer_t* timer;
+    mumble_timer_t* pending;
+
+    wheel->tick = tick;
+
+    if ((tick & MUMBLE_TIMER_MASK) == 0)
+    {
+        for (level = 1; level < MUMBLE_TIMER_LEVELS; level++)
+        {
+            unsigned int index = (unsigned int)(
+                (tick >> (level * MUMBLE_TIMER_BITS)) & MUMBLE_TIMER_MASK);
+
+            mumble_timer_take(wheel, level * MUMBLE_TIMER_SLOTS + index,
+                              &pending);
+
+            while ((timer = pending) != NULL)
+            {
+                mumble_timer_unlink(wheel, timer);
+                mumble_timer_place(wheel, timer);
+            }
+
+            /* The level above only turns when this one wraps around. */
+            if (index != 0)
+                break;
+        }
+    }
+
+    mumble_timer_take(wheel, (unsigned int)(tick & MUMBLE_TIMER_MASK),
+                      &pending);
+
+    while ((timer = pending) != NULL)
+    {
+        mumble_timer_unlink(wheel, timer);
+
+        if (timer->expires <= tick)
+        {
+            wheel->count--;
+            wheel->expired++;
+            timer->callback(timer);
+        }
+        else
+        {
+            mumble_timer_place(wheel, timer);
+        }
+    }
+}
+
+/**
+ * Set the watcher for the next tick that has to be processed.
+ */
+static void mumble_timer_wheel_schedule(mumble_timer_wheel_t* wheel)
+{
+    double delay;
+
+    ev_timer_stop(wheel->loop, &wheel->watcher);
+
+    if (wheel->count == 0)
+        return;
+
+    wheel->next = mumble_timer_wheel_next(wheel);
+    delay = (double)wheel->next * kMumbleTimerResolution -
+            mumble_timer_wheel_elapsed(wheel);
+
+    if (delay < 0)
+        delay = 0;
+
+    ev_timer_set(&wheel->watcher, delay, 0.);
+    ev_timer_start(wheel->loop, &wheel->watcher);
+}
+
+static void mumble_timer_wheel_callback(EV_P_ ev_timer* w, int revents)
+{
+    uint64_t next;
+    mumble_timer_wheel_t* wheel = (mumble_timer_wheel_t*)w->data;
+    uint64_t now = mumble_timer_wheel_now(wheel);
+
+    (void)loop;
+    (void)revents;
+
+    /* Jump from one occupied tick to the next, skipping the empty ones. */
+    wheel->expiring = 1;
+
+    while (wheel->count > 0 && (next = mumble_timer_wheel_next(wheel)) <= now)
+        mumble_timer_wheel_advance(wheel, next);
+
+    wheel->expiring = 0;
+
+    mumble_timer_wheel_schedule(wheel);
+}
+
+void mumble_timer_wheel_init(mumble_timer_wheel_t* wheel,
+                             struct ev_loop* loop)
+{
+    memset(wheel->slots, 0, sizeof wheel->slots);
+    memset(wheel->occupied, 0, sizeof wheel->occupied);
+
+    wheel->tick = 0;
+    wheel->next = 0;
+    wheel->count = 0;
+    wheel->expired = 0;
+    wheel->expiring = 0;
+    wheel->loop = loop;
+    wheel->epoch = mumble_clock_us();
+
+    ev_timer_init(&wheel->watcher, mumble_timer_wheel_callback, 0., 0.);
+    wheel->watcher.data = wheel;
+}
+
+void mumble_timer_wheel_free(mumble_timer_wheel_t* wheel)
+{
+    ev_timer_stop(wheel->loop, &wheel->watcher);
+    wheel->count = 0;
+}
+
+void mumble_timer_init(mumble_timer_t* timer, mumble_timer_func_t callback,
+                       void* data)
+{
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->slot = 0;
+    timer->callback = callback;
+    timer->data = data;
+}
+
+void mumble_timer_start(mumble_timer_wheel_t* wheel, mumble_timer_t* timer,
+                        double after)
+{
+    double due;
+    uint64_t now;
+
+    mumble_timer_stop(wheel, timer);
+
+    due = (mumble_timer_wheel_elapsed(wheel) + (after > 0 ? after : 0)) /
+          kMumbleTimerResolution;
+    now = mumble_timer_wheel_now(wheel);
+
+    /* An empty wheel skips ahead instead of replaying the ticks it slept
+     * through. Otherwise the wheel may lag behind until the watcher fires,
+     * and timers are placed relative to where it is. */
+    if (wheel->count == 0)
+        wheel->tick = now;
+
+    /* Round up to the start of a tick, so a timer never expires early. */
+    timer->expires = (uint64_t)due;
+
+    if ((double)timer->expires < due)
+        timer->expires++;
+
+    if (timer->expires <= now)
+        timer->expires = now + 1;
+
+    mumble_timer_place(wheel, timer);
+    wheel->count++;
+
+    /* Only touch the watcher if the timer is due before it. */
+    if (!wheel->expiring && (!ev_is_active(&wheel->watcher) ||
+                             timer->expires < wheel->next))
+        mumble_timer_wheel_schedule(wheel);
+}
+
+void mumble_timer_stop(mumble_timer_wheel_t* wheel, mumble_timer_t* timer)
+{
+    if (!mumble_timer_is_active(timer))
+        return;
+
+    mumble_timer_unlink(wheel, timer);
+    wheel->count--;
+
+    if (wheel->count == 0 && !wheel->expiring)
+        ev_timer_stop(wheel->loop, &wheel->watcher);
+}
+
+int mumble_timer_is_active(const mumble_timer_t* timer)
+{
+    return timer->pprev != NULL;
+}
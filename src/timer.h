@@ -0,0 +1,169 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file timer.h
+ * @brief Hierarchical hashed timing wheel for per-server timers.
+ *
+ * Every server attached to a context arms its timers on the wheel of the
+ * context, which is driven by a single `ev_timer`. Expiry times are rounded
+ * up to a slot, so timers that are due in the same slot all fire in the same
+ * loop iteration, and arming or stopping a timer is constant time.
+ *
+ * The wheel has `MUMBLE_TIMER_LEVELS` levels of `MUMBLE_TIMER_SLOTS` slots.
+ * Each slot of a level spans a full turn of the level below, and timers are
+ * moved down a level when the wheel reaches their slot. The `ev_timer` is
+ * only set for the next slot that has timers in it, so an idle wheel doesn't
+ * wake the loop.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <ev.h>
+
+#pragma once
+#ifndef MUMBLE_TIMER_H
+#define MUMBLE_TIMER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** The length of a slot in the lowest level, in seconds. */
+static const double kMumbleTimerResolution = 0.1;
+/** The number of bits of the expiry tick that index a level. */
+#define MUMBLE_TIMER_BITS 6
+/** The number of slots in each level. */
+#define MUMBLE_TIMER_SLOTS (1 << MUMBLE_TIMER_BITS)
+/** The number of levels, which gives a range of about 19 days. */
+#define MUMBLE_TIMER_LEVELS 4
+
+struct mumble_timer_t;
+
+/**
+ * Timer callback function type.
+ */
+typedef void (*mumble_timer_func_t)(struct mumble_timer_t* timer);
+
+/**
+ * A timer on a timing wheel.
+ */
+typedef struct mumble_timer_t
+{
+    /** The next timer in the same slot. */
+    struct mumble_timer_t* next;
+    /** The pointer that points to this timer, or NULL if stopped. */
+    struct mumble_timer_t** pprev;
+    /** The tick the timer expires at. */
+    uint64_t expires;
+    /** The index of the slot the timer is in, counted across levels. */
+    unsigned int slot;
+    /** The function to call when the timer expires. */
+    mumble_timer_func_t callback;
+    /** User data. */
+    void* data;
+} mumble_timer_t;
+
+/**
+ * The timing wheel structure.
+ */
+typedef struct mumble_timer_wheel_t
+{
+    /** The timers in each slot, level by level. */
+    mumble_timer_t* slots[MUMBLE_TIMER_LEVELS * MUMBLE_TIMER_SLOTS];
+    /** A bit for each slot of a level that has timers in it. */
+    uint64_t occupied[MUMBLE_TIMER_LEVELS];
+    /** The last tick that was processed. */
+    uint64_t tick;
+    /** The tick the watcher is set for. */
+    uint64_t next;
+    /** The monotonic clock time of tick zero, in microseconds. */
+    uint64_t epoch;
+    /** The number of active timers. */
+    size_t count;
+    /** The number of timers that have expired. */
+    uint64_t expired;
+    /** Non-zero while expired timers are being called. */
+    int expiring;
+    /** The event loop the wheel is driven by. */
+    struct ev_loop* loop;
+    /** The timer that advances the wheel to the next occupied slot. */
+    ev_timer watcher;
+} mumble_timer_wheel_t;
+
+/**
+ * Initialize a timing wheel.
+ *
+ * @param[in] wheel a pointer to memory space to initialize.
+ * @param[in] loop  the event loop to drive the wheel with.
+ */
+void mumble_timer_wheel_init(mumble_timer_wheel_t* wheel,
+                             struct ev_loop* loop);
+
+/**
+ * Stop a timing wheel.
+ *
+ * Timers that are still active are forgotten, but not called.
+ *
+ * @param[in] wheel a pointer to the wheel.
+ */
+void mumble_timer_wheel_free(mumble_timer_wheel_t* wheel);
+
+/**
+ * Initialize a stopped timer.
+ *
+ * @param[in] timer    a pointer to the timer.
+ * @param[in] callback the function to call when the timer expires.
+ * @param[in] data     user data.
+ */
+void mumble_timer_init(mumble_timer_t* timer, mumble_timer_func_t callback,
+                       void* data);
+
+/**
+ * Arm a timer, restarting it if it's already active.
+ *
+ * The timer is stopped before its callback is called.
+ *
+ * @param[in] wheel a pointer to the wheel.
+ * @param[in] timer a pointer to the timer.
+ * @param[in] after the number of seconds until the timer expires.
+ */
+void mumble_timer_start(mumble_timer_wheel_t* wheel, mumble_timer_t* timer,
+                        double after);
+
+/**
+ * Stop a timer. Does nothing if it isn't active.
+ *
+ * @param[in] wheel a pointer to the wheel.
+ * @param[in] timer a pointer to the timer.
+ */
+void mumble_timer_stop(mumble_timer_wheel_t* wheel, mumble_timer_t* timer);
+
+/**
+ * Check if a timer is active.
+ *
+ * @returns non-zero if the timer is armed, zero otherwise.
+ */
+int mumble_timer_is_active(const mumble_timer_t* timer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_TIMER_H */
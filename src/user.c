@@ -1,12 +1,20 @@
 #include <stdlib.h>
 #include <mumble/user.h>
 
+#include "intern.h"
+#include "blob.h"
+
 mumble_user_t* mumble_user_init(mumble_user_t* user)
 {
     user->name = NULL;
     user->comment = NULL;
     user->hash = NULL;
+    user->texture = NULL;
+    user->texture_size = 0;
+    user->comment_blob = NULL;
+    user->texture_blob = NULL;
     user->next = NULL;
+    user->prev = NULL;
     user->flags = 0;
 
     return user;
@@ -14,8 +22,9 @@ mumble_user_t* mumble_user_init(mumble_user_t* user)
 
 void mumble_user_free(mumble_user_t* user)
 {
-    free(user->name);
-    free(user->comment);
-    free(user->hash);
+    mumble_intern_release(user->name);
+    mumble_intern_release(user->hash);
+    mumble_blob_release(user->comment_blob);
+    mumble_blob_release(user->texture_blob);
     free(user);
 }
@@ -0,0 +1,302 @@
+#include <stdlib.h>
+
+#include "usertable.h"
+
+/**
+ * Get the member list of a channel, optionally creating it.
+ */
+static mumble_channel_members_t*
+user_table_members(mumble_user_table_t* table, uint32_t channel, int create)
+{
+    uintptr_t value;
+    mumble_channel_members_t* members;
+
+    if (mumble_map_get(&table->members, channel, &value))
+        return (mumble_channel_members_t*)value;
+
+    if (!create)
+        return NULL;
+
+    members = (mumble_channel_members_t*)calloc(
+        1, sizeof(mumble_channel_members_t));
+
+    if (!members)
+        return NULL;
+
+    if (mumble_map_set(&table->members, channel, (uintptr_t)members) != 0)
+    {
+        free(members);
+
+        return NULL;
+    }
+
+    return members;
+}
+
+/**
+ * Free the member list of a channel.
+ */
+static void user_table_drop_members(mumble_user_table_t* table,
+                                    uint32_t channel)
+{
+    uintptr_t value;
+    mumble_channel_members_t* members;
+
+    if (!mumble_map_get(&table->members, channel, &value))
+        return;
+
+    members = (mumble_channel_members_t*)value;
+    mumble_map_remove(&table->members, channel);
+
+    free(members->sessions);
+    free(members);
+}
+
+/**
+ * Add the user in `row` to the member list of its channel.
+ */
+static int user_table_join(mumble_user_table_t* table, size_t row)
+{
+    mumble_channel_members_t* members =
+        user_table_members(table, table->channels[row], 1);
+
+    if (!members)
+        return 1;
+
+    if (members->size == members->capacity)
+    {
+        size_t capacity = members->capacity ? members->capacity * 2 : 8;
+        uint32_t* sessions = (uint32_t*)realloc(members->sessions,
+                                                capacity * sizeof(uint32_t));
+
+        if (!sessions)
+            return 1;
+
+        members->sessions = sessions;
+        members->capacity = capacity;
+    }
+
+    table->positions[row] = (uint32_t)members->size;
+    members->sessions[members->size++] = table->sessions[row];
+
+    return 0;
+}
+
+/**
+ * Remove the user in `row` from the member list of its channel.
+ */
+static void user_table_leave(mumble_user_table_t* table, size_t row)
+{
+    uint32_t moved;
+    uintptr_t moved_row;
+    uint32_t position = table->positions[row];
+    mumble_channel_members_t* members =
+        user_table_members(table, table->channels[row], 0);
+
+    /* The list may be gone, or belong to a new channel with the same id, if
+     * the channel was removed with the user still in it. */
+    if (!members || position >= members->size ||
+        members->sessions[position] != table->sessions[row])
+        return;
+
+    /* Don't keep the list of a channel around once it's empty. */
+    if (--members->size == 0)
+    {
+        user_table_drop_members(table, table->channels[row]);
+
+        return;
+    }
+
+    /* Move the last member into the hole. */
+    moved = members->sessions[members->size];
+    members->sessions[position] = moved;
+
+    if (mumble_map_get(&table->rows, moved, &moved_row))
+        table->positions[moved_row] = position;
+}
+
+static int user_table_reserve(mumble_user_table_t* table)
+{
+    size_t capacity;
+    uint32_t* arrays[4];
+    uint32_t** fields[4];
+    int i;
+
+    if (table->size < table->capacity)
+        return 0;
+
+    capacity = table->capacity ? table->capacity * 2 : 64;
+    fields[0] = &table->sessions;
+    fields[1] = &table->channels;
+    fields[2] = &table->flags;
+    fields[3] = &table->positions;
+
+    for (i = 0; i < 4; i++)
+    {
+        arrays[i] = (uint32_t*)realloc(*fields[i], capacity * sizeof(uint32_t));
+
+        if (!arrays[i])
+            return 1;
+
+        *fields[i] = arrays[i];
+    }
+
+    table->capacity = capacity;
+
+    return 0;
+}
+
+static void user_table_free_members(mumble_user_table_t* table)
+{
+    size_t i;
+
+    for (i = 0; i < table->members.capacity; i++)
+    {
+        if (table->members.used[i])
+        {
+            mumble_channel_members_t* members =
+                (mumble_channel_members_t*)table->members.values[i];
+
+            free(members->sessions);
+            free(members);
+        }
+    }
+}
+
+int mumble_user_table_init(mumble_user_table_t* table)
+{
+    if (!table)
+        return 1;
+
+    table->sessions = NULL;
+    table->channels = NULL;
+    table->flags = NULL;
+    table->positions = NULL;
+    table->size = 0;
+    table->capacity = 0;
+
+    if (mumble_map_init(&table->rows) != 0)
+        return 1;
+
+    if (mumble_map_init(&table->members) != 0)
+    {
+        mumble_map_free(&table->rows);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+void mumble_user_table_free(mumble_user_table_t* table)
+{
+    if (!table)
+        return;
+
+    user_table_free_members(table);
+
+    free(table->sessions);
+    free(table->channels);
+    free(table->flags);
+    free(table->positions);
+    mumble_map_free(&table->rows);
+    mumble_map_free(&table->members);
+
+    table->sessions = table->channels = table->flags = table->positions = NULL;
+    table->size = table->capacity = 0;
+}
+
+void mumble_user_table_clear(mumble_user_table_t* table)
+{
+    user_table_free_members(table);
+    mumble_map_clear(&table->members);
+    mumble_map_clear(&table->rows);
+
+    table->size = 0;
+}
+
+int mumble_user_table_update(mumble_user_table_t* table, uint32_t session,
+                             uint32_t channel, uint32_t flags)
+{
+    uintptr_t row;
+
+    if (mumble_map_get(&table->rows, session, &row))
+    {
+        table->flags[row] = flags;
+
+        if (table->channels[row] == channel)
+            return 0;
+
+        user_table_leave(table, row);
+        table->channels[row] = channel;
+
+        return user_table_join(table, row);
+    }
+
+    if (user_table_reserve(table) != 0)
+        return 1;
+
+    row = table->size;
+
+    if (mumble_map_set(&table->rows, session, row) != 0)
+        return 1;
+
+    table->sessions[row] = session;
+    table->channels[row] = channel;
+    table->flags[row] = flags;
+    table->size++;
+
+    return user_table_join(table, row);
+}
+
+int mumble_user_table_remove(mumble_user_table_t* table, uint32_t session)
+{
+    uintptr_t row;
+    size_t last;
+
+    if (!mumble_map_get(&table->rows, session, &row))
+        return 0;
+
+    user_table_leave(table, row);
+    mumble_map_remove(&table->rows, session);
+
+    /* Move the last row into the hole. */
+    last = --table->size;
+
+    if (row != last)
+    {
+        table->sessions[row] = table->sessions[last];
+        table->channels[row] = table->channels[last];
+        table->flags[row] = table->flags[last];
+        table->positions[row] = table->positions[last];
+
+        mumble_map_set(&table->rows, table->sessions[row], row);
+    }
+
+    return 1;
+}
+
+void mumble_user_table_remove_channel(mumble_user_table_t* table,
+                                      uint32_t channel)
+{
+    user_table_drop_members(table, channel);
+}
+
+const uint32_t* mumble_user_table_channel_sessions(
+    const mumble_user_table_t* table, uint32_t channel, size_t* count)
+{
+    uintptr_t value;
+    const mumble_channel_members_t* members;
+
+    if (!mumble_map_get(&table->members, channel, &value) ||
+        (members = (const mumble_channel_members_t*)value)->size == 0)
+    {
+        *count = 0;
+
+        return NULL;
+    }
+
+    *count = members->size;
+
+    return members->sessions;
+}
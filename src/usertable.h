@@ -0,0 +1,157 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file usertable.h
+ * @brief Compact structure-of-arrays view of the users on a server.
+ *
+ * The user table mirrors the session, channel and flags of every
+ * `mumble_user_t` in dense parallel arrays, and keeps a list of member
+ * sessions for each channel. Queries over all users, or over the members of
+ * a channel, scan contiguous memory instead of chasing list pointers.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "map.h"
+
+#pragma once
+#ifndef MUMBLE_USERTABLE_H
+#define MUMBLE_USERTABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The member sessions of a single channel.
+ */
+typedef struct mumble_channel_members_t
+{
+    /** Pointer to the member sessions. */
+    uint32_t* sessions;
+    /** The number of members. */
+    size_t size;
+    /** The number of members there is room for. */
+    size_t capacity;
+} mumble_channel_members_t;
+
+/**
+ * The user table structure.
+ *
+ * Each user occupies the same row in `sessions`, `channels`, `flags` and
+ * `positions`. Rows are kept dense by moving the last row into the hole when
+ * a user is removed.
+ */
+typedef struct mumble_user_table_t
+{
+    /** The session id of each user. */
+    uint32_t* sessions;
+    /** The channel id of each user. */
+    uint32_t* channels;
+    /** The `mumble_user_flags_t` of each user. */
+    uint32_t* flags;
+    /** The index of each user in its channels member list. */
+    uint32_t* positions;
+    /** The number of users. */
+    size_t size;
+    /** The number of users there is room for. */
+    size_t capacity;
+    /** Map of session ids to rows. */
+    mumble_map_t rows;
+    /** Map of channel ids to `mumble_channel_members_t` pointers. */
+    mumble_map_t members;
+} mumble_user_table_t;
+
+/**
+ * Initialize a user table.
+ *
+ * @param[in] table a pointer to memory space to initialize.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_user_table_init(mumble_user_table_t* table);
+
+/**
+ * Free the memory used by a user table.
+ *
+ * @param[in] table a pointer to the table.
+ */
+void mumble_user_table_free(mumble_user_table_t* table);
+
+/**
+ * Remove all users from a table.
+ *
+ * @param[in] table a pointer to the table.
+ */
+void mumble_user_table_clear(mumble_user_table_t* table);
+
+/**
+ * Insert or update the row of a user.
+ *
+ * @param[in] table   a pointer to the table.
+ * @param[in] session the users session id.
+ * @param[in] channel the users channel id.
+ * @param[in] flags   the users flags.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+int mumble_user_table_update(mumble_user_table_t* table, uint32_t session,
+                             uint32_t channel, uint32_t flags);
+
+/**
+ * Remove the row of a user.
+ *
+ * @param[in] table   a pointer to the table.
+ * @param[in] session the users session id.
+ *
+ * @returns one if the user was removed, zero if it wasn't found.
+ */
+int mumble_user_table_remove(mumble_user_table_t* table, uint32_t session);
+
+/**
+ * Free the member list of a channel that was removed.
+ *
+ * The rows of users that are still in the channel are kept, and are moved
+ * out of it by their next update.
+ *
+ * @param[in] table   a pointer to the table.
+ * @param[in] channel the channel id.
+ */
+void mumble_user_table_remove_channel(mumble_user_table_t* table,
+                                      uint32_t channel);
+
+/**
+ * Get the member sessions of a channel.
+ *
+ * @param[in]  table   a pointer to the table.
+ * @param[in]  channel the channel id.
+ * @param[out] count   a pointer to store the number of members in.
+ *
+ * @returns a pointer to `count` session ids, or NULL if the channel is empty.
+ *   The pointer is valid until the table is next modified.
+ */
+const uint32_t* mumble_user_table_channel_sessions(
+    const mumble_user_table_t* table, uint32_t channel, size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_USERTABLE_H */
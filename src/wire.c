@@ -0,0 +1,487 @@
+#include <string.h>
+
+#include "wire.h"
+
+/**
+ * Initialize a reader over a packet body.
+ */
+#define WIRE_READER(r, body, length)                                           \
+    mumble_wire_reader_t r = { (body), (body) + (length) }
+
+/**
+ * Read a varint field value into a 32-bit integer and mark it as present.
+ */
+#define WIRE_READ_UINT32(reader, type, has, value)                             \
+    do                                                                         \
+    {                                                                          \
+        uint64_t v;                                                            \
+        if ((type) != MUMBLE_WIRE_VARINT ||                                    \
+            mumble_wire_read_varint((reader), &v) != 0)                        \
+            return 1;                                                          \
+        (value) = (uint32_t)v;                                                 \
+        (has) = 1;                                                             \
+    } while (0)
+
+/**
+ * Read a length-delimited field value into a slice.
+ */
+#define WIRE_READ_SLICE(reader, type, slice)                                   \
+    do                                                                         \
+    {                                                                          \
+        if ((type) != MUMBLE_WIRE_LENGTH_DELIMITED ||                          \
+            mumble_wire_read_slice((reader), &(slice)) != 0)                   \
+            return 1;                                                          \
+    } while (0)
+
+int mumble_wire_read_varint(mumble_wire_reader_t* reader, uint64_t* value)
+{
+    int shift;
+    uint64_t result = 0;
+
+    for (shift = 0; shift < 64; shift += 7)
+    {
+        uint8_t byte;
+
+        if (reader->ptr >= reader->end)
+            return 1;
+
+        byte = *reader->ptr++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80))
+        {
+            *value = result;
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int mumble_wire_read_key(mumble_wire_reader_t* reader, uint32_t* field,
+                         uint32_t* type)
+{
+    uint64_t key;
+
+    if (mumble_wire_read_varint(reader, &key) != 0 || key >> 32)
+        return 1;
+
+    *field = (uint32_t)(key >> 3);
+    *type = (uint32_t)(key & 7);
+
+    return (*field == 0);
+}
+
+int mumble_wire_read_slice(mumble_wire_reader_t* reader,
+                           mumble_wire_slice_t* slice)
+{
+    uint64_t length;
+
+    if (mumble_wire_read_varint(reader, &length) != 0 ||
+        length > (uint64_t)(reader->end - reader->ptr))
+        return 1;
+
+    slice->data = reader->ptr;
+    slice->length = (size_t)length;
+    reader->ptr += length;
+
+    return 0;
+}
+
+int mumble_wire_skip(mumble_wire_reader_t* reader, uint32_t type)
+{
+    uint64_t value;
+    mumble_wire_slice_t slice;
+
+    switch (type)
+    {
+        case MUMBLE_WIRE_VARINT:
+            return mumble_wire_read_varint(reader, &value);
+        case MUMBLE_WIRE_LENGTH_DELIMITED:
+            return mumble_wire_read_slice(reader, &slice);
+        case MUMBLE_WIRE_FIXED64:
+            if (reader->end - reader->ptr < 8)
+                return 1;
+
+            reader->ptr += 8;
+
+            return 0;
+        case MUMBLE_WIRE_FIXED32:
+            if (reader->end - reader->ptr < 4)
+                return 1;
+
+            reader->ptr += 4;
+
+            return 0;
+        default:
+            /* Groups are deprecated and never used by the mumble protocol. */
+            return 1;
+    }
+}
+
+/**
+ * Read a fixed32 field value as a float.
+ */
+static int wire_read_float(mumble_wire_reader_t* reader, uint32_t type,
+                           float* value)
+{
+    uint32_t bits;
+
+    if (type != MUMBLE_WIRE_FIXED32 || reader->end - reader->ptr < 4)
+        return 1;
+
+    /* The wire format is little-endian. */
+    bits = (uint32_t)reader->ptr[0] | (uint32_t)reader->ptr[1] << 8 |
+           (uint32_t)reader->ptr[2] << 16 | (uint32_t)reader->ptr[3] << 24;
+    memcpy(value, &bits, sizeof(float));
+    reader->ptr += 4;
+
+    return 0;
+}
+
+/**
+ * Count the values of a repeated varint field occurrence.
+ */
+static int wire_count_repeated(mumble_wire_reader_t* reader, uint32_t type,
+                               size_t* count)
+{
+    uint64_t value;
+    mumble_wire_slice_t slice;
+    mumble_wire_reader_t packed;
+
+    if (type == MUMBLE_WIRE_VARINT)
+    {
+        if (mumble_wire_read_varint(reader, &value) != 0)
+            return 1;
+
+        (*count)++;
+
+        return 0;
+    }
+
+    if (type != MUMBLE_WIRE_LENGTH_DELIMITED ||
+        mumble_wire_read_slice(reader, &slice) != 0)
+        return 1;
+
+    packed.ptr = slice.data;
+    packed.end = slice.data + slice.length;
+
+    while (packed.ptr < packed.end)
+    {
+        if (mumble_wire_read_varint(&packed, &value) != 0)
+            return 1;
+
+        (*count)++;
+    }
+
+    return 0;
+}
+
+int mumble_wire_parse_user_state(const uint8_t* body, size_t length,
+                                 mumble_wire_user_state_t* message)
+{
+    uint32_t field, type, flag;
+    WIRE_READER(reader, body, length);
+
+    memset(message, 0, sizeof(*message));
+
+    while (reader.ptr < reader.end)
+    {
+        if (mumble_wire_read_key(&reader, &field, &type) != 0)
+            return 1;
+
+        switch (field)
+        {
+            case 1:
+                WIRE_READ_UINT32(&reader, type, message->has_session,
+                                 message->session);
+                break;
+            case 2:
+                WIRE_READ_UINT32(&reader, type, message->has_actor,
+                                 message->actor);
+                break;
+            case 3:
+                WIRE_READ_SLICE(&reader, type, message->name);
+                break;
+            case 4:
+                WIRE_READ_UINT32(&reader, type, message->has_user_id,
+                                 message->user_id);
+                break;
+            case 5:
+                WIRE_READ_UINT32(&reader, type, message->has_channel_id,
+                                 message->channel_id);
+                break;
+            case 6:
+                WIRE_READ_UINT32(&reader, type, message->has_mute, flag);
+                message->mute = (flag != 0);
+                break;
+            case 7:
+                WIRE_READ_UINT32(&reader, type, message->has_deaf, flag);
+                message->deaf = (flag != 0);
+                break;
+            case 8:
+                WIRE_READ_UINT32(&reader, type, message->has_suppress, flag);
+                message->suppress = (flag != 0);
+                break;
+            case 9:
+                WIRE_READ_UINT32(&reader, type, message->has_self_mute, flag);
+                message->self_mute = (flag != 0);
+                break;
+            case 10:
+                WIRE_READ_UINT32(&reader, type, message->has_self_deaf, flag);
+                message->self_deaf = (flag != 0);
+                break;
+            case 11:
+                WIRE_READ_SLICE(&reader, type, message->texture);
+                break;
+            case 12:
+                WIRE_READ_SLICE(&reader, type, message->plugin_context);
+                break;
+            case 13:
+                WIRE_READ_SLICE(&reader, type, message->plugin_identity);
+                break;
+            case 14:
+                WIRE_READ_SLICE(&reader, type, message->comment);
+                break;
+            case 15:
+                WIRE_READ_SLICE(&reader, type, message->hash);
+                break;
+            case 16:
+                WIRE_READ_SLICE(&reader, type, message->comment_hash);
+                break;
+            case 17:
+                WIRE_READ_SLICE(&reader, type, message->texture_hash);
+                break;
+            case 18:
+                WIRE_READ_UINT32(&reader, type, message->has_priority_speaker,
+                                 flag);
+                message->priority_speaker = (flag != 0);
+                break;
+            case 19:
+                WIRE_READ_UINT32(&reader, type, message->has_recording, flag);
+                message->recording = (flag != 0);
+                break;
+            default:
+                if (mumble_wire_skip(&reader, type) != 0)
+                    return 1;
+        }
+    }
+
+    return 0;
+}
+
+int mumble_wire_parse_channel_state(const uint8_t* body, size_t length,
+                                    mumble_wire_channel_state_t* message)
+{
+    uint32_t field, type, value;
+    WIRE_READER(reader, body, length);
+
+    memset(message, 0, sizeof(*message));
+
+    while (reader.ptr < reader.end)
+    {
+        if (mumble_wire_read_key(&reader, &field, &type) != 0)
+            return 1;
+
+        switch (field)
+        {
+            case 1:
+                WIRE_READ_UINT32(&reader, type, message->has_channel_id,
+                                 message->channel_id);
+                break;
+            case 2:
+                WIRE_READ_UINT32(&reader, type, message->has_parent,
+                                 message->parent);
+                break;
+            case 3:
+                WIRE_READ_SLICE(&reader, type, message->name);
+                break;
+            case 5:
+                WIRE_READ_SLICE(&reader, type, message->description);
+                break;
+            case 8:
+                WIRE_READ_UINT32(&reader, type, message->has_temporary, value);
+                message->temporary = (value != 0);
+                break;
+            case 9:
+                /* Negative int32 values are sign-extended to 64 bits. */
+                WIRE_READ_UINT32(&reader, type, message->has_position, value);
+                message->position = (int32_t)value;
+                break;
+            case 10:
+                WIRE_READ_SLICE(&reader, type, message->description_hash);
+                break;
+            default:
+                /* Channel links (4, 6 and 7) aren't tracked. */
+                if (mumble_wire_skip(&reader, type) != 0)
+                    return 1;
+        }
+    }
+
+    return 0;
+}
+
+int mumble_wire_parse_text_message(const uint8_t* body, size_t length,
+                                   mumble_wire_text_message_t* message)
+{
+    uint32_t field, type;
+    WIRE_READER(reader, body, length);
+
+    memset(message, 0, sizeof(*message));
+
+    while (reader.ptr < reader.end)
+    {
+        if (mumble_wire_read_key(&reader, &field, &type) != 0)
+            return 1;
+
+        switch (field)
+        {
+            case 1:
+                WIRE_READ_UINT32(&reader, type, message->has_actor,
+                                 message->actor);
+                break;
+            case 2:
+                if (wire_count_repeated(&reader, type,
+                                        &message->num_sessions) != 0)
+                    return 1;
+                break;
+            case 3:
+                if (wire_count_repeated(&reader, type,
+                                        &message->num_channels) != 0)
+                    return 1;
+                break;
+            case 4:
+                if (wire_count_repeated(&reader, type, &message->num_trees) !=
+                    0)
+                    return 1;
+                break;
+            case 5:
+                WIRE_READ_SLICE(&reader, type, message->message);
+                break;
+            default:
+                if (mumble_wire_skip(&reader, type) != 0)
+                    return 1;
+        }
+    }
+
+    /* The message field is required. */
+    return (message->message.data == NULL);
+}
+
+int mumble_wire_parse_ping(const uint8_t* body, size_t length,
+                           mumble_wire_ping_t* message)
+{
+    int has;
+    uint64_t value;
+    uint32_t field, type;
+    WIRE_READER(reader, body, length);
+
+    memset(message, 0, sizeof(*message));
+
+    while (reader.ptr < reader.end)
+    {
+        if (mumble_wire_read_key(&reader, &field, &type) != 0)
+            return 1;
+
+        switch (field)
+        {
+            case 1:
+                if (type != MUMBLE_WIRE_VARINT ||
+                    mumble_wire_read_varint(&reader, &value) != 0)
+                    return 1;
+
+                message->timestamp = value;
+                message->has_timestamp = 1;
+                break;
+            case 2:
+                WIRE_READ_UINT32(&reader, type, has, message->good);
+                break;
+            case 3:
+                WIRE_READ_UINT32(&reader, type, has, message->late);
+                break;
+            case 4:
+                WIRE_READ_UINT32(&reader, type, has, message->lost);
+                break;
+            case 5:
+                WIRE_READ_UINT32(&reader, type, has, message->resync);
+                break;
+            case 6:
+                WIRE_READ_UINT32(&reader, type, has, message->udp_packets);
+                break;
+            case 7:
+                WIRE_READ_UINT32(&reader, type, has, message->tcp_packets);
+                break;
+            case 8:
+                if (wire_read_float(&reader, type, &message->udp_ping_avg))
+                    return 1;
+                break;
+            case 9:
+                if (wire_read_float(&reader, type, &message->udp_ping_var))
+                    return 1;
+                break;
+            case 10:
+                if (wire_read_float(&reader, type, &message->tcp_ping_avg))
+                    return 1;
+                break;
+            case 11:
+                if (wire_read_float(&reader, type, &message->tcp_ping_var))
+                    return 1;
+                break;
+            default:
+                if (mumble_wire_skip(&reader, type) != 0)
+                    return 1;
+        }
+    }
+
+    (void)has;
+
+    return 0;
+}
+
+size_t mumble_wire_collect_uint32(const uint8_t* body, size_t length,
+                                  uint32_t field, uint32_t* values, size_t max)
+{
+    size_t count = 0;
+    uint64_t value;
+    uint32_t key_field, type;
+    mumble_wire_slice_t slice;
+    mumble_wire_reader_t packed;
+    WIRE_READER(reader, body, length);
+
+    while (reader.ptr < reader.end && count < max)
+    {
+        if (mumble_wire_read_key(&reader, &key_field, &type) != 0)
+            break;
+
+        if (key_field != field)
+        {
+            if (mumble_wire_skip(&reader, type) != 0)
+                break;
+
+            continue;
+        }
+
+        if (type == MUMBLE_WIRE_VARINT)
+        {
+            if (mumble_wire_read_varint(&reader, &value) != 0)
+                break;
+
+            values[count++] = (uint32_t)value;
+        }
+        else if (type == MUMBLE_WIRE_LENGTH_DELIMITED &&
+                 mumble_wire_read_slice(&reader, &slice) == 0)
+        {
+            packed.ptr = slice.data;
+            packed.end = slice.data + slice.length;
+
+            while (packed.ptr < packed.end && count < max &&
+                   mumble_wire_read_varint(&packed, &value) == 0)
+                values[count++] = (uint32_t)value;
+        }
+        else
+            break;
+    }
+
+    return count;
+}
@@ -0,0 +1,257 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file wire.h
+ * @brief Zero-copy protobuf wire format scanner for the hot packet types.
+ *
+ * UserState, ChannelState, TextMessage and Ping packets make up most of the
+ * traffic from a server. Instead of unpacking them with protobuf-c, which
+ * allocates and copies every field, these scanners make a single pass over
+ * the packet body, decode the scalar fields the library uses and return
+ * slices pointing into the body for strings and bytes. Large fields such as
+ * textures are never copied unless the caller asks for them.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#pragma once
+#ifndef MUMBLE_WIRE_H
+#define MUMBLE_WIRE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * A slice of a packet body.
+ *
+ * `data` is NULL if the field wasn't present. Slices are not null-terminated.
+ */
+typedef struct mumble_wire_slice_t
+{
+    /** Pointer to the first byte of the field value. */
+    const uint8_t* data;
+    /** The length of the field value, in bytes. */
+    size_t length;
+} mumble_wire_slice_t;
+
+/**
+ * Protobuf wire types.
+ */
+typedef enum mumble_wire_type_t
+{
+    MUMBLE_WIRE_VARINT           = 0,
+    MUMBLE_WIRE_FIXED64          = 1,
+    MUMBLE_WIRE_LENGTH_DELIMITED = 2,
+    MUMBLE_WIRE_FIXED32          = 5
+} mumble_wire_type_t;
+
+/**
+ * A cursor over a packet body.
+ */
+typedef struct mumble_wire_reader_t
+{
+    /** The current position. */
+    const uint8_t* ptr;
+    /** The end of the body. */
+    const uint8_t* end;
+} mumble_wire_reader_t;
+
+/**
+ * The fields of a UserState message used by the library.
+ */
+typedef struct mumble_wire_user_state_t
+{
+    int has_session;
+    uint32_t session;
+    int has_actor;
+    uint32_t actor;
+    int has_user_id;
+    uint32_t user_id;
+    int has_channel_id;
+    uint32_t channel_id;
+    int has_mute;
+    int mute;
+    int has_deaf;
+    int deaf;
+    int has_suppress;
+    int suppress;
+    int has_self_mute;
+    int self_mute;
+    int has_self_deaf;
+    int self_deaf;
+    int has_priority_speaker;
+    int priority_speaker;
+    int has_recording;
+    int recording;
+    mumble_wire_slice_t name;
+    mumble_wire_slice_t texture;
+    mumble_wire_slice_t plugin_context;
+    mumble_wire_slice_t plugin_identity;
+    mumble_wire_slice_t comment;
+    mumble_wire_slice_t hash;
+    mumble_wire_slice_t comment_hash;
+    mumble_wire_slice_t texture_hash;
+} mumble_wire_user_state_t;
+
+/**
+ * The fields of a ChannelState message used by the library.
+ */
+typedef struct mumble_wire_channel_state_t
+{
+    int has_channel_id;
+    uint32_t channel_id;
+    int has_parent;
+    uint32_t parent;
+    int has_temporary;
+    int temporary;
+    int has_position;
+    int32_t position;
+    mumble_wire_slice_t name;
+    mumble_wire_slice_t description;
+    mumble_wire_slice_t description_hash;
+} mumble_wire_channel_state_t;
+
+/**
+ * The fields of a TextMessage message.
+ *
+ * The repeated target fields are only counted. Use
+ * `mumble_wire_collect_uint32` to decode them.
+ */
+typedef struct mumble_wire_text_message_t
+{
+    int has_actor;
+    uint32_t actor;
+    size_t num_sessions;
+    size_t num_channels;
+    size_t num_trees;
+    mumble_wire_slice_t message;
+} mumble_wire_text_message_t;
+
+/**
+ * The fields of a Ping message.
+ */
+typedef struct mumble_wire_ping_t
+{
+    int has_timestamp;
+    uint64_t timestamp;
+    uint32_t good;
+    uint32_t late;
+    uint32_t lost;
+    uint32_t resync;
+    uint32_t udp_packets;
+    uint32_t tcp_packets;
+    float udp_ping_avg;
+    float udp_ping_var;
+    float tcp_ping_avg;
+    float tcp_ping_var;
+} mumble_wire_ping_t;
+
+/**
+ * Read a varint.
+ *
+ * @param[in]  reader a pointer to the reader.
+ * @param[out] value  a pointer to store the value in.
+ *
+ * @returns zero on success, non-zero if the varint is truncated or too long.
+ */
+int mumble_wire_read_varint(mumble_wire_reader_t* reader, uint64_t* value);
+
+/**
+ * Read the key of the next field.
+ *
+ * @param[in]  reader a pointer to the reader.
+ * @param[out] field  a pointer to store the field number in.
+ * @param[out] type   a pointer to store the wire type in.
+ *
+ * @returns zero on success, non-zero if malformed.
+ */
+int mumble_wire_read_key(mumble_wire_reader_t* reader, uint32_t* field,
+                         uint32_t* type);
+
+/**
+ * Read the value of a length-delimited field as a slice.
+ *
+ * @returns zero on success, non-zero if malformed.
+ */
+int mumble_wire_read_slice(mumble_wire_reader_t* reader,
+                           mumble_wire_slice_t* slice);
+
+/**
+ * Skip the value of a field.
+ *
+ * @param[in] reader a pointer to the reader.
+ * @param[in] type   the wire type of the field.
+ *
+ * @returns zero on success, non-zero if malformed.
+ */
+int mumble_wire_skip(mumble_wire_reader_t* reader, uint32_t type);
+
+/**
+ * Scan a UserState packet body.
+ *
+ * @returns zero on success, non-zero if malformed.
+ */
+int mumble_wire_parse_user_state(const uint8_t* body, size_t length,
+                                 mumble_wire_user_state_t* message);
+
+/**
+ * Scan a ChannelState packet body.
+ *
+ * @returns zero on success, non-zero if malformed.
+ */
+int mumble_wire_parse_channel_state(const uint8_t* body, size_t length,
+                                    mumble_wire_channel_state_t* message);
+
+/**
+ * Scan a TextMessage packet body.
+ *
+ * @returns zero on success, non-zero if malformed.
+ */
+int mumble_wire_parse_text_message(const uint8_t* body, size_t length,
+                                   mumble_wire_text_message_t* message);
+
+/**
+ * Scan a Ping packet body.
+ *
+ * @returns zero on success, non-zero if malformed.
+ */
+int mumble_wire_parse_ping(const uint8_t* body, size_t length,
+                           mumble_wire_ping_t* message);
+
+/**
+ * Decode all values of a repeated uint32 field, packed or not.
+ *
+ * @param[in]  body   the packet body.
+ * @param[in]  length the length of the packet body.
+ * @param[in]  field  the field number.
+ * @param[out] values an array to store the values in.
+ * @param[in]  max    the number of values `values` can hold.
+ *
+ * @returns the number of values stored.
+ */
+size_t mumble_wire_collect_uint32(const uint8_t* body, size_t length,
+                                  uint32_t field, uint32_t* values, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MUMBLE_WIRE_H */
@@ -0,0 +1,132 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <mumble/mumble.h>
+#include "blob.h"
+#include "test.h"
+
+/**
+ * The size of the blob that is stored, about that of a user texture.
+ */
+#define MUMBLE_TEST_BLOB_SIZE (1024 * 64)
+
+/**
+ * Get the path of the store file of a blob.
+ */
+static void mumble_test_path(const char* directory, const uint8_t* hash,
+                             char* path, size_t size)
+{
+    int i, n = snprintf(path, size, "%s/", directory);
+
+    for (i = 0; i < MUMBLE_BLOB_HASH_SIZE; i++)
+        n += snprintf(path + n, size - (size_t)n, "%02x", hash[i]);
+}
+
+/**
+ * Store a blob, then change a byte of its file, and check that the changed
+ * file is never mapped back in under the blob's hash.
+ */
+static void mumble_test_store(const char* directory)
+{
+    int fd;
+    char path[4096];
+    uint8_t hash[MUMBLE_BLOB_HASH_SIZE];
+    static uint8_t data[MUMBLE_TEST_BLOB_SIZE];
+    mumble_blob_cache_t cache;
+    mumble_blob_t* blob;
+
+    memset(data, 'x', sizeof data);
+    MUMBLE_TEST_CHECK(mumble_blob_cache_init(&cache, directory) == 0);
+
+    if ((blob = mumble_blob_cache_put(&cache, data, sizeof data)) == NULL)
+    {
+        MUMBLE_TEST_CHECK(!"the blob can be added");
+        mumble_blob_cache_free(&cache);
+
+        return;
+    }
+
+    memcpy(hash, blob->hash, sizeof hash);
+    mumble_test_path(directory, hash, path, sizeof path);
+    MUMBLE_TEST_CHECK(access(path, R_OK) == 0);
+
+    /* With a store, released blobs are dropped from memory. */
+    mumble_blob_release(blob);
+    MUMBLE_TEST_CHECK(cache.num_blobs == 0);
+
+    blob = mumble_blob_cache_get(&cache, hash, sizeof hash);
+    MUMBLE_TEST_CHECK(blob != NULL && blob->map != NULL);
+    MUMBLE_TEST_CHECK(blob != NULL && blob->size == sizeof data &&
+                      memcmp(blob->data, data, sizeof data) == 0);
+    mumble_blob_release(blob);
+
+    /* A file that no longer matches its hash is removed. */
+    if ((fd = open(path, O_WRONLY)) >= 0)
+    {
+        MUMBLE_TEST_CHECK(pwrite(fd, "y", 1, sizeof data / 2) == 1);
+        close(fd);
+    }
+
+    MUMBLE_TEST_CHECK(mumble_blob_cache_get(&cache, hash, sizeof hash) ==
+                      NULL);
+    MUMBLE_TEST_CHECK(access(path, F_OK) != 0);
+    MUMBLE_TEST_CHECK(cache.num_blobs == 0);
+
+    /* The data can be added again once it has been requested. */
+    blob = mumble_blob_cache_put(&cache, data, sizeof data);
+    MUMBLE_TEST_CHECK(blob != NULL);
+    MUMBLE_TEST_CHECK(access(path, R_OK) == 0);
+    mumble_blob_release(blob);
+
+    /* So is a file that was cut short. */
+    MUMBLE_TEST_CHECK(truncate(path, sizeof data / 2) == 0);
+    MUMBLE_TEST_CHECK(mumble_blob_cache_get(&cache, hash, sizeof hash) ==
+                      NULL);
+    MUMBLE_TEST_CHECK(access(path, F_OK) != 0);
+
+    mumble_blob_cache_free(&cache);
+}
+
+int main(void)
+{
+    char directory[] = "/tmp/libmumble-blob-XXXXXX";
+
+    /* Corrupt files are reported as warnings, which are expected here. */
+    if (!getenv("LIBMUMBLE_LOG"))
+        mumble_set_log_level(NULL, 1);
+
+    if (!mkdtemp(directory))
+    {
+        fprintf(stderr, "Could not create a directory for the store\n");
+
+        return 1;
+    }
+
+    mumble_test_store(directory);
+
+    if (rmdir(directory) != 0)
+        MUMBLE_TEST_CHECK(!"the store is left empty");
+
+    return MUMBLE_TEST_STATUS;
+}
@@ -0,0 +1,135 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include "Mumble.pb-c.h"
+#include "iserver.h"
+#include "protocol.h"
+#include "fixture.h"
+#include "test.h"
+
+/**
+ * The number of channels to create and remove.
+ */
+static const uint32_t kMumbleTestChannels = 1000;
+
+/**
+ * Feed a packet to the server, as if it had just been received.
+ */
+static void mumble_test_receive(struct mumble_server_t* server,
+                                mumble_packet_type_t type, const void* message)
+{
+    MUMBLE_TEST_CHECK(mumble_packet_pack(&server->rbuffer, type, message) != 0);
+    MUMBLE_TEST_CHECK(mumble_server_read_packet(server) == 1);
+}
+
+static void mumble_test_channel_state(struct mumble_server_t* server,
+                                      uint32_t id)
+{
+    MumbleProto__ChannelState state = MUMBLE_PROTO__CHANNEL_STATE__INIT;
+
+    state.has_channel_id = 1;
+    state.channel_id = id;
+    state.has_parent = id != 0;
+    state.parent = 0;
+    state.name = (char*)"channel";
+
+    mumble_test_receive(server, MUMBLE_PACKET_CHANNEL_STATE, &state);
+}
+
+static void mumble_test_channel_remove(struct mumble_server_t* server,
+                                       uint32_t id)
+{
+    MumbleProto__ChannelRemove remove = MUMBLE_PROTO__CHANNEL_REMOVE__INIT;
+
+    remove.channel_id = id;
+
+    mumble_test_receive(server, MUMBLE_PACKET_CHANNEL_REMOVE, &remove);
+}
+
+static void mumble_test_user_state(struct mumble_server_t* server,
+                                   uint32_t session, uint32_t channel)
+{
+    MumbleProto__UserState state = MUMBLE_PROTO__USER_STATE__INIT;
+
+    state.has_session = 1;
+    state.session = session;
+    state.name = (char*)"user";
+    state.has_channel_id = 1;
+    state.channel_id = channel;
+
+    mumble_test_receive(server, MUMBLE_PACKET_USER_STATE, &state);
+}
+
+int main(void)
+{
+    uint32_t id;
+    size_t count, members = 0;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        fprintf(stderr, "Could not set up the fixture\n");
+        mumble_bench_fixture_free(&fixture);
+
+        return 1;
+    }
+
+    server = fixture.server;
+    mumble_test_channel_state(server, 0);
+
+    /* One user moves into each channel and back out before it is removed,
+     * the other is still in it when it is. */
+    for (id = 1; id <= kMumbleTestChannels; id++)
+    {
+        mumble_test_channel_state(server, id);
+        mumble_test_user_state(server, 1, id);
+        mumble_test_user_state(server, 2, id);
+        mumble_test_user_state(server, 1, 0);
+        mumble_test_channel_remove(server, id);
+
+        if (id == 1)
+            members = server->user_table.members.size;
+
+        MUMBLE_TEST_CHECK(server->user_table.members.size == members);
+    }
+
+    /* Only the root channel has a member list left. */
+    MUMBLE_TEST_CHECK(members == 1);
+    MUMBLE_TEST_CHECK(mumble_user_table_channel_sessions(
+                          &server->user_table, 0, &count) != NULL);
+    MUMBLE_TEST_CHECK(count == 1);
+
+    /* A new channel with the id of a removed one doesn't get its members. */
+    mumble_test_channel_state(server, kMumbleTestChannels);
+    mumble_test_user_state(server, 1, kMumbleTestChannels);
+    mumble_test_user_state(server, 2, 0);
+    MUMBLE_TEST_CHECK(mumble_user_table_channel_sessions(
+                          &server->user_table, kMumbleTestChannels,
+                          &count) != NULL);
+    MUMBLE_TEST_CHECK(count == 1);
+    MUMBLE_TEST_CHECK(mumble_user_table_channel_sessions(
+                          &server->user_table, 0, &count) != NULL);
+    MUMBLE_TEST_CHECK(count == 1);
+
+    mumble_bench_fixture_free(&fixture);
+
+    return MUMBLE_TEST_STATUS;
+}
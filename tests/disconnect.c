@@ -0,0 +1,222 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <signal.h>
+#include <unistd.h>
+#include <openssl/ssl.h>
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include "iserver.h"
+#include "internal.h"
+#include "clock.h"
+#include "fixture.h"
+#include "test.h"
+
+/**
+ * The number of voice packets to queue before disconnecting.
+ */
+static const int kMumbleTestPackets = 16;
+
+/**
+ * Fail a write on a connection whose peer went away, and check that the
+ * connection is dropped rather than retried on every write event.
+ */
+static void mumble_test_write_error(void)
+{
+    int lane;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+    struct ev_loop* loop;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        MUMBLE_TEST_CHECK(!"the fixture can be set up");
+        mumble_bench_fixture_free(&fixture);
+
+        return;
+    }
+
+    server = fixture.server;
+    loop = server->client->loop;
+
+    /* The handshake is started by the first write, which fails. */
+    server->ssl = SSL_new(server->client->ssl_ctx);
+    MUMBLE_TEST_CHECK(server->ssl != NULL);
+    SSL_set_fd(server->ssl, server->fd);
+    SSL_set_connect_state(server->ssl);
+
+    close(fixture.fds[1]);
+    fixture.fds[0] = fixture.fds[1] = -1;
+
+    MUMBLE_TEST_CHECK(mumble_server_send_ping(server) == 1);
+    mumble_server_callback(loop, &server->watcher, EV_WRITE);
+
+    MUMBLE_TEST_CHECK(server->fd == -1);
+    MUMBLE_TEST_CHECK(server->inflight == NULL);
+    MUMBLE_TEST_CHECK(!ev_is_active(&server->watcher));
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        MUMBLE_TEST_CHECK(server->lanes[lane].count == 0);
+
+    mumble_bench_fixture_free(&fixture);
+}
+
+/**
+ * Close a connection that is waiting on the shaper and the keepalive, and
+ * check that nothing is left to fire on the closed connection.
+ */
+static void mumble_test_close(void)
+{
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+    struct ev_loop* loop;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        MUMBLE_TEST_CHECK(!"the fixture can be set up");
+        mumble_bench_fixture_free(&fixture);
+
+        return;
+    }
+
+    server = fixture.server;
+    loop = server->client->loop;
+
+    ev_timer_set(&server->shaper_timer, 10., 0.);
+    ev_timer_start(loop, &server->shaper_timer);
+    mumble_timer_start(&server->client->timers, &server->ping_timer, 10.);
+
+    mumble_server_close(server);
+    close(fixture.fds[1]);
+    fixture.fds[0] = fixture.fds[1] = -1;
+
+    MUMBLE_TEST_CHECK(server->fd == -1);
+    MUMBLE_TEST_CHECK(!ev_is_active(&server->shaper_timer));
+    MUMBLE_TEST_CHECK(!mumble_timer_is_active(&server->ping_timer));
+
+    mumble_bench_fixture_free(&fixture);
+}
+
+/**
+ * Let the keepalive go unanswered, and check that the connection is dropped
+ * after the allowed number of missed pings.
+ */
+static void mumble_test_missed_pings(void)
+{
+    unsigned int i;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        MUMBLE_TEST_CHECK(!"the fixture can be set up");
+        mumble_bench_fixture_free(&fixture);
+
+        return;
+    }
+
+    server = fixture.server;
+
+    /* Nothing has been received since the last ping. */
+    server->ping_sent = mumble_clock_us();
+    server->last_received = server->last_activity = server->ping_sent - 1;
+
+    for (i = 1; i < kMumblePingMaxMissed; i++)
+    {
+        mumble_server_ping(&server->ping_timer);
+
+        MUMBLE_TEST_CHECK(server->missed_pings == i);
+        MUMBLE_TEST_CHECK(server->fd != -1);
+        MUMBLE_TEST_CHECK(mumble_timer_is_active(&server->ping_timer));
+    }
+
+    mumble_server_ping(&server->ping_timer);
+
+    MUMBLE_TEST_CHECK(server->fd == -1);
+    MUMBLE_TEST_CHECK(!mumble_timer_is_active(&server->ping_timer));
+
+    close(fixture.fds[1]);
+    fixture.fds[0] = fixture.fds[1] = -1;
+
+    mumble_bench_fixture_free(&fixture);
+}
+
+int main(void)
+{
+    int i, lane;
+    uint8_t voice[32] = { 0 };
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+    struct mumble_server_t* servers[1];
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        fprintf(stderr, "Could not set up the fixture\n");
+        mumble_bench_fixture_free(&fixture);
+
+        return 1;
+    }
+
+    server = servers[0] = fixture.server;
+
+    MUMBLE_TEST_CHECK(mumble_server_send_ping(server) == 1);
+
+    for (i = 0; i < kMumbleTestPackets; i++)
+        MUMBLE_TEST_CHECK(mumble_server_send_voice(server, voice,
+                                                   sizeof voice) == 0);
+
+    /* Pretend the ping was partially written when the connection broke. */
+    server->inflight =
+        mumble_write_queue_pop(&server->lanes[MUMBLE_LANE_CONTROL]);
+    server->inflight_offset = 1;
+
+    mumble_server_disconnected(server);
+
+    /* The socket was closed along with the connection. */
+    close(fixture.fds[1]);
+    fixture.fds[0] = fixture.fds[1] = -1;
+
+    MUMBLE_TEST_CHECK(server->fd == -1);
+    MUMBLE_TEST_CHECK(server->inflight == NULL);
+    MUMBLE_TEST_CHECK(server->inflight_offset == 0);
+    MUMBLE_TEST_CHECK(server->scratch == NULL);
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        MUMBLE_TEST_CHECK(server->lanes[lane].count == 0);
+
+    /* Nothing is queued for the closed connection afterwards. */
+    MUMBLE_TEST_CHECK(mumble_server_send_ping(server) != 1);
+    MUMBLE_TEST_CHECK(mumble_server_send_voice(server, voice,
+                                               sizeof voice) != 0);
+    MUMBLE_TEST_CHECK(mumble_servers_send_voice(servers, 1, voice,
+                                                sizeof voice) == 0);
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        MUMBLE_TEST_CHECK(server->lanes[lane].count == 0);
+
+    mumble_bench_fixture_free(&fixture);
+
+    /* Writing to the closed socket must fail rather than kill the test. */
+    signal(SIGPIPE, SIG_IGN);
+    mumble_test_write_error();
+    mumble_test_close();
+    mumble_test_missed_pings();
+
+    return MUMBLE_TEST_STATUS;
+}
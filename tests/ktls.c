@@ -0,0 +1,500 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/*
+ * Connects to the test server twice, once with `enable_ktls` and once
+ * without, sends the same packets both times and checks that the server
+ * received the same bytes. With `enable_ktls` writes have to go through the
+ * kernel if this build and the kernel support it, and through SSL_write if
+ * not.
+ *
+ * Run with the path of the test server, which is started for each run.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <ev.h>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/pem.h>
+#include <openssl/x509.h>
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include "iserver.h"
+#include "test.h"
+
+/**
+ * The number of seconds a run, or waiting for the server, may take.
+ */
+static const double kMumbleTestTimeout = 10;
+
+/**
+ * The size of the text message that is too large to be coalesced.
+ */
+#define MUMBLE_TEST_LARGE_SIZE (1024 * 40)
+
+/**
+ * The number of small text messages and voice packets that are coalesced.
+ */
+static const int kMumbleTestSmallPackets = 8;
+
+/**
+ * The outcome of a single run.
+ */
+typedef struct mumble_test_run_t
+{
+    /** Non-zero once the server synchronized. */
+    int synchronized;
+    /** Non-zero if writes went through the kernel. */
+    int ktls_send;
+    /** The number of bytes that were queued, headers included. */
+    uint64_t bytes;
+} mumble_test_run_t;
+
+/**
+ * Create a self-signed certificate for the test server.
+ *
+ * @returns zero on success, non-zero otherwise.
+ */
+static int mumble_test_certificate(const char* cert_file, const char* key_file)
+{
+    int result = 1;
+    FILE* file;
+    X509* cert = NULL;
+    EVP_PKEY* key = NULL;
+    EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+
+    if (!ctx || EVP_PKEY_keygen_init(ctx) <= 0 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(ctx, NID_X9_62_prime256v1) <=
+            0 ||
+        EVP_PKEY_keygen(ctx, &key) <= 0 || (cert = X509_new()) == NULL)
+        goto done;
+
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 60 * 60);
+    X509_set_pubkey(cert, key);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC,
+                               (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+
+    if (!X509_sign(cert, key, EVP_sha256()))
+        goto done;
+
+    if ((file = fopen(cert_file, "w")) == NULL)
+        goto done;
+
+    result = !PEM_write_X509(file, cert);
+    fclose(file);
+
+    if (result || (file = fopen(key_file, "w")) == NULL)
+        goto done;
+
+    result = !PEM_write_PrivateKey(file, key, NULL, NULL, 0, NULL, NULL);
+    fclose(file);
+
+done:
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    EVP_PKEY_CTX_free(ctx);
+
+    return result;
+}
+
+/**
+ * Check whether the kernel lets TLS be attached to a TCP socket.
+ */
+static int mumble_test_kernel_tls(void)
+{
+    int result = 0;
+#ifdef TCP_ULP
+    int listener, client = -1, peer = -1;
+    struct sockaddr_in address;
+    socklen_t length = sizeof address;
+
+    memset(&address, 0, sizeof address);
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if ((listener = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        return 0;
+
+    /* The ULP can only be attached to a connected socket. */
+    if (bind(listener, (struct sockaddr*)&address, sizeof address) == 0 &&
+        listen(listener, 1) == 0 &&
+        getsockname(listener, (struct sockaddr*)&address, &length) == 0 &&
+        (client = socket(AF_INET, SOCK_STREAM, 0)) >= 0 &&
+        connect(client, (struct sockaddr*)&address, sizeof address) == 0 &&
+        (peer = accept(listener, NULL, NULL)) >= 0)
+        result = setsockopt(client, IPPROTO_TCP, TCP_ULP, "tls",
+                            sizeof "tls") == 0;
+
+    if (peer >= 0)
+        close(peer);
+
+    if (client >= 0)
+        close(client);
+
+    close(listener);
+#endif
+
+    return result;
+}
+
+/**
+ * Start the test server on any port.
+ *
+ * @returns the process id, or -1 on failure.
+ */
+static pid_t mumble_test_spawn(const char* program, const char* cert_file,
+                               const char* key_file, const char* record_file,
+                               int* port)
+{
+    int fds[2];
+    char line[256];
+    pid_t pid;
+    FILE* output;
+
+    if (pipe(fds) != 0)
+        return -1;
+
+    if ((pid = fork()) == 0)
+    {
+        dup2(fds[1], STDERR_FILENO);
+        close(fds[0]);
+        close(fds[1]);
+        execl(program, program, "-p", "0", "-c", cert_file, "-k", key_file,
+              "-u", "10", "-r", record_file, (char*)NULL);
+        _exit(127);
+    }
+
+    close(fds[1]);
+
+    if (pid < 0 || (output = fdopen(fds[0], "r")) == NULL)
+    {
+        close(fds[0]);
+
+        return -1;
+    }
+
+    /* The server tells which port it picked once it's listening. */
+    *port = 0;
+
+    if (fgets(line, sizeof line, output) == NULL ||
+        sscanf(line, "Listening on %*[^:]:%d", port) != 1)
+        fprintf(stderr, "Unexpected output of %s: %s\n", program, line);
+
+    fclose(output);
+
+    if (*port == 0)
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+
+        return -1;
+    }
+
+    return pid;
+}
+
+static int mumble_test_on_server_sync(struct mumble_server_t* server)
+{
+    int i;
+    uint8_t voice[200];
+    char message[32];
+    static char large[MUMBLE_TEST_LARGE_SIZE];
+    static const uint32_t kRootChannel = 0;
+    mumble_text_targets_t targets = { 0 };
+    mumble_test_run_t* run =
+        (mumble_test_run_t*)mumble_server_get_user_data(server);
+
+    run->synchronized = 1;
+    targets.channels = &kRootChannel;
+    targets.num_channels = 1;
+
+    /* Small packets, which are coalesced unless the kernel encrypts. */
+    for (i = 0; i < kMumbleTestSmallPackets; i++)
+    {
+        snprintf(message, sizeof message, "message %d", i);
+        mumble_server_send_text_message(server, message, &targets);
+
+        memset(voice, i, sizeof voice);
+        mumble_server_send_voice(server, voice, sizeof voice);
+    }
+
+    /* And one that is written in place. */
+    memset(large, 'x', sizeof large - 1);
+    mumble_server_send_text_message(server, large, &targets);
+
+    return 0;
+}
+
+static void mumble_test_tick(struct ev_loop* loop, ev_timer* w, int revents)
+{
+    (void)loop;
+    (void)w;
+    (void)revents;
+}
+
+/**
+ * Check whether everything queued on a server was written.
+ */
+static int mumble_test_flushed(const struct mumble_server_t* server)
+{
+    int lane;
+
+    if (server->inflight)
+        return 0;
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        if (server->lanes[lane].count > 0)
+            return 0;
+
+    return 1;
+}
+
+/**
+ * Wait until a file has grown to a size.
+ *
+ * @returns the contents of the file, or NULL if it never got that large.
+ */
+static uint8_t* mumble_test_wait_for(const char* path, uint64_t size)
+{
+    FILE* file;
+    uint8_t* data;
+    struct stat info;
+    double deadline = ev_time() + kMumbleTestTimeout;
+
+    while (stat(path, &info) != 0 || (uint64_t)info.st_size < size)
+    {
+        if (ev_time() >= deadline)
+            return NULL;
+
+        usleep(10000);
+    }
+
+    if ((uint64_t)info.st_size != size || (data = malloc(size + 1)) == NULL)
+        return NULL;
+
+    if ((file = fopen(path, "rb")) == NULL)
+    {
+        free(data);
+
+        return NULL;
+    }
+
+    if (fread(data, 1, size, file) != size)
+    {
+        free(data);
+        data = NULL;
+    }
+
+    fclose(file);
+
+    return data;
+}
+
+/**
+ * Connect to the test server, send the packets and wait until the server
+ * recorded them.
+ *
+ * @returns the recorded bytes, or NULL on failure.
+ */
+static uint8_t* mumble_test_connect(int port, int enable_ktls,
+                                    const char* record_file,
+                                    mumble_test_run_t* run)
+{
+    int type;
+    double deadline;
+    uint8_t* received = NULL;
+    ev_timer tick;
+    struct ev_loop* loop;
+    struct mumble_t* client;
+    struct mumble_server_t* server;
+    mumble_settings_t settings;
+    struct mumble_callback_t callbacks = MUMBLE_CALLBACK_INIT;
+
+    memset(&settings, 0, sizeof settings);
+    memset(run, 0, sizeof *run);
+    settings.enable_ktls = enable_ktls;
+
+    if ((client = mumble_new(settings)) == NULL)
+        return NULL;
+
+    if ((server = mumble_server_new("127.0.0.1", (uint32_t)port)) == NULL)
+    {
+        mumble_free(client);
+
+        return NULL;
+    }
+
+    callbacks.on_server_sync = mumble_test_on_server_sync;
+    mumble_server_set_callbacks(server, &callbacks);
+    mumble_server_set_user_data(server, run);
+
+    if (mumble_connect(client, server) != 0)
+    {
+        mumble_free(client);
+
+        return NULL;
+    }
+
+    /* Wake up now and then, so that the deadline is checked. */
+    loop = mumble_get_loop(client);
+    ev_timer_init(&tick, mumble_test_tick, 0.05, 0.05);
+    ev_timer_start(loop, &tick);
+
+    deadline = ev_time() + kMumbleTestTimeout;
+
+    while (ev_time() < deadline &&
+           !(run->synchronized && mumble_test_flushed(server)))
+        ev_run(loop, EVRUN_ONCE);
+
+    ev_timer_stop(loop, &tick);
+
+    run->ktls_send = server->ktls_send;
+
+    for (type = 0; type < MUMBLE_PACKET_MAX; type++)
+        run->bytes += server->metrics.bytes_out[type];
+
+    /* The socket is kept open meanwhile, as closing it with the server's
+     * echoes unread would reset the connection and lose what's in flight. */
+    if (!run->synchronized)
+        fprintf(stderr, "Could not synchronize (enable_ktls=%d)\n",
+                enable_ktls);
+    else if ((received = mumble_test_wait_for(record_file, run->bytes)) ==
+             NULL)
+        fprintf(stderr, "Server didn't receive %llu bytes (enable_ktls=%d)\n",
+                (unsigned long long)run->bytes, enable_ktls);
+
+    mumble_free(client);
+
+    return received;
+}
+
+/**
+ * Run the test server, connect once and collect what the server received.
+ *
+ * @returns the received bytes, or NULL on failure.
+ */
+static uint8_t* mumble_test_run(const char* program, const char* dir,
+                                int enable_ktls, mumble_test_run_t* run)
+{
+    int port;
+    pid_t pid;
+    uint8_t* received;
+    char cert_file[256], key_file[256], record_file[256];
+
+    snprintf(cert_file, sizeof cert_file, "%s/public.crt", dir);
+    snprintf(key_file, sizeof key_file, "%s/private.key", dir);
+    snprintf(record_file, sizeof record_file, "%s/received-%d", dir,
+             enable_ktls);
+
+    if ((pid = mumble_test_spawn(program, cert_file, key_file, record_file,
+                                 &port)) < 0)
+    {
+        fprintf(stderr, "Could not start %s\n", program);
+
+        return NULL;
+    }
+
+    received = mumble_test_connect(port, enable_ktls, record_file, run);
+
+    kill(pid, SIGINT);
+    waitpid(pid, NULL, 0);
+    unlink(record_file);
+
+    return received;
+}
+
+int main(int argc, char** argv)
+{
+    int expected = mumble_test_kernel_tls();
+    char dir[] = "/tmp/mumble-ktls-XXXXXX";
+    char cert_file[64], key_file[64];
+    uint8_t* plain, *offloaded;
+    mumble_test_run_t plain_run, offloaded_run;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s <testserver>\n", argv[0]);
+
+        return 1;
+    }
+
+    if (!getenv("LIBMUMBLE_LOG"))
+        mumble_set_log_level(NULL, 1);
+
+    if (mkdtemp(dir) == NULL)
+    {
+        perror("mkdtemp");
+
+        return 1;
+    }
+
+    snprintf(cert_file, sizeof cert_file, "%s/public.crt", dir);
+    snprintf(key_file, sizeof key_file, "%s/private.key", dir);
+
+    if (mumble_test_certificate(cert_file, key_file) != 0)
+    {
+        fprintf(stderr, "Could not create a certificate\n");
+        rmdir(dir);
+
+        return 1;
+    }
+
+#ifndef MUMBLE_HAVE_KTLS
+    /* Without kTLS in this build, `enable_ktls` is ignored. */
+    expected = 0;
+#endif
+
+    plain = mumble_test_run(argv[1], dir, 0, &plain_run);
+    offloaded = mumble_test_run(argv[1], dir, 1, &offloaded_run);
+
+    MUMBLE_TEST_CHECK(plain != NULL);
+    MUMBLE_TEST_CHECK(offloaded != NULL);
+    MUMBLE_TEST_CHECK(plain_run.ktls_send == 0);
+    MUMBLE_TEST_CHECK(offloaded_run.ktls_send == expected);
+
+    MUMBLE_TEST_CHECK(plain_run.bytes == offloaded_run.bytes);
+    MUMBLE_TEST_CHECK(plain_run.bytes > MUMBLE_TEST_LARGE_SIZE);
+
+    if (plain && offloaded && plain_run.bytes == offloaded_run.bytes)
+        MUMBLE_TEST_CHECK(memcmp(plain, offloaded, plain_run.bytes) == 0);
+
+    printf("enable_ktls: writes %s, %llu bytes\n",
+           offloaded_run.ktls_send ? "offloaded to the kernel"
+                                   : "fell back to SSL_write",
+           (unsigned long long)offloaded_run.bytes);
+
+    free(plain);
+    free(offloaded);
+    unlink(cert_file);
+    unlink(key_file);
+    rmdir(dir);
+
+    return MUMBLE_TEST_STATUS;
+}
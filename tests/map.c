@@ -0,0 +1,230 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <stdlib.h>
+
+#include "map.h"
+#include "test.h"
+
+/**
+ * The number of keys the churn test picks from.
+ */
+#define MUMBLE_TEST_KEYS 4096
+
+/**
+ * The number of random operations in the churn test.
+ */
+static const int kMumbleTestOperations = 200000;
+
+/**
+ * Get the slot a key is stored in, or the capacity if it isn't stored.
+ */
+static size_t mumble_test_find(const mumble_map_t* map, uint32_t key)
+{
+    size_t i;
+
+    for (i = 0; i < map->capacity; i++)
+        if (map->used[i] && map->keys[i] == key)
+            return i;
+
+    return map->capacity;
+}
+
+/**
+ * Get the preferred slot of a key, by storing it in an empty map.
+ */
+static size_t mumble_test_home(uint32_t key)
+{
+    size_t slot;
+    mumble_map_t map;
+
+    mumble_map_init(&map);
+    mumble_map_set(&map, key, 0);
+    slot = mumble_test_find(&map, key);
+    mumble_map_free(&map);
+
+    return slot;
+}
+
+/**
+ * Check that no free slot sits between any entry and its preferred slot, so
+ * that every entry can still be found by probing.
+ */
+static int mumble_test_reachable(const mumble_map_t* map)
+{
+    size_t i, j;
+
+    for (i = 0; i < map->capacity; i++)
+    {
+        if (!map->used[i])
+            continue;
+
+        for (j = mumble_test_home(map->keys[i]); j != i;
+             j = (j + 1) & (map->capacity - 1))
+            if (!map->used[j])
+                return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * Find `count` keys, starting at `key`, whose preferred slot is `slot`.
+ */
+static uint32_t mumble_test_keys(uint32_t key, size_t slot, uint32_t* keys,
+                                 int count)
+{
+    int found = 0;
+
+    for (; found < count; key++)
+        if (mumble_test_home(key) == slot)
+            keys[found++] = key;
+
+    return key;
+}
+
+/**
+ * Fill the end of the table with a run that wraps around to the start, and
+ * remove from it, so that entries are shifted back across the wrap.
+ */
+static void mumble_test_wrap_around(void)
+{
+    int i;
+    uintptr_t value;
+    uint32_t last[3];
+    uint32_t first[2];
+    size_t end = kMumbleMapCapacity - 1;
+    mumble_map_t map;
+
+    MUMBLE_TEST_CHECK(mumble_map_init(&map) == 0);
+
+    /* Three keys for the last slot take the last slot and the first two, and
+     * two keys for the first slot follow them. */
+    mumble_test_keys(mumble_test_keys(1, end, last, 3), 0, first, 2);
+
+    for (i = 0; i < 3; i++)
+        MUMBLE_TEST_CHECK(mumble_map_set(&map, last[i], last[i]) == 0);
+
+    for (i = 0; i < 2; i++)
+        MUMBLE_TEST_CHECK(mumble_map_set(&map, first[i], first[i]) == 0);
+
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, last[0]) == end);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, last[1]) == 0);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, last[2]) == 1);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, first[0]) == 2);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, first[1]) == 3);
+
+    /* Removing the head of the run pulls the rest of it back over the
+     * wrap, including the keys that prefer the first slot. */
+    MUMBLE_TEST_CHECK(mumble_map_remove(&map, last[0]) == 1);
+
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, last[1]) == end);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, last[2]) == 0);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, first[0]) == 1);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, first[1]) == 2);
+    MUMBLE_TEST_CHECK(!map.used[3]);
+    MUMBLE_TEST_CHECK(mumble_test_reachable(&map));
+
+    /* Removing from the middle of the run, just after the wrap, leaves the
+     * entry that is already in the last slot where it is. */
+    MUMBLE_TEST_CHECK(mumble_map_remove(&map, last[2]) == 1);
+
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, last[1]) == end);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, first[0]) == 0);
+    MUMBLE_TEST_CHECK(mumble_test_find(&map, first[1]) == 1);
+    MUMBLE_TEST_CHECK(!map.used[2]);
+    MUMBLE_TEST_CHECK(mumble_test_reachable(&map));
+
+    MUMBLE_TEST_CHECK(mumble_map_remove(&map, last[0]) == 0);
+    MUMBLE_TEST_CHECK(!mumble_map_get(&map, last[2], NULL));
+
+    MUMBLE_TEST_CHECK(mumble_map_get(&map, last[1], &value) &&
+                      value == last[1]);
+
+    for (i = 0; i < 2; i++)
+        MUMBLE_TEST_CHECK(mumble_map_get(&map, first[i], &value) &&
+                          value == first[i]);
+
+    MUMBLE_TEST_CHECK(map.size == 3);
+
+    mumble_map_free(&map);
+}
+
+/**
+ * Insert and remove random keys, some of which are far apart in only their
+ * high bits, and check the map against a plain array.
+ */
+static void mumble_test_churn(void)
+{
+    int i;
+    size_t size = 0;
+    uintptr_t value;
+    static uintptr_t expected[MUMBLE_TEST_KEYS];
+    mumble_map_t map;
+
+    MUMBLE_TEST_CHECK(mumble_map_init(&map) == 0);
+    srand(1);
+
+    for (i = 0; i < kMumbleTestOperations; i++)
+    {
+        int index = rand() % MUMBLE_TEST_KEYS;
+        uint32_t key = (index & 1) ? (uint32_t)index << 20 : (uint32_t)index;
+
+        if (rand() % 3 == 0)
+        {
+            MUMBLE_TEST_CHECK(mumble_map_remove(&map, key) ==
+                              (expected[index] != 0));
+
+            if (expected[index])
+                size--;
+
+            expected[index] = 0;
+        }
+        else
+        {
+            if (!expected[index])
+                size++;
+
+            expected[index] = (uintptr_t)i + 1;
+            MUMBLE_TEST_CHECK(mumble_map_set(&map, key, expected[index]) == 0);
+        }
+    }
+
+    MUMBLE_TEST_CHECK(map.size == size);
+
+    for (i = 0; i < MUMBLE_TEST_KEYS; i++)
+    {
+        uint32_t key = (i & 1) ? (uint32_t)i << 20 : (uint32_t)i;
+
+        if (expected[i])
+            MUMBLE_TEST_CHECK(mumble_map_get(&map, key, &value) &&
+                              value == expected[i]);
+        else
+            MUMBLE_TEST_CHECK(!mumble_map_get(&map, key, NULL));
+    }
+
+    mumble_map_free(&map);
+}
+
+int main(void)
+{
+    mumble_test_wrap_around();
+    mumble_test_churn();
+
+    return MUMBLE_TEST_STATUS;
+}
@@ -0,0 +1,191 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include "Mumble.pb-c.h"
+#include "capture.h"
+#include "iserver.h"
+#include "protocol.h"
+#include "fixture.h"
+#include "test.h"
+
+/**
+ * A voice packet that isn't valid protobuf, so it only reaches `on_voice`
+ * if the body is passed on as is.
+ */
+static const uint8_t kMumbleTestVoice[] = { 0x80, 0x07, 0xff, 0xff, 0x0f };
+
+/**
+ * The protocol version announced in the Version packet.
+ */
+static const uint32_t kMumbleTestVersion = 0x010204;
+
+static uint8_t g_mumble_test_voice[sizeof kMumbleTestVoice];
+static size_t g_mumble_test_voice_length = 0;
+static int g_mumble_test_voice_calls = 0;
+
+static int mumble_test_on_voice(struct mumble_server_t* server,
+                                const uint8_t* packet, size_t length)
+{
+    (void)server;
+
+    g_mumble_test_voice_calls++;
+    g_mumble_test_voice_length = length;
+
+    if (length <= sizeof g_mumble_test_voice)
+        memcpy(g_mumble_test_voice, packet, length);
+
+    return 0;
+}
+
+/**
+ * Append a framed packet to the read buffer of a server.
+ */
+static void mumble_test_frame(struct mumble_server_t* server, uint16_t type,
+                              const uint8_t* body, uint32_t length)
+{
+    uint8_t header[kMumbleHeaderSize];
+    uint16_t type_be = htons(type);
+    uint32_t length_be = htonl(length);
+
+    memcpy(header, &type_be, sizeof type_be);
+    memcpy(header + sizeof type_be, &length_be, sizeof length_be);
+
+    MUMBLE_TEST_CHECK(mumble_buffer_write(&server->rbuffer, header,
+                                          sizeof header) == sizeof header);
+
+    if (length)
+        MUMBLE_TEST_CHECK(mumble_buffer_write(&server->rbuffer, body,
+                                              length) == length);
+}
+
+/**
+ * Check that a capture holds every packet type once, in order.
+ */
+static void mumble_test_check_capture(const char* path)
+{
+    uint16_t type = 0;
+    mumble_capture_reader_t reader;
+    mumble_capture_record_t record;
+
+    if (mumble_capture_reader_open(&reader, path) != 0)
+    {
+        MUMBLE_TEST_CHECK(!"capture can be opened");
+
+        return;
+    }
+
+    while (mumble_capture_read(&reader, &record) == 0)
+    {
+        MUMBLE_TEST_CHECK(record.size >= kMumbleHeaderSize);
+        MUMBLE_TEST_CHECK((record.data[0] << 8 | record.data[1]) == type);
+        type++;
+    }
+
+    MUMBLE_TEST_CHECK(!reader.error);
+    MUMBLE_TEST_CHECK(type == MUMBLE_PACKET_MAX);
+    mumble_capture_reader_close(&reader);
+}
+
+int main(void)
+{
+    int fd;
+    uint16_t type;
+    char capture_path[] = "/tmp/mumble-packets-XXXXXX";
+    uint8_t version_body[32];
+    uint32_t version_length;
+    MumbleProto__Version version = MUMBLE_PROTO__VERSION__INIT;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        fprintf(stderr, "Could not set up the fixture\n");
+        mumble_bench_fixture_free(&fixture);
+
+        return 1;
+    }
+
+    /* Keep the other callbacks of the fixture, so that no type is skipped. */
+    server = fixture.server;
+    server->callbacks.on_voice = mumble_test_on_voice;
+
+    if ((fd = mkstemp(capture_path)) >= 0)
+        close(fd);
+
+    MUMBLE_TEST_CHECK(fd >= 0 &&
+                      mumble_server_set_capture(server, capture_path) == 0);
+
+    version.has_version = 1;
+    version.version = kMumbleTestVersion;
+    version_length = (uint32_t)mumble_proto__version__pack(&version,
+                                                           version_body);
+
+    /* One packet of every type, with an empty body unless the type needs
+     * something to check. */
+    for (type = 0; type < MUMBLE_PACKET_MAX; type++)
+    {
+        if (type == MUMBLE_PACKET_VERSION)
+        {
+            /* Arrives in two parts, so it is read twice. */
+            mumble_test_frame(server, type, version_body, version_length);
+            server->rbuffer.size -= version_length / 2;
+            MUMBLE_TEST_CHECK(mumble_server_read_packet(server) == 0);
+            server->rbuffer.size += version_length / 2;
+        }
+        else if (type == MUMBLE_PACKET_UDPTUNNEL)
+            mumble_test_frame(server, type, kMumbleTestVoice,
+                              sizeof kMumbleTestVoice);
+        else
+            mumble_test_frame(server, type, NULL, 0);
+
+        if (mumble_server_read_packet(server) != 1)
+        {
+            fprintf(stderr, "Packet of type %d was not handled\n", type);
+            g_mumble_test_failures++;
+        }
+
+        MUMBLE_TEST_CHECK(server->rbuffer.size == 0);
+        MUMBLE_TEST_CHECK(server->metrics.packets_in[type] == 1);
+
+        /* Replies, such as the one to a Ping, are never written. */
+        mumble_bench_drain(server);
+    }
+
+    MUMBLE_TEST_CHECK(server->version == kMumbleTestVersion);
+
+    /* Closes the capture, so that it can be read. */
+    MUMBLE_TEST_CHECK(mumble_server_set_capture(server, NULL) == 0);
+    mumble_test_check_capture(capture_path);
+    unlink(capture_path);
+
+    MUMBLE_TEST_CHECK(g_mumble_test_voice_calls == 1);
+    MUMBLE_TEST_CHECK(g_mumble_test_voice_length == sizeof kMumbleTestVoice);
+    MUMBLE_TEST_CHECK(memcmp(g_mumble_test_voice, kMumbleTestVoice,
+                             sizeof kMumbleTestVoice) == 0);
+
+    mumble_bench_fixture_free(&fixture);
+
+    return MUMBLE_TEST_STATUS;
+}
@@ -0,0 +1,125 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <string.h>
+
+#include <mumble/mumble.h>
+#include <mumble/server.h>
+#include "Mumble.pb-c.h"
+#include "iserver.h"
+#include "protocol.h"
+#include "fixture.h"
+#include "test.h"
+
+/**
+ * The size of a text message that makes a segment grow several times.
+ */
+#define MUMBLE_TEST_LARGE_SIZE (1024 * 40)
+
+/**
+ * Take the only segment that is queued on a server.
+ */
+static mumble_segment_t* mumble_test_take(struct mumble_server_t* server)
+{
+    int lane;
+    mumble_segment_t* segment = NULL;
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        if (server->lanes[lane].count > 0)
+            segment = mumble_write_queue_pop(&server->lanes[lane]);
+
+    return segment;
+}
+
+/**
+ * Send a message and check that it's queued exactly as `mumble_packet_pack`
+ * frames it.
+ */
+static void mumble_test_send(struct mumble_server_t* server,
+                             mumble_packet_type_t type, void* message)
+{
+    size_t size;
+    mumble_buffer_t expected;
+    mumble_segment_t* segment;
+
+    mumble_buffer_init_pooled(&expected, NULL);
+    size = mumble_packet_pack(&expected, type, message);
+
+    MUMBLE_TEST_CHECK(size > 0);
+    MUMBLE_TEST_CHECK(mumble_server_send(server, type, message) == 1);
+
+    if ((segment = mumble_test_take(server)) == NULL)
+    {
+        MUMBLE_TEST_CHECK(!"a segment was queued");
+    }
+    else
+    {
+        MUMBLE_TEST_CHECK(segment->size == size);
+        MUMBLE_TEST_CHECK(segment->size == size &&
+                          memcmp(segment->data, expected.ptr, size) == 0);
+        mumble_segment_unref(segment);
+    }
+
+    MUMBLE_TEST_CHECK(mumble_test_take(server) == NULL);
+
+    mumble_buffer_free(&expected);
+}
+
+int main(void)
+{
+    int lane;
+    static char large[MUMBLE_TEST_LARGE_SIZE];
+    MumbleProto__Ping ping = MUMBLE_PROTO__PING__INIT;
+    MumbleProto__TextMessage text = MUMBLE_PROTO__TEXT_MESSAGE__INIT;
+    mumble_bench_fixture_t fixture;
+    struct mumble_server_t* server;
+
+    if (mumble_bench_fixture_init(&fixture) != 0)
+    {
+        fprintf(stderr, "Could not set up the fixture\n");
+        mumble_bench_fixture_free(&fixture);
+
+        return 1;
+    }
+
+    server = fixture.server;
+
+    /* An empty body, a small one, and one that outgrows the first segment. */
+    mumble_test_send(server, MUMBLE_PACKET_PING, &ping);
+
+    ping.has_timestamp = 1;
+    ping.timestamp = 1234567890;
+    mumble_test_send(server, MUMBLE_PACKET_PING, &ping);
+
+    memset(large, 'x', sizeof large - 1);
+    text.message = large;
+    mumble_test_send(server, MUMBLE_PACKET_TEXT_MESSAGE, &text);
+
+    /* UDPTunnel bodies aren't messages, so nothing may be queued for one. */
+    MUMBLE_TEST_CHECK(mumble_server_send(server, MUMBLE_PACKET_UDPTUNNEL,
+                                         &ping) == 0);
+    MUMBLE_TEST_CHECK(mumble_server_send(server, MUMBLE_PACKET_MAX, &ping) ==
+                      0);
+
+    for (lane = 0; lane < MUMBLE_LANE_MAX; lane++)
+        MUMBLE_TEST_CHECK(server->lanes[lane].count == 0);
+
+    mumble_bench_fixture_free(&fixture);
+
+    return MUMBLE_TEST_STATUS;
+}
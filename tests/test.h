@@ -0,0 +1,58 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+/**
+ * @file test.h
+ * @brief Checks for the tests that are run with ctest.
+ *
+ * A test is a program that exits with zero when all of its checks passed. A
+ * failed check prints the expression and carries on, so that one run shows
+ * every failure.
+ */
+
+#include <stdio.h>
+
+#pragma once
+#ifndef MUMBLE_TEST_H
+#define MUMBLE_TEST_H
+
+/**
+ * The number of checks that failed so far.
+ */
+static int g_mumble_test_failures = 0;
+
+/**
+ * Check that an expression is true.
+ */
+#define MUMBLE_TEST_CHECK(expr)                                              \
+    do                                                                       \
+    {                                                                        \
+        if (!(expr))                                                         \
+        {                                                                    \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+                    #expr);                                                  \
+            g_mumble_test_failures++;                                        \
+        }                                                                    \
+    } while (0)
+
+/**
+ * The exit status of a test.
+ */
+#define MUMBLE_TEST_STATUS (g_mumble_test_failures != 0)
+
+#endif /* MUMBLE_TEST_H */
@@ -0,0 +1,263 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <ev.h>
+
+#include "timer.h"
+#include "clock.h"
+#include "test.h"
+
+/**
+ * The timers armed across the levels of the wheel, in order of expiry.
+ */
+enum
+{
+    MUMBLE_TEST_LEVEL0,
+    MUMBLE_TEST_LEVEL1,
+    MUMBLE_TEST_LEVEL2,
+    MUMBLE_TEST_LEVEL3,
+    MUMBLE_TEST_PARKED,
+    MUMBLE_TEST_TIMERS
+};
+
+/**
+ * The number of seconds each timer is armed for. The last one is beyond the
+ * range of the wheel, so it's parked and placed again.
+ */
+static const double kMumbleTestAfter[MUMBLE_TEST_TIMERS] = {
+    0.3, 20, 3600, 2 * 86400, 30 * 86400
+};
+
+/**
+ * A timer and what happened to it.
+ */
+typedef struct mumble_test_timer_t
+{
+    mumble_timer_t timer;
+    mumble_timer_wheel_t* wheel;
+    /** The timer to stop when this one expires, if any. */
+    struct mumble_test_timer_t* victim;
+    /** The number of times the timer expired. */
+    int fired;
+    /** The tick of the wheel when the timer last expired. */
+    uint64_t tick;
+    /** The tick of the clock when the timer last expired. */
+    uint64_t now;
+    /** The order the timer expired in. */
+    int order;
+} mumble_test_timer_t;
+
+/**
+ * The number of timers that have expired.
+ */
+static int g_mumble_test_expired = 0;
+
+/**
+ * Get the current tick of the clock that drives a wheel.
+ */
+static uint64_t mumble_test_now(const mumble_timer_wheel_t* wheel)
+{
+    return (mumble_clock_us() - wheel->epoch) /
+           (uint64_t)(kMumbleTimerResolution * 1e6);
+}
+
+static void mumble_test_expire(mumble_timer_t* timer)
+{
+    mumble_test_timer_t* test = (mumble_test_timer_t*)timer->data;
+
+    test->fired++;
+    test->tick = test->wheel->tick;
+    test->now = mumble_test_now(test->wheel);
+    test->order = g_mumble_test_expired++;
+
+    MUMBLE_TEST_CHECK(!mumble_timer_is_active(timer));
+
+    if (test->victim)
+        mumble_timer_stop(test->wheel, &test->victim->timer);
+}
+
+/**
+ * Let `ticks` ticks pass and run the watcher of the wheel, the way the loop
+ * would once it's due.
+ *
+ * The clock can't be moved, so the wheel is started earlier instead.
+ */
+static void mumble_test_advance(mumble_timer_wheel_t* wheel, uint64_t ticks)
+{
+    wheel->epoch -= ticks * (uint64_t)(kMumbleTimerResolution * 1e6);
+
+    if (ev_is_active(&wheel->watcher))
+        ev_invoke(wheel->loop, &wheel->watcher, EV_TIMER);
+}
+
+static void mumble_test_init(mumble_test_timer_t* test,
+                             mumble_timer_wheel_t* wheel)
+{
+    test->wheel = wheel;
+    test->victim = NULL;
+    test->fired = 0;
+    test->tick = 0;
+    test->now = 0;
+    test->order = -1;
+
+    mumble_timer_init(&test->timer, mumble_test_expire, test);
+}
+
+/**
+ * Arm a timer on every level and one beyond them, and check that each one
+ * expires once, in order, at the tick it was armed for.
+ */
+static void mumble_test_levels(struct ev_loop* loop)
+{
+    int i;
+    uint64_t ticks;
+    mumble_timer_wheel_t wheel;
+    mumble_test_timer_t tests[MUMBLE_TEST_TIMERS];
+    mumble_test_timer_t stopped;
+
+    mumble_timer_wheel_init(&wheel, loop);
+    g_mumble_test_expired = 0;
+
+    /* Armed out of order, so the order they expire in is the wheel's. */
+    for (i = MUMBLE_TEST_TIMERS - 1; i >= 0; i--)
+    {
+        uint64_t expected =
+            (uint64_t)(kMumbleTestAfter[i] / kMumbleTimerResolution + 0.5);
+
+        mumble_test_init(&tests[i], &wheel);
+        mumble_timer_start(&wheel, &tests[i].timer, kMumbleTestAfter[i]);
+
+        MUMBLE_TEST_CHECK(mumble_timer_is_active(&tests[i].timer));
+        MUMBLE_TEST_CHECK(tests[i].timer.expires == expected ||
+                          tests[i].timer.expires == expected + 1);
+        MUMBLE_TEST_CHECK(tests[i].timer.slot / MUMBLE_TIMER_SLOTS ==
+                          (unsigned int)(i < MUMBLE_TIMER_LEVELS
+                                             ? i
+                                             : MUMBLE_TIMER_LEVELS - 1));
+    }
+
+    MUMBLE_TEST_CHECK(wheel.count == MUMBLE_TEST_TIMERS);
+
+    /* Stopping only unlinks the timer from its slot, wherever it is. */
+    mumble_test_init(&stopped, &wheel);
+    mumble_timer_start(&wheel, &stopped.timer, 7200);
+    MUMBLE_TEST_CHECK(stopped.timer.slot / MUMBLE_TIMER_SLOTS == 2);
+    mumble_timer_stop(&wheel, &stopped.timer);
+
+    MUMBLE_TEST_CHECK(!mumble_timer_is_active(&stopped.timer));
+    MUMBLE_TEST_CHECK(wheel.slots[stopped.timer.slot] == NULL);
+    MUMBLE_TEST_CHECK(!(wheel.occupied[2] &
+                        ((uint64_t)1 << (stopped.timer.slot %
+                                         MUMBLE_TIMER_SLOTS))));
+    MUMBLE_TEST_CHECK(wheel.count == MUMBLE_TEST_TIMERS);
+
+    /* Stopping a stopped timer does nothing. */
+    mumble_timer_stop(&wheel, &stopped.timer);
+    MUMBLE_TEST_CHECK(wheel.count == MUMBLE_TEST_TIMERS);
+
+    /* One tick at a time, the timers on the two lowest levels expire in the
+     * tick they are due, and not before. */
+    for (ticks = 0; ticks < tests[MUMBLE_TEST_LEVEL1].timer.expires + 10;
+         ticks++)
+    {
+        mumble_test_advance(&wheel, 1);
+
+        for (i = MUMBLE_TEST_LEVEL0; i <= MUMBLE_TEST_LEVEL1; i++)
+            MUMBLE_TEST_CHECK(tests[i].fired ==
+                              (mumble_test_now(&wheel) >=
+                               tests[i].timer.expires));
+    }
+
+    /* The rest are moved down as the wheel turns. */
+    for (ticks = 0; wheel.count > 0 &&
+                    ticks <= tests[MUMBLE_TEST_PARKED].timer.expires;
+         ticks += 1000)
+        mumble_test_advance(&wheel, 1000);
+
+    for (i = 0; i < MUMBLE_TEST_TIMERS; i++)
+    {
+        MUMBLE_TEST_CHECK(tests[i].fired == 1);
+        MUMBLE_TEST_CHECK(tests[i].order == i);
+        MUMBLE_TEST_CHECK(tests[i].tick == tests[i].timer.expires);
+        MUMBLE_TEST_CHECK(tests[i].now >= tests[i].timer.expires);
+    }
+
+    MUMBLE_TEST_CHECK(stopped.fired == 0);
+    MUMBLE_TEST_CHECK(wheel.expired == MUMBLE_TEST_TIMERS);
+
+    /* An empty wheel doesn't wake the loop. */
+    MUMBLE_TEST_CHECK(!ev_is_active(&wheel.watcher));
+
+    mumble_timer_wheel_free(&wheel);
+}
+
+/**
+ * Arm two timers for the same tick that each stop the other, and check that
+ * only the first one to expire is called.
+ */
+static void mumble_test_stop_expiring(struct ev_loop* loop)
+{
+    uint64_t ticks;
+    mumble_timer_wheel_t wheel;
+    mumble_test_timer_t first, second;
+
+    mumble_timer_wheel_init(&wheel, loop);
+
+    mumble_test_init(&first, &wheel);
+    mumble_test_init(&second, &wheel);
+    first.victim = &second;
+    second.victim = &first;
+
+    /* Due on a higher level, so both are moved down before they expire.
+     * They are armed half way through a tick, so they round up to the same
+     * one. */
+    wheel.epoch -= (uint64_t)(kMumbleTimerResolution * 1e6 / 2);
+    mumble_timer_start(&wheel, &first.timer, 60);
+    mumble_timer_start(&wheel, &second.timer, 60);
+    MUMBLE_TEST_CHECK(first.timer.expires == second.timer.expires);
+
+    for (ticks = 0; wheel.count > 0 && ticks <= first.timer.expires;
+         ticks += 100)
+        mumble_test_advance(&wheel, 100);
+
+    MUMBLE_TEST_CHECK(first.fired + second.fired == 1);
+    MUMBLE_TEST_CHECK(!mumble_timer_is_active(&first.timer));
+    MUMBLE_TEST_CHECK(!mumble_timer_is_active(&second.timer));
+    MUMBLE_TEST_CHECK(!ev_is_active(&wheel.watcher));
+
+    mumble_timer_wheel_free(&wheel);
+}
+
+int main(void)
+{
+    struct ev_loop* loop = ev_loop_new(EVFLAG_AUTO);
+
+    if (!loop)
+    {
+        fprintf(stderr, "Could not create an event loop\n");
+
+        return 1;
+    }
+
+    mumble_test_levels(loop);
+    mumble_test_stop_expiring(loop);
+
+    ev_loop_destroy(loop);
+
+    return MUMBLE_TEST_STATUS;
+}
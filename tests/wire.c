@@ -0,0 +1,507 @@
+/*
+ * libmumble
+ * Copyright (c) 2026 libmumble contributors, All rights reserved.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Mumble.pb-c.h"
+#include "wire.h"
+#include "test.h"
+
+/**
+ * The hot packet types the scanners are tested with.
+ */
+typedef enum mumble_test_type_t
+{
+    MUMBLE_TEST_USER_STATE,
+    MUMBLE_TEST_CHANNEL_STATE,
+    MUMBLE_TEST_TEXT_MESSAGE,
+    MUMBLE_TEST_PING
+} mumble_test_type_t;
+
+/**
+ * Pack a message into a buffer of exactly its size, so that reading past the
+ * end of it is caught by the address sanitizer.
+ */
+static uint8_t* mumble_test_pack(const void* message, size_t* length)
+{
+    uint8_t* body;
+
+    *length = protobuf_c_message_get_packed_size(message);
+    body = (uint8_t*)malloc(*length ? *length : 1);
+
+    if (body)
+        protobuf_c_message_pack(message, body);
+
+    return body;
+}
+
+/**
+ * Scan a body of the given type, copied into a buffer of exactly its size.
+ */
+static int mumble_test_parse(mumble_test_type_t type, const uint8_t* data,
+                             size_t length)
+{
+    int result = 1;
+    uint8_t* body = (uint8_t*)malloc(length ? length : 1);
+    mumble_wire_user_state_t user_state;
+    mumble_wire_channel_state_t channel_state;
+    mumble_wire_text_message_t text_message;
+    mumble_wire_ping_t ping;
+
+    if (!body)
+        return 1;
+
+    memcpy(body, data, length);
+
+    switch (type)
+    {
+        case MUMBLE_TEST_USER_STATE:
+            result = mumble_wire_parse_user_state(body, length, &user_state);
+            break;
+        case MUMBLE_TEST_CHANNEL_STATE:
+            result =
+                mumble_wire_parse_channel_state(body, length, &channel_state);
+            break;
+        case MUMBLE_TEST_TEXT_MESSAGE:
+            result =
+                mumble_wire_parse_text_message(body, length, &text_message);
+            break;
+        case MUMBLE_TEST_PING:
+            result = mumble_wire_parse_ping(body, length, &ping);
+            break;
+    }
+
+    free(body);
+
+    return result;
+}
+
+/**
+ * Check that a slice holds the given bytes.
+ */
+static int mumble_test_slice(const mumble_wire_slice_t* slice,
+                             const void* data, size_t length)
+{
+    return slice->data != NULL && slice->length == length &&
+           memcmp(slice->data, data, length) == 0;
+}
+
+/**
+ * Cut a valid body short at every length, and check that it's accepted
+ * exactly when it ends between two fields.
+ */
+static void mumble_test_truncate(mumble_test_type_t type, const uint8_t* body,
+                                 size_t length)
+{
+    size_t n;
+    uint32_t field, wire_type;
+    mumble_wire_reader_t reader = { body, body + length };
+    const uint8_t* boundary = body;
+
+    for (n = 0; n < length; n++)
+    {
+        int expected;
+
+        /* Find the end of the field the cut is in. */
+        if (body + n > boundary)
+        {
+            MUMBLE_TEST_CHECK(
+                mumble_wire_read_key(&reader, &field, &wire_type) == 0 &&
+                mumble_wire_skip(&reader, wire_type) == 0);
+            boundary = reader.ptr;
+        }
+
+        /* The message of a text message is required, and packed last. */
+        expected = (body + n == boundary && type != MUMBLE_TEST_TEXT_MESSAGE)
+                       ? 0
+                       : 1;
+
+        MUMBLE_TEST_CHECK(mumble_test_parse(type, body, n) == expected);
+    }
+}
+
+static void mumble_test_user_state(void)
+{
+    size_t length;
+    uint8_t* body;
+    static uint8_t texture[4096];
+    uint8_t context[] = { 1, 2, 3 };
+    uint8_t comment_hash[20] = { 0xaa };
+    uint8_t texture_hash[20] = { 0xbb };
+    MumbleProto__UserState message = MUMBLE_PROTO__USER_STATE__INIT;
+    mumble_wire_user_state_t state;
+
+    memset(texture, 0x5a, sizeof texture);
+
+    message.has_session = 1;
+    message.session = 0xfffffffe;
+    message.has_actor = 1;
+    message.actor = 7;
+    message.name = "Test user";
+    message.has_user_id = 1;
+    message.user_id = 300;
+    message.has_channel_id = 1;
+    message.channel_id = 0;
+    message.has_mute = message.mute = 1;
+    message.has_deaf = 1;
+    message.has_suppress = message.suppress = 1;
+    message.has_self_mute = message.self_mute = 1;
+    message.has_self_deaf = 1;
+    message.has_texture = 1;
+    message.texture.data = texture;
+    message.texture.len = sizeof texture;
+    message.has_plugin_context = 1;
+    message.plugin_context.data = context;
+    message.plugin_context.len = sizeof context;
+    message.plugin_identity = "identity";
+    message.comment = "";
+    message.hash = "0123456789abcdef";
+    message.has_comment_hash = 1;
+    message.comment_hash.data = comment_hash;
+    message.comment_hash.len = sizeof comment_hash;
+    message.has_texture_hash = 1;
+    message.texture_hash.data = texture_hash;
+    message.texture_hash.len = sizeof texture_hash;
+    message.has_priority_speaker = message.priority_speaker = 1;
+    message.has_recording = 1;
+
+    if ((body = mumble_test_pack(&message, &length)) == NULL)
+        return;
+
+    MUMBLE_TEST_CHECK(mumble_wire_parse_user_state(body, length, &state) == 0);
+
+    MUMBLE_TEST_CHECK(state.has_session && state.session == 0xfffffffe);
+    MUMBLE_TEST_CHECK(state.has_actor && state.actor == 7);
+    MUMBLE_TEST_CHECK(state.has_user_id && state.user_id == 300);
+    MUMBLE_TEST_CHECK(state.has_channel_id && state.channel_id == 0);
+    MUMBLE_TEST_CHECK(state.has_mute && state.mute);
+    MUMBLE_TEST_CHECK(state.has_deaf && !state.deaf);
+    MUMBLE_TEST_CHECK(state.has_suppress && state.suppress);
+    MUMBLE_TEST_CHECK(state.has_self_mute && state.self_mute);
+    MUMBLE_TEST_CHECK(state.has_self_deaf && !state.self_deaf);
+    MUMBLE_TEST_CHECK(state.has_priority_speaker && state.priority_speaker);
+    MUMBLE_TEST_CHECK(state.has_recording && !state.recording);
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.name, "Test user", 9));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.texture, texture,
+                                        sizeof texture));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.plugin_context, context,
+                                        sizeof context));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.plugin_identity, "identity",
+                                        8));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.comment, "", 0));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.hash, "0123456789abcdef", 16));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.comment_hash, comment_hash,
+                                        sizeof comment_hash));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.texture_hash, texture_hash,
+                                        sizeof texture_hash));
+
+    /* Slices point into the body rather than at copies. */
+    MUMBLE_TEST_CHECK(state.texture.data > body &&
+                      state.texture.data < body + length);
+
+    mumble_test_truncate(MUMBLE_TEST_USER_STATE, body, length);
+    free(body);
+
+    /* Fields that aren't present are left out. */
+    mumble_proto__user_state__init(&message);
+    message.has_session = 1;
+    message.session = 1;
+
+    if ((body = mumble_test_pack(&message, &length)) == NULL)
+        return;
+
+    MUMBLE_TEST_CHECK(mumble_wire_parse_user_state(body, length, &state) == 0);
+    MUMBLE_TEST_CHECK(state.has_session && state.session == 1);
+    MUMBLE_TEST_CHECK(!state.has_actor && !state.has_channel_id);
+    MUMBLE_TEST_CHECK(state.name.data == NULL && state.texture.data == NULL);
+
+    free(body);
+}
+
+static void mumble_test_channel_state(void)
+{
+    size_t length;
+    uint8_t* body;
+    uint32_t links[] = { 1, 2, 3 };
+    uint8_t description_hash[20] = { 0xcc };
+    MumbleProto__ChannelState message = MUMBLE_PROTO__CHANNEL_STATE__INIT;
+    mumble_wire_channel_state_t state;
+
+    message.has_channel_id = 1;
+    message.channel_id = 42;
+    message.has_parent = 1;
+    message.parent = 0;
+    message.name = "Lobby";
+    message.n_links = message.n_links_add = message.n_links_remove = 3;
+    message.links = message.links_add = message.links_remove = links;
+    message.description = "A channel";
+    message.has_temporary = message.temporary = 1;
+    message.has_position = 1;
+    message.position = -5;
+    message.has_description_hash = 1;
+    message.description_hash.data = description_hash;
+    message.description_hash.len = sizeof description_hash;
+
+    if ((body = mumble_test_pack(&message, &length)) == NULL)
+        return;
+
+    MUMBLE_TEST_CHECK(mumble_wire_parse_channel_state(body, length, &state) ==
+                      0);
+
+    MUMBLE_TEST_CHECK(state.has_channel_id && state.channel_id == 42);
+    MUMBLE_TEST_CHECK(state.has_parent && state.parent == 0);
+    MUMBLE_TEST_CHECK(state.has_temporary && state.temporary);
+    MUMBLE_TEST_CHECK(state.has_position && state.position == -5);
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.name, "Lobby", 5));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.description, "A channel", 9));
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.description_hash,
+                                        description_hash,
+                                        sizeof description_hash));
+
+    mumble_test_truncate(MUMBLE_TEST_CHANNEL_STATE, body, length);
+    free(body);
+}
+
+static void mumble_test_text_message(void)
+{
+    size_t length;
+    uint8_t* body;
+    uint32_t values[8];
+    uint32_t sessions[] = { 1, 200, 70000 };
+    uint32_t channels[] = { 0 };
+    uint32_t trees[] = { 5, 6 };
+    MumbleProto__TextMessage message = MUMBLE_PROTO__TEXT_MESSAGE__INIT;
+    mumble_wire_text_message_t text;
+
+    /* Packed and unpacked occurrences of the same repeated field. */
+    static const uint8_t packed[] = {
+        0x12, 0x03, 0x01, 0x02, 0x7f, /* session: [1, 2, 127] */
+        0x10, 0x2a,                   /* session: 42 */
+        0x2a, 0x02, 'h',  'i'         /* message: "hi" */
+    };
+
+    message.has_actor = 1;
+    message.actor = 3;
+    message.n_session = 3;
+    message.session = sessions;
+    message.n_channel_id = 1;
+    message.channel_id = channels;
+    message.n_tree_id = 2;
+    message.tree_id = trees;
+    message.message = "<b>Hello</b>";
+
+    if ((body = mumble_test_pack(&message, &length)) == NULL)
+        return;
+
+    MUMBLE_TEST_CHECK(mumble_wire_parse_text_message(body, length, &text) ==
+                      0);
+
+    MUMBLE_TEST_CHECK(text.has_actor && text.actor == 3);
+    MUMBLE_TEST_CHECK(text.num_sessions == 3);
+    MUMBLE_TEST_CHECK(text.num_channels == 1);
+    MUMBLE_TEST_CHECK(text.num_trees == 2);
+    MUMBLE_TEST_CHECK(mumble_test_slice(&text.message, "<b>Hello</b>", 12));
+
+    MUMBLE_TEST_CHECK(mumble_wire_collect_uint32(body, length, 2, values,
+                                                 8) == 3);
+    MUMBLE_TEST_CHECK(memcmp(values, sessions, sizeof sessions) == 0);
+    MUMBLE_TEST_CHECK(mumble_wire_collect_uint32(body, length, 4, values,
+                                                 8) == 2);
+    MUMBLE_TEST_CHECK(memcmp(values, trees, sizeof trees) == 0);
+
+    /* Collecting stops when the array is full. */
+    MUMBLE_TEST_CHECK(mumble_wire_collect_uint32(body, length, 2, values,
+                                                 2) == 2);
+
+    mumble_test_truncate(MUMBLE_TEST_TEXT_MESSAGE, body, length);
+    free(body);
+
+    MUMBLE_TEST_CHECK(mumble_wire_parse_text_message(packed, sizeof packed,
+                                                     &text) == 0);
+    MUMBLE_TEST_CHECK(text.num_sessions == 4);
+    MUMBLE_TEST_CHECK(mumble_wire_collect_uint32(packed, sizeof packed, 2,
+                                                 values, 8) == 4);
+    MUMBLE_TEST_CHECK(values[0] == 1 && values[1] == 2 && values[2] == 127 &&
+                      values[3] == 42);
+}
+
+static void mumble_test_ping(void)
+{
+    size_t length;
+    uint8_t* body;
+    static const uint8_t empty[1];
+    MumbleProto__Ping message = MUMBLE_PROTO__PING__INIT;
+    mumble_wire_ping_t ping;
+
+    message.has_timestamp = 1;
+    message.timestamp = 0x123456789abcdefULL;
+    message.has_good = 1;
+    message.good = 1;
+    message.has_late = 1;
+    message.late = 2;
+    message.has_lost = 1;
+    message.lost = 3;
+    message.has_resync = 1;
+    message.resync = 4;
+    message.has_udp_packets = 1;
+    message.udp_packets = 5;
+    message.has_tcp_packets = 1;
+    message.tcp_packets = 6;
+    message.has_udp_ping_avg = 1;
+    message.udp_ping_avg = 1.5f;
+    message.has_udp_ping_var = 1;
+    message.udp_ping_var = -2.25f;
+    message.has_tcp_ping_avg = 1;
+    message.tcp_ping_avg = 30.125f;
+    message.has_tcp_ping_var = 1;
+    message.tcp_ping_var = 0.5f;
+
+    if ((body = mumble_test_pack(&message, &length)) == NULL)
+        return;
+
+    MUMBLE_TEST_CHECK(mumble_wire_parse_ping(body, length, &ping) == 0);
+
+    MUMBLE_TEST_CHECK(ping.has_timestamp &&
+                      ping.timestamp == 0x123456789abcdefULL);
+    MUMBLE_TEST_CHECK(ping.good == 1 && ping.late == 2 && ping.lost == 3 &&
+                      ping.resync == 4);
+    MUMBLE_TEST_CHECK(ping.udp_packets == 5 && ping.tcp_packets == 6);
+    MUMBLE_TEST_CHECK(ping.udp_ping_avg == 1.5f);
+    MUMBLE_TEST_CHECK(ping.udp_ping_var == -2.25f);
+    MUMBLE_TEST_CHECK(ping.tcp_ping_avg == 30.125f);
+    MUMBLE_TEST_CHECK(ping.tcp_ping_var == 0.5f);
+
+    mumble_test_truncate(MUMBLE_TEST_PING, body, length);
+    free(body);
+
+    /* An empty ping is valid, and has no timestamp. */
+    MUMBLE_TEST_CHECK(mumble_wire_parse_ping(empty, 0, &ping) == 0);
+    MUMBLE_TEST_CHECK(!ping.has_timestamp);
+}
+
+/**
+ * Feed bodies that protobuf-c would never produce.
+ */
+static void mumble_test_malformed(void)
+{
+    uint64_t value;
+    mumble_wire_reader_t reader;
+    mumble_wire_user_state_t state;
+
+    /* The longest varint is ten bytes. */
+    static const uint8_t longest[] = { 0xff, 0xff, 0xff, 0xff, 0xff,
+                                       0xff, 0xff, 0xff, 0xff, 0x01 };
+    static const uint8_t overlong[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+                                        0x80, 0x80, 0x80, 0x80, 0x00 };
+
+    /* A session followed by fields from a newer protocol, one of every wire
+     * type, and a name. */
+    static const uint8_t unknown[] = {
+        0x08, 0x05,                         /* session: 5 */
+        0xa0, 0x06, 0x96, 0x01,             /* 100: varint */
+        0xa1, 0x06, 1, 2, 3, 4, 5, 6, 7, 8, /* 100: fixed64 */
+        0xa2, 0x06, 0x02, 'x', 'y',         /* 100: length-delimited */
+        0xa5, 0x06, 1, 2, 3, 4,             /* 100: fixed32 */
+        0x1a, 0x01, 'n'                     /* name: "n" */
+    };
+
+    static const struct
+    {
+        mumble_test_type_t type;
+        uint8_t body[16];
+        size_t length;
+    } bad[] = {
+        /* A truncated varint, as a key and as a value. */
+        { MUMBLE_TEST_USER_STATE, { 0x80 }, 1 },
+        { MUMBLE_TEST_USER_STATE, { 0x08, 0x80 }, 2 },
+        { MUMBLE_TEST_PING, { 0x08, 0xff, 0xff, 0xff }, 4 },
+        /* A varint that goes on for more than ten bytes. */
+        { MUMBLE_TEST_USER_STATE,
+          { 0x08, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+            0x01 },
+          12 },
+        /* Length prefixes longer than the rest of the body. */
+        { MUMBLE_TEST_USER_STATE, { 0x1a, 0x05, 'a', 'b' }, 4 },
+        { MUMBLE_TEST_CHANNEL_STATE, { 0x2a, 0x01 }, 2 },
+        { MUMBLE_TEST_TEXT_MESSAGE, { 0x12, 0x04, 0x01 }, 3 },
+        { MUMBLE_TEST_USER_STATE,
+          { 0x1a, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f, 'a' },
+          11 },
+        /* A packed field whose last value is cut off. */
+        { MUMBLE_TEST_TEXT_MESSAGE,
+          { 0x12, 0x02, 0x01, 0x80, 0x2a, 0x00 },
+          6 },
+        /* Truncated unknown fixed-size fields. */
+        { MUMBLE_TEST_USER_STATE, { 0xa1, 0x06, 1, 2, 3 }, 5 },
+        { MUMBLE_TEST_CHANNEL_STATE, { 0xa5, 0x06, 1, 2, 3 }, 5 },
+        /* Known fields with the wrong wire type. */
+        { MUMBLE_TEST_USER_STATE, { 0x0a, 0x01, 0x05 }, 3 },
+        { MUMBLE_TEST_USER_STATE, { 0x18, 0x01 }, 2 },
+        { MUMBLE_TEST_CHANNEL_STATE, { 0x4d, 1, 2, 3, 4 }, 5 },
+        { MUMBLE_TEST_TEXT_MESSAGE, { 0x28, 0x01 }, 2 },
+        { MUMBLE_TEST_TEXT_MESSAGE, { 0x15, 1, 2, 3, 4, 0x2a, 0x00 }, 7 },
+        { MUMBLE_TEST_PING, { 0x09, 1, 2, 3, 4, 5, 6, 7, 8 }, 9 },
+        { MUMBLE_TEST_PING, { 0x40, 0x01 }, 2 },
+        /* A truncated float. */
+        { MUMBLE_TEST_PING, { 0x45, 1, 2, 3 }, 4 },
+        /* Groups, wire types that don't exist and field number zero. */
+        { MUMBLE_TEST_USER_STATE, { 0xa3, 0x06 }, 2 },
+        { MUMBLE_TEST_USER_STATE, { 0xa4, 0x06 }, 2 },
+        { MUMBLE_TEST_CHANNEL_STATE, { 0xa6, 0x06 }, 2 },
+        { MUMBLE_TEST_PING, { 0x00, 0x00 }, 2 },
+        /* A text message without its required message. */
+        { MUMBLE_TEST_TEXT_MESSAGE, { 0x08, 0x01 }, 2 },
+    };
+
+    size_t i;
+
+    reader.ptr = longest;
+    reader.end = longest + sizeof longest;
+    MUMBLE_TEST_CHECK(mumble_wire_read_varint(&reader, &value) == 0);
+    MUMBLE_TEST_CHECK(value == UINT64_MAX && reader.ptr == reader.end);
+
+    reader.ptr = overlong;
+    reader.end = overlong + sizeof overlong;
+    MUMBLE_TEST_CHECK(mumble_wire_read_varint(&reader, &value) != 0);
+
+    MUMBLE_TEST_CHECK(mumble_wire_parse_user_state(unknown, sizeof unknown,
+                                                   &state) == 0);
+    MUMBLE_TEST_CHECK(state.has_session && state.session == 5);
+    MUMBLE_TEST_CHECK(mumble_test_slice(&state.name, "n", 1));
+
+    for (i = 0; i < sizeof bad / sizeof bad[0]; i++)
+    {
+        if (mumble_test_parse(bad[i].type, bad[i].body, bad[i].length) == 0)
+        {
+            fprintf(stderr, "Malformed body %zu was accepted\n", i);
+            MUMBLE_TEST_CHECK(!"malformed bodies are rejected");
+        }
+    }
+}
+
+int main(void)
+{
+    mumble_test_user_state();
+    mumble_test_channel_state();
+    mumble_test_text_message();
+    mumble_test_ping();
+    mumble_test_malformed();
+
+    return MUMBLE_TEST_STATUS;
+}